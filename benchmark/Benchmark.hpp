@@ -0,0 +1,63 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <time.h>
+
+
+class Benchmark
+{
+public:
+	/**************************************************/
+	static inline double now()
+	{
+		timespec t;
+		clock_gettime(CLOCK_MONOTONIC, &t);
+		return t.tv_sec + t.tv_nsec * 1E-9;
+	}
+
+	/**************************************************/
+	static inline double percentile(const std::vector<double> &sorted_,
+									const double percentile_)
+	{
+		if (sorted_.empty())
+			return 0;
+
+		size_t index = (size_t) (percentile_ / 100.0 * (sorted_.size() - 1) + 0.5);
+		return sorted_[std::min(index, sorted_.size() - 1)];
+	}
+
+	/**************************************************/
+	static inline void printDistribution(const std::string &title_,
+										 std::vector<double> samples_,
+										 const double scale_ = 1E6,
+										 const std::string &units_ = "us")
+	{
+		std::sort(samples_.begin(), samples_.end());
+
+		double total = 0;
+		for (size_t i = 0; i < samples_.size(); i++)
+			total += samples_[i];
+
+		std::cout << std::fixed << std::setprecision(2)
+				  << title_ << " [" << units_ << "]"
+				  << "\tn:" << samples_.size()
+				  << "\tmean:" << (samples_.empty() ? 0 : scale_ * total / samples_.size())
+				  << "\tp50:" << scale_ * percentile(samples_, 50)
+				  << "\tp90:" << scale_ * percentile(samples_, 90)
+				  << "\tp99:" << scale_ * percentile(samples_, 99)
+				  << "\tmax:" << scale_ * (samples_.empty() ? 0 : samples_.back())
+				  << std::endl;
+	}
+
+private:
+	Benchmark();
+	~Benchmark();
+};
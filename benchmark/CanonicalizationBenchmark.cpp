@@ -0,0 +1,95 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include <cstdlib>
+#include "Benchmark.hpp"
+#include "CloudFactory.hpp"
+#include "DCH.hpp"
+#include "KMeans.hpp"
+#include "ClusteringUtils.hpp"
+#include "EuclideanMetric.hpp"
+#include "ClosestPermutationMetric.hpp"
+
+
+/**
+ * Compares the clustering of raw DCH descriptors using the closest permutation metric against
+ * the clustering of canonicalized descriptors using the plain euclidean metric. Both results
+ * are evaluated with the closest permutation metric, so the SSE values are comparable.
+ *
+ * Usage: CanonicalizationBenchmark [clusters] [points]
+ */
+int main(int argn_, char **argv_)
+{
+	int clusters = argn_ > 1 ? atoi(argv_[1]) : 5;
+	int points = argn_ > 2 ? atoi(argv_[2]) : 4000;
+
+	// Mix of surfaces with different curvatures
+	pcl::PointCloud<pcl::PointNormal>::Ptr cloud = CloudFactory::createHorizontalPlane(-0.5, 0.5, -0.5, 0.5, 0, points);
+	*cloud += *CloudFactory::createSphereSection(M_PI, 0.15, Eigen::Vector3f(1.5, 0, 0), points);
+	*cloud += *CloudFactory::createCylinderSection(M_PI, 0.1, 0.5, Eigen::Vector3f(3, 0, 0), points);
+	*cloud += *CloudFactory::createCube(0.3, Eigen::Vector3f(4.5, 0, 0), points);
+	std::cout << "Cloud size: " << cloud->size() << std::endl;
+
+	DCHParams *params = new DCHParams();
+	params->searchRadius = 0.05;
+	params->bandNumber = 8;
+	params->bandWidth = 0.01;
+	params->binNumber = 4;
+	params->bidirectional = false;
+	DescriptorParamsPtr paramsPtr = DescriptorParamsPtr(params);
+
+	MetricPtr permutation = MetricPtr(new ClosestPermutationMetric(params->sizePerBand()));
+	MetricPtr euclidean = MetricPtr(new EuclideanMetric());
+
+
+	// Raw descriptors clustered with the permutation metric
+	cv::Mat raw;
+	params->canonicalize = false;
+	double start = Benchmark::now();
+	DCH::computeDense(cloud, paramsPtr, raw);
+	std::vector<double> rawComputationTime(1, Benchmark::now() - start);
+
+	ClusteringResults rawResults;
+	start = Benchmark::now();
+	KMeans::searchClusters(rawResults, raw, permutation, clusters, 1, 1000, 0.001);
+	std::vector<double> rawTime(1, Benchmark::now() - start);
+
+
+	// Canonical descriptors clustered with the euclidean metric
+	cv::Mat canonical;
+	std::vector<int> shifts;
+	params->canonicalize = true;
+	start = Benchmark::now();
+	DCH::computeDense(cloud, paramsPtr, canonical, NeighborGraphPtr(), &shifts);
+	std::vector<double> canonicalizationTime(1, Benchmark::now() - start);
+
+	ClusteringResults canonicalResults;
+	start = Benchmark::now();
+	KMeans::searchClusters(canonicalResults, canonical, euclidean, clusters, 1, 1000, 0.001);
+	std::vector<double> canonicalTime(1, Benchmark::now() - start);
+
+
+	// Report
+	std::cout << std::endl;
+	Benchmark::printDistribution("raw dense computation", rawComputationTime, 1, "s");
+	Benchmark::printDistribution("permutation clustering", rawTime, 1, "s");
+	Benchmark::printDistribution("canonical dense computation", canonicalizationTime, 1, "s");
+	Benchmark::printDistribution("canonical clustering", canonicalTime, 1, "s");
+
+	std::vector<int> shiftCount(params->bandNumber, 0);
+	for (size_t i = 0; i < shifts.size(); i++)
+		shiftCount[shifts[i]]++;
+	std::cout << "Applied shifts:";
+	for (size_t i = 0; i < shiftCount.size(); i++)
+		std::cout << " " << i << ":" << shiftCount[i];
+	std::cout << std::endl;
+
+	std::cout << "SSE (permutation metric) - permutation clustering: "
+			  << ClusteringUtils::getSSE(raw, rawResults.labels, rawResults.centers, permutation)
+			  << " - canonical clustering: "
+			  << ClusteringUtils::getSSE(canonical, canonicalResults.labels, canonicalResults.centers, permutation)
+			  << std::endl;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include "Benchmark.hpp"
+#include "Utils.hpp"
+
+
+/**
+ * Compares the time needed to hash an input file with MD5 (how cache keys used to be built) and
+ * with the parallel tree hash. The file is generated once and hashed several times with each
+ * one, so both run over a warm page cache.
+ *
+ * Usage: ChecksumBenchmark [size in MB] [repetitions]
+ */
+int main(int argn_, char **argv_)
+{
+	int sizeMB = argn_ > 1 ? atoi(argv_[1]) : 512;
+	int repetitions = argn_ > 2 ? atoi(argv_[2]) : 5;
+
+	std::string filename = "./checksum_benchmark.bin";
+	std::vector<char> block(1 << 20);
+	for (size_t i = 0; i < block.size(); i++)
+		block[i] = (char) rand();
+
+	std::ofstream output(filename.c_str(), std::ios::out | std::ios::binary);
+	for (int i = 0; i < sizeMB; i++)
+	{
+		block[i % block.size()]++;
+		output.write(&block[0], block.size());
+	}
+	output.close();
+	std::cout << "File size: " << sizeMB << " MB" << std::endl;
+
+	std::vector<double> md5Times, treeTimes;
+	for (int r = 0; r < repetitions; r++)
+	{
+		double start = Benchmark::now();
+		Utils::computeFileChecksum(filename, Params::CHECKSUM_MD5);
+		md5Times.push_back(Benchmark::now() - start);
+
+		start = Benchmark::now();
+		Utils::computeFileChecksum(filename, Params::CHECKSUM_TREE);
+		treeTimes.push_back(Benchmark::now() - start);
+	}
+
+	Benchmark::printDistribution("MD5", md5Times, 1E3, "ms");
+	Benchmark::printDistribution("Tree hash", treeTimes, 1E3, "ms");
+
+	remove(filename.c_str());
+	return EXIT_SUCCESS;
+}
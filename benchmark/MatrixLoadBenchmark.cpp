@@ -0,0 +1,133 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <limits>
+#include <boost/lexical_cast.hpp>
+#include <boost/filesystem.hpp>
+#include <opencv2/core/core.hpp>
+#include "Benchmark.hpp"
+#include "Loader.hpp"
+#include "BinaryMatrix.hpp"
+#include "CompressedMatrix.hpp"
+
+
+/**
+ * Tokenizing line parser with a lexical_cast per value (how text matrices used to be loaded),
+ * kept as the baseline
+ */
+static void lexicalCastLoad(const std::string &filename_,
+							cv::Mat &matrix_)
+{
+	std::ifstream file(filename_.c_str());
+	std::string line;
+	int row = -1;
+	while (std::getline(file, line))
+	{
+		std::vector<std::string> tokens;
+		std::istringstream iss(line);
+		std::copy(std::istream_iterator<std::string>(iss), std::istream_iterator<std::string>(), std::back_inserter(tokens));
+
+		if (tokens.empty() || tokens[0] == "metadata_lines")
+			continue;
+		if (tokens[0] == "dims")
+		{
+			matrix_ = cv::Mat::zeros(atoi(tokens[1].c_str()), atoi(tokens[2].c_str()), CV_32FC1);
+			row = 0;
+			continue;
+		}
+
+		for (size_t col = 0; row >= 0 && col < tokens.size(); col++)
+			matrix_.at<float>(row, col) = boost::lexical_cast<float>(tokens[col]);
+		row++;
+	}
+}
+
+/**
+ * Compares the loading of the same matrix from the text format (baseline parser and current
+ * parallel parser), the binary format and the block compressed format, checking all of them
+ * load the same values.
+ *
+ * Usage: MatrixLoadBenchmark [rows] [cols] [repetitions]
+ */
+int main(int argn_, char **argv_)
+{
+	int rows = argn_ > 1 ? atoi(argv_[1]) : 100000;
+	int cols = argn_ > 2 ? atoi(argv_[2]) : 352;
+	int repetitions = argn_ > 3 ? atoi(argv_[3]) : 3;
+
+	cv::Mat matrix(rows, cols, CV_32FC1);
+	cv::randu(matrix, -1, 1);
+	std::cout << "Matrix size: " << rows << "x" << cols << std::endl;
+
+	std::vector<std::string> metadata;
+	metadata.push_back("type:benchmark");
+
+	// Text file in the legacy format
+	std::string textFile = "./matrix_load_benchmark.dat";
+	std::ofstream output(textFile.c_str());
+	output << "metadata_lines " << metadata.size() << "\n" << metadata[0] << "\n" << "dims " << rows << " " << cols << "\n";
+	for (int i = 0; i < rows; i++)
+	{
+		for (int j = 0; j < cols; j++)
+			output << std::setprecision(15) << matrix.at<float>(i, j) << " ";
+		output << "\n";
+	}
+	output.close();
+
+	std::string binaryFile = "./matrix_load_benchmark.npy";
+	BinaryMatrix::write(binaryFile, matrix, metadata);
+
+	std::string compressedFile = "./matrix_load_benchmark.zmat";
+	CompressedMatrix::write(compressedFile, matrix, metadata);
+
+	std::vector<double> baselineTimes, textTimes, binaryTimes, compressedTimes;
+	float maxDiff = 0;
+	for (int r = 0; r < repetitions; r++)
+	{
+		cv::Mat baseline, text, binary, compressed;
+
+		double start = Benchmark::now();
+		lexicalCastLoad(textFile, baseline);
+		baselineTimes.push_back(Benchmark::now() - start);
+
+		start = Benchmark::now();
+		Loader::loadMatrix(textFile, text);
+		textTimes.push_back(Benchmark::now() - start);
+
+		start = Benchmark::now();
+		Loader::loadMatrix(binaryFile, binary);
+		binaryTimes.push_back(Benchmark::now() - start);
+
+		start = Benchmark::now();
+		Loader::loadMatrix(compressedFile, compressed);
+		compressedTimes.push_back(Benchmark::now() - start);
+
+		if (text.size() != matrix.size() || binary.size() != matrix.size() || baseline.size() != matrix.size() || compressed.size() != matrix.size())
+			maxDiff = std::numeric_limits<float>::infinity();
+		else
+		{
+			maxDiff = std::max(maxDiff, (float) std::max(cv::norm(text, baseline, cv::NORM_INF), cv::norm(binary, matrix, cv::NORM_INF)));
+			maxDiff = std::max(maxDiff, (float) cv::norm(compressed, matrix, cv::NORM_INF));
+		}
+	}
+
+	Benchmark::printDistribution("text (lexical_cast)", baselineTimes, 1E3, "ms");
+	Benchmark::printDistribution("text (parallel)", textTimes, 1E3, "ms");
+	Benchmark::printDistribution("binary", binaryTimes, 1E3, "ms");
+	Benchmark::printDistribution("compressed", compressedTimes, 1E3, "ms");
+	std::cout << "\tsizes: text " << boost::filesystem::file_size(textFile) / 1024
+			  << " KB, binary " << boost::filesystem::file_size(binaryFile) / 1024
+			  << " KB, compressed " << boost::filesystem::file_size(compressedFile) / 1024 << " KB" << std::endl;
+	std::cout << "\tmax diff: " << maxDiff << std::endl;
+
+	remove(textFile.c_str());
+	remove(binaryFile.c_str());
+	remove(compressedFile.c_str());
+	return EXIT_SUCCESS;
+}
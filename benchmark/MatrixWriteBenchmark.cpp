@@ -0,0 +1,69 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <boost/filesystem.hpp>
+#include <opencv2/core/core.hpp>
+#include "Benchmark.hpp"
+#include "Loader.hpp"
+#include "TextMatrix.hpp"
+
+
+/**
+ * Compares writing a matrix in text format through an ofstream with 15 digits per value (how
+ * text matrices used to be written) against TextMatrix::write. It reports the file sizes and
+ * checks that the new files load back to exactly the same values.
+ *
+ * Usage: MatrixWriteBenchmark [rows] [cols] [repetitions]
+ */
+int main(int argn_, char **argv_)
+{
+	int rows = argn_ > 1 ? atoi(argv_[1]) : 100000;
+	int cols = argn_ > 2 ? atoi(argv_[2]) : 352;
+	int repetitions = argn_ > 3 ? atoi(argv_[3]) : 3;
+
+	cv::Mat matrix(rows, cols, CV_32FC1);
+	cv::randu(matrix, -1, 1);
+	std::cout << "Matrix size: " << rows << "x" << cols << std::endl;
+
+	std::vector<std::string> metadata;
+	metadata.push_back("type:benchmark");
+
+	std::string streamFile = "./matrix_write_benchmark_stream.dat";
+	std::string textFile = "./matrix_write_benchmark.dat";
+	std::vector<double> streamTimes, textTimes;
+	for (int r = 0; r < repetitions; r++)
+	{
+		double start = Benchmark::now();
+		std::ofstream output(streamFile.c_str());
+		output << "metadata_lines " << metadata.size() << "\n" << metadata[0] << "\n" << "dims " << rows << " " << cols << "\n";
+		for (int i = 0; i < rows; i++)
+		{
+			for (int j = 0; j < cols; j++)
+				output << std::setprecision(15) << matrix.at<float>(i, j) << " ";
+			output << "\n";
+		}
+		output.close();
+		streamTimes.push_back(Benchmark::now() - start);
+
+		start = Benchmark::now();
+		TextMatrix::write(textFile, matrix, metadata);
+		textTimes.push_back(Benchmark::now() - start);
+	}
+
+	Benchmark::printDistribution("ofstream (15 digits)", streamTimes, 1E3, "ms");
+	Benchmark::printDistribution("TextMatrix::write", textTimes, 1E3, "ms");
+	std::cout << "\tsizes: " << boost::filesystem::file_size(streamFile) / 1024 << " KB -> " << boost::filesystem::file_size(textFile) / 1024 << " KB" << std::endl;
+
+	cv::Mat loaded;
+	Loader::loadMatrix(textFile, loaded);
+	bool exact = loaded.size() == matrix.size() && cv::countNonZero(loaded != matrix) == 0;
+	std::cout << "\tround trip: " << (exact ? "exact" : "MISMATCH") << std::endl;
+
+	remove(streamFile.c_str());
+	remove(textFile.c_str());
+	return exact ? EXIT_SUCCESS : EXIT_FAILURE;
+}
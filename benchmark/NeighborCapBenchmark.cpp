@@ -0,0 +1,62 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include <cstdlib>
+#include <boost/lexical_cast.hpp>
+#include "Benchmark.hpp"
+#include "CloudFactory.hpp"
+#include "DCH.hpp"
+
+
+/**
+ * Measures the per point latency distribution of the DCH descriptor over a cloud with
+ * strongly varying density (a dense area close to the sensor next to a sparse far one),
+ * with and without the neighbor cap.
+ *
+ * Usage: NeighborCapBenchmark [pointStep] [cap1 cap2 ...]
+ */
+int main(int argn_, char **argv_)
+{
+	int pointStep = argn_ > 1 ? atoi(argv_[1]) : 10;
+
+	std::vector<int> caps;
+	caps.push_back(-1);
+	for (int i = 2; i < argn_; i++)
+		caps.push_back(atoi(argv_[i]));
+	if (caps.size() == 1)
+	{
+		caps.push_back(400);
+		caps.push_back(200);
+		caps.push_back(100);
+	}
+
+	// Near area ~40 times denser than the far one
+	pcl::PointCloud<pcl::PointNormal>::Ptr cloud = CloudFactory::createHorizontalPlane(-0.25, 0.25, -0.25, 0.25, 0, 40000);
+	*cloud += *CloudFactory::createHorizontalPlane(0.3, 1.3, -0.25, 0.25, 0, 2000);
+	std::cout << "Cloud size: " << cloud->size() << " - evaluating every " << pointStep << " points" << std::endl;
+
+	DCHParams *params = new DCHParams();
+	params->searchRadius = 0.05;
+	params->bandNumber = 4;
+	params->bandWidth = 0.01;
+	params->binNumber = 4;
+	DescriptorParamsPtr paramsPtr = DescriptorParamsPtr(params);
+
+	for (size_t c = 0; c < caps.size(); c++)
+	{
+		params->maxNeighbors = caps[c];
+
+		std::vector<double> latencies;
+		for (size_t i = 0; i < cloud->size(); i += pointStep)
+		{
+			double start = Benchmark::now();
+			DCH::calculateDescriptor(cloud, paramsPtr, cloud->points[i]);
+			latencies.push_back(Benchmark::now() - start);
+		}
+
+		Benchmark::printDistribution("maxNeighbors:" + boost::lexical_cast<std::string>(caps[c]), latencies);
+	}
+
+	return EXIT_SUCCESS;
+}
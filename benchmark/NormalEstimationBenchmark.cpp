@@ -0,0 +1,72 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include <cstdlib>
+#include <unistd.h>
+#include <boost/lexical_cast.hpp>
+#include <pcl/features/normal_3d.h>
+#include "Benchmark.hpp"
+#include "CloudFactory.hpp"
+#include "CloudUtils.hpp"
+
+
+/**
+ * Compares the single threaded normal estimation against the parallel one used by
+ * CloudUtils::estimateNormals, for several cloud sizes and thread counts. It also checks
+ * that both produce the same normals.
+ *
+ * Usage: NormalEstimationBenchmark [radius]
+ */
+int main(int argn_, char **argv_)
+{
+	double radius = argn_ > 1 ? atof(argv_[1]) : 0.02;
+
+	int sizes[] = {10000, 50000, 200000, 500000};
+	int maxThreads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(int); s++)
+	{
+		pcl::PointCloud<pcl::PointNormal>::Ptr synthetic = CloudFactory::createHorizontalPlane(-0.5, 0.5, -0.5, 0.5, 0, sizes[s] / 2);
+		*synthetic += *CloudFactory::createSphereSection(M_PI, 0.15, Eigen::Vector3f(0, 0, 0.15), sizes[s] / 2);
+		pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
+		pcl::copyPointCloud(*synthetic, *cloud);
+		std::cout << "Cloud size: " << cloud->size() << " - radius: " << radius << std::endl;
+
+		// Single threaded reference
+		pcl::PointCloud<pcl::Normal>::Ptr reference(new pcl::PointCloud<pcl::Normal>());
+		double start = Benchmark::now();
+		pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> normalEstimation;
+		normalEstimation.setInputCloud(cloud);
+		normalEstimation.setRadiusSearch(radius);
+		normalEstimation.setSearchMethod(pcl::search::KdTree<pcl::PointXYZ>::Ptr(new pcl::search::KdTree<pcl::PointXYZ>()));
+		normalEstimation.compute(*reference);
+		std::vector<double> referenceTime(1, Benchmark::now() - start);
+		Benchmark::printDistribution("\tsequential", referenceTime, 1E3, "ms");
+
+		for (int threads = 1; threads <= maxThreads; threads *= 2)
+		{
+			start = Benchmark::now();
+			pcl::PointCloud<pcl::Normal>::Ptr normals = CloudUtils::estimateNormals(cloud, radius, threads);
+			std::vector<double> time(1, Benchmark::now() - start);
+
+			// Largest difference against the reference (NaN normals must match too)
+			float maxDiff = 0;
+			size_t mismatches = 0;
+			for (size_t i = 0; i < normals->size(); i++)
+			{
+				const pcl::Normal &n1 = reference->points[i];
+				const pcl::Normal &n2 = normals->points[i];
+				if (pcl_isfinite(n1.normal_x) != pcl_isfinite(n2.normal_x))
+					mismatches++;
+				else if (pcl_isfinite(n1.normal_x))
+					maxDiff = std::max(maxDiff, (n1.getNormalVector3fMap() - n2.getNormalVector3fMap()).cwiseAbs().maxCoeff());
+			}
+
+			Benchmark::printDistribution("\tthreads:" + boost::lexical_cast<std::string>(threads), time, 1E3, "ms");
+			std::cout << "\t\tspeedup: " << referenceTime[0] / time[0] << " - max diff: " << maxDiff << " - mismatches: " << mismatches << std::endl;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
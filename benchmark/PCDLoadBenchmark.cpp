@@ -0,0 +1,80 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include <cstdlib>
+#include <cstdio>
+#include <limits>
+#include <boost/lexical_cast.hpp>
+#include <pcl/io/pcd_io.h>
+#include "Benchmark.hpp"
+#include "CloudFactory.hpp"
+#include "PCDReader.hpp"
+
+
+/**
+ * Measures the load time of the same cloud stored as ASCII, binary and compressed binary PCD,
+ * comparing PCL's reader against PCDReader (memory mapped for binary files). It also checks
+ * that both readers load the same points.
+ *
+ * Usage: PCDLoadBenchmark [points] [repetitions]
+ */
+int main(int argn_, char **argv_)
+{
+	int points = argn_ > 1 ? atoi(argv_[1]) : 1000000;
+	int repetitions = argn_ > 2 ? atoi(argv_[2]) : 5;
+
+	pcl::PointCloud<pcl::PointNormal>::Ptr synthetic = CloudFactory::createHorizontalPlane(-0.5, 0.5, -0.5, 0.5, 0, points / 2);
+	*synthetic += *CloudFactory::createSphereSection(M_PI, 0.15, Eigen::Vector3f(0, 0, 0.15), points / 2);
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
+	pcl::copyPointCloud(*synthetic, *cloud);
+	std::cout << "Cloud size: " << cloud->size() << std::endl;
+
+	std::string filename = "./pcd_load_benchmark.pcd";
+	Params::PCDEncoding encodings[] = {Params::PCD_ASCII, Params::PCD_BINARY, Params::PCD_BINARY_COMPRESSED};
+	for (size_t e = 0; e < sizeof(encodings) / sizeof(Params::PCDEncoding); e++)
+	{
+		pcl::PCDWriter writer;
+		switch (encodings[e])
+		{
+		case Params::PCD_ASCII:
+			writer.writeASCII(filename, *cloud);
+			break;
+		case Params::PCD_BINARY:
+			writer.writeBinary(filename, *cloud);
+			break;
+		case Params::PCD_BINARY_COMPRESSED:
+			writer.writeBinaryCompressed(filename, *cloud);
+			break;
+		}
+		std::cout << Params::pcdEncoding[encodings[e]] << std::endl;
+
+		std::vector<double> pclTimes, readerTimes;
+		float maxDiff = 0;
+		for (int r = 0; r < repetitions; r++)
+		{
+			pcl::PointCloud<pcl::PointXYZ> reference, loaded;
+
+			double start = Benchmark::now();
+			pcl::io::loadPCDFile<pcl::PointXYZ>(filename, reference);
+			pclTimes.push_back(Benchmark::now() - start);
+
+			start = Benchmark::now();
+			PCDReader::read(filename, loaded);
+			readerTimes.push_back(Benchmark::now() - start);
+
+			if (loaded.size() != reference.size())
+				maxDiff = std::numeric_limits<float>::infinity();
+			else
+				for (size_t i = 0; i < loaded.size(); i++)
+					maxDiff = std::max(maxDiff, (loaded.points[i].getVector3fMap() - reference.points[i].getVector3fMap()).cwiseAbs().maxCoeff());
+		}
+
+		Benchmark::printDistribution("\tpcl::io::loadPCDFile", pclTimes, 1E3, "ms");
+		Benchmark::printDistribution("\tPCDReader::read", readerTimes, 1E3, "ms");
+		std::cout << "\t\tmax diff: " << maxDiff << std::endl;
+	}
+
+	remove(filename.c_str());
+	return EXIT_SUCCESS;
+}
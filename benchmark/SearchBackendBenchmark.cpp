@@ -0,0 +1,61 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include <cstdlib>
+#include "Benchmark.hpp"
+#include "CloudFactory.hpp"
+#include "CloudUtils.hpp"
+
+
+/**
+ * Compares the build cost and the per query latency of the search backends (kd-tree and
+ * hash grid) for fixed radius searches over clouds of typical sizes.
+ *
+ * Usage: SearchBackendBenchmark [radius] [queries]
+ */
+int main(int argn_, char **argv_)
+{
+	double radius = argn_ > 1 ? atof(argv_[1]) : 0.02;
+	int queries = argn_ > 2 ? atoi(argv_[2]) : 5000;
+
+	int sizes[] = {10000, 50000, 200000};
+	Params::SearchBackend backends[] = {Params::SEARCH_KDTREE, Params::SEARCH_GRID};
+
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(int); s++)
+	{
+		// Half a sphere next to a plane to mimic a small object on a table
+		pcl::PointCloud<pcl::PointNormal>::Ptr cloud = CloudFactory::createHorizontalPlane(-0.5, 0.5, -0.5, 0.5, 0, sizes[s] / 2);
+		*cloud += *CloudFactory::createSphereSection(M_PI, 0.15, Eigen::Vector3f(0, 0, 0.15), sizes[s] / 2);
+		std::cout << "Cloud size: " << cloud->size() << " - radius: " << radius << std::endl;
+
+		for (size_t b = 0; b < sizeof(backends) / sizeof(Params::SearchBackend); b++)
+		{
+			std::string name = Params::searchBackend[backends[b]];
+
+			double start = Benchmark::now();
+			pcl::search::Search<pcl::PointNormal>::Ptr search = CloudUtils::createSearch<pcl::PointNormal>(backends[b], radius);
+			search->setInputCloud(cloud);
+			std::vector<double> build(1, Benchmark::now() - start);
+			Benchmark::printDistribution("\t" + name + " build", build, 1E3, "ms");
+
+			std::vector<int> indices;
+			std::vector<float> distances;
+			std::vector<double> latencies;
+			size_t neighbors = 0;
+			int step = std::max(1, (int) cloud->size() / queries);
+			for (size_t i = 0; i < cloud->size(); i += step)
+			{
+				start = Benchmark::now();
+				search->radiusSearch(cloud->points[i], radius, indices, distances);
+				latencies.push_back(Benchmark::now() - start);
+				neighbors += indices.size();
+			}
+
+			Benchmark::printDistribution("\t" + name + " query", latencies);
+			std::cout << "\t\tmean neighbors: " << (double) neighbors / latencies.size() << std::endl;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
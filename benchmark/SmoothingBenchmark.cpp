@@ -0,0 +1,72 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include <cstdlib>
+#include <unistd.h>
+#include <limits>
+#include <boost/lexical_cast.hpp>
+#include "Benchmark.hpp"
+#include "CloudFactory.hpp"
+#include "CloudUtils.hpp"
+
+
+/**
+ * Measures the gaussian and MLS smoothing for several thread counts, checking that every
+ * parallel run produces exactly the same points than the single threaded one.
+ *
+ * Usage: SmoothingBenchmark [radius] [points]
+ */
+static float maxDifference(const pcl::PointCloud<pcl::PointXYZ>::Ptr &reference_,
+						   const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_)
+{
+	if (reference_->size() != cloud_->size())
+		return std::numeric_limits<float>::infinity();
+
+	float maxDiff = 0;
+	for (size_t i = 0; i < cloud_->size(); i++)
+		maxDiff = std::max(maxDiff, (reference_->points[i].getVector3fMap() - cloud_->points[i].getVector3fMap()).cwiseAbs().maxCoeff());
+	return maxDiff;
+}
+
+int main(int argn_, char **argv_)
+{
+	double radius = argn_ > 1 ? atof(argv_[1]) : 0.02;
+	int points = argn_ > 2 ? atoi(argv_[2]) : 100000;
+
+	pcl::PointCloud<pcl::PointNormal>::Ptr synthetic = CloudFactory::createHorizontalPlane(-0.5, 0.5, -0.5, 0.5, 0, points / 2);
+	*synthetic += *CloudFactory::createSphereSection(M_PI, 0.15, Eigen::Vector3f(0, 0, 0.15), points / 2);
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
+	pcl::copyPointCloud(*synthetic, *cloud);
+	std::cout << "Cloud size: " << cloud->size() << " - radius: " << radius << std::endl;
+
+	int maxThreads = sysconf(_SC_NPROCESSORS_ONLN);
+	pcl::PointCloud<pcl::PointXYZ>::Ptr gaussianReference, MLSReference;
+	std::vector<double> gaussianReferenceTime, MLSReferenceTime;
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		double start = Benchmark::now();
+		pcl::PointCloud<pcl::PointXYZ>::Ptr gaussian = CloudUtils::gaussianSmoothing(cloud, 2, radius, threads);
+		std::vector<double> gaussianTime(1, Benchmark::now() - start);
+
+		start = Benchmark::now();
+		pcl::PointCloud<pcl::PointXYZ>::Ptr MLS = CloudUtils::MLSSmoothing(cloud, radius, threads);
+		std::vector<double> MLSTime(1, Benchmark::now() - start);
+
+		if (threads == 1)
+		{
+			gaussianReference = gaussian;
+			gaussianReferenceTime = gaussianTime;
+			MLSReference = MLS;
+			MLSReferenceTime = MLSTime;
+		}
+
+		std::string label = "threads:" + boost::lexical_cast<std::string>(threads);
+		Benchmark::printDistribution("\tgaussian " + label, gaussianTime, 1E3, "ms");
+		std::cout << "\t\tspeedup: " << gaussianReferenceTime[0] / gaussianTime[0] << " - max diff: " << maxDifference(gaussianReference, gaussian) << std::endl;
+		Benchmark::printDistribution("\tMLS " + label, MLSTime, 1E3, "ms");
+		std::cout << "\t\tspeedup: " << MLSReferenceTime[0] / MLSTime[0] << " - max diff: " << maxDifference(MLSReference, MLS) << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
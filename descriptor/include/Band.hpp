@@ -35,6 +35,17 @@ public:
 // Declaration to define a band's shared pointer
 typedef boost::shared_ptr<Band> BandPtr;
 
+/**
+ * Lightweight band definition used by the dense computation, holding the indices of the band's
+ * points (in a CloudSoA) instead of a copy of them
+ */
+struct BandIndices
+{
+	std::vector<int> points; // Indices of the band's points
+	Eigen::Vector3f direction; // Director vector of the band's axis
+	Eigen::Vector3f planeNormal; // Normal of the perpendicular plane splitting the band along it
+};
+
 // Stream operators
 inline std::ostream& operator << (std::ostream &out_, const BandPtr &band_)
 {
@@ -8,6 +8,11 @@
 #include "Utils.hpp"
 #include "Extractor.hpp"
 #include "Histogram.hpp"
+#include "NeighborGraph.hpp"
+
+
+// Value used to fill the bins of a band without points (mean and median stats)
+#define DCH_EMPTY_BIN_VALUE		5
 
 
 class DCH
@@ -26,14 +31,21 @@ public:
 	/**************************************************/
 	static void computeDense(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 							 const DescriptorParamsPtr &params_,
-							 cv::Mat &descriptors_);
+							 cv::Mat &descriptors_,
+							 const NeighborGraphPtr &graph_ = NeighborGraphPtr(),
+							 std::vector<int> *shifts_ = NULL);
 
 	/**************************************************/
 	static void computePoint(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 							 const DescriptorParamsPtr &params_,
 							 const int target_,
 							 Eigen::VectorXf &descriptor_,
-							 const std::string &debugId_ = "");
+							 const std::string &debugId_ = "",
+							 int *shift_ = NULL);
+
+	/**************************************************/
+	static int canonicalize(float *descriptor_,
+							const DCHParams *params_);
 
 	/**************************************************/
 	static std::vector<Histogram> generateAngleHistograms(const std::vector<BandPtr> &descriptor_,
@@ -43,6 +55,13 @@ public:
 	static void fillDescriptor(std::vector<BandPtr> &descriptor_,
 							   const DescriptorParamsPtr &params_);
 
+	/**************************************************/
+	static void fillDescriptor(const CloudSoA &cloud_,
+							   const std::vector<BandIndices> &bands_,
+							   const pcl::PointNormal &point_,
+							   const DCHParams *params_,
+							   float *descriptor_);
+
 	/**************************************************/
 	static inline double calculateAngle(const Eigen::Vector3f &vector1_,
 										const Eigen::Vector3f &vector2_,
@@ -5,8 +5,10 @@
 #pragma once
 
 #include <vector>
+#include <pcl/search/search.h>
 #include "DescriptorParams.hpp"
 #include "Band.hpp"
+#include "CloudSoA.hpp"
 #include "Utils.hpp"
 
 class Extractor
@@ -16,13 +18,41 @@ public:
 	static pcl::PointCloud<pcl::PointNormal>::Ptr
 	getNeighbors(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 				 const pcl::PointNormal &searchPoint_,
-				 const double searchRadius_);
+				 const double searchRadius_,
+				 const int maxNeighbors_ = -1);
+
+	/**************************************************/
+	static pcl::PointCloud<pcl::PointNormal>::Ptr
+	getNeighbors(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+				 const pcl::search::Search<pcl::PointNormal>::Ptr &search_,
+				 const pcl::PointNormal &searchPoint_,
+				 const double searchRadius_,
+				 const int maxNeighbors_ = -1);
+
+	/**************************************************/
+	static void getNeighborIndices(const pcl::search::Search<pcl::PointNormal>::Ptr &search_,
+								   const pcl::PointNormal &searchPoint_,
+								   const double searchRadius_,
+								   const int maxNeighbors_,
+								   std::vector<int> &pointIndices_);
+
+	/**************************************************/
+	static void subsampleNeighbors(std::vector<int> &pointIndices_,
+								   std::vector<float> &pointSquaredDistances_,
+								   const int maxNeighbors_);
 
 	/**************************************************/
 	static std::vector<BandPtr> getBands(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 										 const pcl::PointNormal &point_,
 										 const DCHParams *params_);
 
+	/**************************************************/
+	static void getBands(const CloudSoA &cloud_,
+						 const std::vector<int> &patch_,
+						 const pcl::PointNormal &point_,
+						 const DCHParams *params_,
+						 std::vector<BandIndices> &bands_);
+
 private:
 	Extractor();
 	~Extractor();
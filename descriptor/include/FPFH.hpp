@@ -6,6 +6,7 @@
 
 #include <pcl/features/fpfh.h>
 #include "DescriptorParams.hpp"
+#include "NeighborGraph.hpp"
 
 
 #define FPFH_POINT_CPY(dest_, orig_, size_)		memcpy((dest_).data(), &(orig_).histogram, sizeof(float) * (size_))
@@ -17,7 +18,8 @@ public:
 	/**************************************************/
 	static void computeDense(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 							 const DescriptorParamsPtr &params_,
-							 cv::Mat &descriptors_);
+							 cv::Mat &descriptors_,
+							 const NeighborGraphPtr &graph_ = NeighborGraphPtr());
 
 	/**************************************************/
 	static void computePoint(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
@@ -8,6 +8,7 @@
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
 #include "DescriptorParams.hpp"
+#include "NeighborGraph.hpp"
 
 
 typedef pcl::Histogram<135> ROPS135;
@@ -18,7 +19,8 @@ public:
 	/**************************************************/
 	static void computeDense(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 							 const DescriptorParamsPtr &params_,
-							 cv::Mat &descriptors_);
+							 cv::Mat &descriptors_,
+							 const NeighborGraphPtr &graph_ = NeighborGraphPtr());
 
 	/**************************************************/
 	static void computePoint(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
@@ -6,6 +6,7 @@
 
 #include <pcl/features/shot.h>
 #include "DescriptorParams.hpp"
+#include "NeighborGraph.hpp"
 
 
 class SHOT
@@ -14,7 +15,8 @@ public:
 	/**************************************************/
 	static void computeDense(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 							 const DescriptorParamsPtr &params_,
-							 cv::Mat &descriptors_);
+							 cv::Mat &descriptors_,
+							 const NeighborGraphPtr &graph_ = NeighborGraphPtr());
 
 	/**************************************************/
 	static void computePoint(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
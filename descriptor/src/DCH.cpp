@@ -3,12 +3,14 @@
  * 2015
  */
 #include "DCH.hpp"
+#include <algorithm>
 #include <pcl/io/pcd_io.h>
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics.hpp>
 #include <boost/accumulators/statistics/count.hpp>
 #include <plog/Log.h>
 #include "Config.hpp"
+#include "CloudUtils.hpp"
 #include "CloudFactory.hpp"
 #include "PointFactory.hpp"
 
@@ -25,7 +27,7 @@ void DEBUG_generateAxes(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 	pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr axesCloud = CloudFactory::createColorCloud(cloud_, Utils::palette12(0));
 
 
-	pcl::PointCloud<pcl::PointNormal>::Ptr patch = Extractor::getNeighbors(cloud_, cloud_->at(target_), params_->searchRadius);
+	pcl::PointCloud<pcl::PointNormal>::Ptr patch = Extractor::getNeighbors(cloud_, cloud_->at(target_), params_->searchRadius, params_->maxNeighbors);
 	pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr patchCloud = CloudFactory::createColorCloud(patch, 255, 0, 0);
 	*axesCloud += *patchCloud;
 
@@ -47,7 +49,7 @@ void DEBUG_generateAxes(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 	if (Config::debugEnabled())
 	{
 		std::string id = !debugId_.compare("") ? "noId" : debugId_;
-		pcl::io::savePCDFileASCII(DEBUG_DIR DEBUG_PREFIX + id + CLOUD_FILE_EXTENSION, *axesCloud);
+		CloudUtils::saveCloud(DEBUG_DIR DEBUG_PREFIX + id + CLOUD_FILE_EXTENSION, *axesCloud);
 	}
 }
 
@@ -66,7 +68,7 @@ std::vector<BandPtr> DCH::calculateDescriptor(const pcl::PointCloud<pcl::PointNo
 	DCHParams *params = dynamic_cast<DCHParams *>(params_.get());
 
 	// Get target point and surface patch
-	pcl::PointCloud<pcl::PointNormal>::Ptr patch = Extractor::getNeighbors(cloud_, target_, params->searchRadius);
+	pcl::PointCloud<pcl::PointNormal>::Ptr patch = Extractor::getNeighbors(cloud_, target_, params->searchRadius, params->maxNeighbors);
 
 	// Extract bands
 	std::vector<BandPtr> bands = Extractor::getBands(patch, target_, params);
@@ -77,7 +79,9 @@ std::vector<BandPtr> DCH::calculateDescriptor(const pcl::PointCloud<pcl::PointNo
 
 void DCH::computeDense(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 					   const DescriptorParamsPtr &params_,
-					   cv::Mat &descriptors_)
+					   cv::Mat &descriptors_,
+					   const NeighborGraphPtr &graph_,
+					   std::vector<int> *shifts_)
 {
 	DCHParams *params = dynamic_cast<DCHParams *>(params_.get());
 	int bandSize = params->sizePerBand();
@@ -87,22 +91,84 @@ void DCH::computeDense(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 	int cols = bandSize * params->bandNumber;
 	if (descriptors_.rows != rows || descriptors_.cols != cols)
 		descriptors_ = cv::Mat::zeros(rows, cols, CV_32FC1);
+	if (shifts_ != NULL)
+		shifts_->assign(rows, 0);
+
+	/**
+	 * Optionally process the points following a Morton curve, so consecutive iterations work over
+	 * neighboring points (sharing cache lines and search paths). Each row is still written at the
+	 * original position of its point, so the output order doesn't change. Organized clouds are left
+	 * as they are, since their row-major order is already coherent and their grid is needed for the
+	 * image space searches.
+	 */
+	pcl::PointCloud<pcl::PointNormal>::Ptr cloud = cloud_;
+	NeighborGraphPtr graph = graph_;
+	std::vector<int> order;
+	if (Config::useMortonOrder() && !cloud_->isOrganized())
+	{
+		order = CloudUtils::mortonOrder(cloud_);
+		cloud = CloudUtils::reorder<pcl::PointNormal>(cloud_, order);
+		if (graph)
+			graph = graph->reorder(order);
+	}
+
+	// The search structure is built only once for the whole cloud (or read from the precomputed graph)
+	pcl::search::Search<pcl::PointNormal>::Ptr search = CloudUtils::createSearch<pcl::PointNormal>(CloudUtils::getSearchBackend(cloud->isOrganized()), params->searchRadius, graph);
+	search->setInputCloud(cloud);
+
+	// The hot loop works over indices into a SoA copy of the cloud, so patches and bands aren't copied
+	CloudSoA soa(cloud);
+	std::vector<int> patch;
+	std::vector<BandIndices> bands;
 
 	// Extract the descriptors
-	for (size_t i = 0; i < cloud_->size(); i++)
+	accumulator_set<double, features<tag::min, tag::mean, tag::max> > patchSizes;
+	for (size_t i = 0; i < cloud->size(); i++)
 	{
-		std::vector<BandPtr> bands = DCH::calculateDescriptor(cloud_, params_, cloud_->points[i]);
+		// Invalid points (kept by organized clouds) get an empty descriptor
+		int row = order.empty() ? i : order[i];
+		const pcl::PointNormal &p = cloud->points[i];
+		if (!pcl_isfinite(p.x) || !pcl_isfinite(p.y) || !pcl_isfinite(p.z) || !pcl_isfinite(p.normal_x))
+		{
+			descriptors_.row(row).setTo(0);
+			continue;
+		}
 
-		for (size_t j = 0; j < bands.size(); j++)
-			memcpy(&descriptors_.at<float>(i, j * bandSize), &bands[j]->descriptor[0], sizeof(float) * bandSize);
+		Extractor::getNeighborIndices(search, cloud->points[i], params->searchRadius, params->maxNeighbors, patch);
+
+		// Neighbors without a valid normal (depth discontinuities in organized clouds) are dropped
+		if (cloud->isOrganized())
+		{
+			size_t valid = 0;
+			for (size_t j = 0; j < patch.size(); j++)
+				if (pcl_isfinite(soa.nx[patch[j]]))
+					patch[valid++] = patch[j];
+			patch.resize(valid);
+		}
+		patchSizes(patch.size());
+
+		Extractor::getBands(soa, patch, cloud->points[i], params, bands);
+
+		DCH::fillDescriptor(soa, bands, cloud->points[i], params, &descriptors_.at<float>(row, 0));
+
+		if (params->canonicalize)
+		{
+			int shift = DCH::canonicalize(&descriptors_.at<float>(row, 0), params);
+			if (shifts_ != NULL)
+				shifts_->at(row) = shift;
+		}
 	}
+
+	if (!cloud_->empty())
+		LOGI << "Patch size (min/mean/max): " << min(patchSizes) << "/" << mean(patchSizes) << "/" << max(patchSizes) << " (maxNeighbors: " << params->maxNeighbors << ")";
 }
 
 void DCH::computePoint(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 					   const DescriptorParamsPtr &params_,
 					   const int target_,
 					   Eigen::VectorXf &descriptor_,
-					   const std::string &debugId_)
+					   const std::string &debugId_,
+					   int *shift_)
 {
 	DCHParams *params = dynamic_cast<DCHParams *>(params_.get());
 	int bandSize = params->sizePerBand();
@@ -114,6 +180,15 @@ void DCH::computePoint(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 		for (size_t k = 0; k < bands[j]->descriptor.size(); k++)
 			descriptor_(j * bandSize + k) = bands[j]->descriptor[k];
 
+	if (params->canonicalize)
+	{
+		int shift = DCH::canonicalize(descriptor_.data(), params);
+		if (shift_ != NULL)
+			*shift_ = shift;
+	}
+	else if (shift_ != NULL)
+		*shift_ = 0;
+
 
 	if (Config::debugEnabled())
 	{
@@ -122,6 +197,59 @@ void DCH::computePoint(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 	}
 }
 
+int DCH::canonicalize(float *descriptor_,
+					  const DCHParams *params_)
+{
+	int bandSize = params_->sizePerBand();
+	bool histogram = params_->stat == Params::STAT_HISTOGRAM_10
+					 || params_->stat == Params::STAT_HISTOGRAM_20
+					 || params_->stat == Params::STAT_HISTOGRAM_30;
+
+	/**
+	 * The dominant band is the one with the largest mean absolute angle (the one where the surface bends
+	 * the most). For the mean/median stats the empty bins are ignored, while for the histograms the
+	 * expected absolute angle is used. Ties are resolved by the lowest index, so the result is deterministic.
+	 */
+	int dominant = 0;
+	double maxEnergy = -1;
+	for (int i = 0; i < params_->bandNumber; i++)
+	{
+		float *band = descriptor_ + i * bandSize;
+
+		double energy = 0;
+		if (histogram)
+		{
+			double binStep = M_PI / bandSize;
+			for (int j = 0; j < bandSize; j++)
+				energy += band[j] * fabs(-M_PI / 2 + (j + 0.5) * binStep);
+		}
+		else
+		{
+			int count = 0;
+			for (int j = 0; j < bandSize; j++)
+			{
+				if (band[j] != DCH_EMPTY_BIN_VALUE)
+				{
+					energy += fabs(band[j]);
+					count++;
+				}
+			}
+			energy = count > 0 ? energy / count : 0;
+		}
+
+		if (energy > maxEnergy)
+		{
+			maxEnergy = energy;
+			dominant = i;
+		}
+	}
+
+	// Circularly shift the bands so the dominant one goes first (same order used by ClosestPermutationMetric)
+	std::rotate(descriptor_, descriptor_ + dominant * bandSize, descriptor_ + params_->bandNumber * bandSize);
+
+	return dominant;
+}
+
 std::vector<Histogram>
 DCH::generateAngleHistograms(const std::vector<BandPtr> &bands_,
 							 const bool useProjection_)
@@ -157,33 +285,69 @@ void DCH::fillDescriptor(std::vector<BandPtr> &bands_,
 		throw std::runtime_error("Unable to cast the given parameters");
 	}
 
-	LOGD << "Filling " << Params::stat[params->stat];
+	if (bands_.empty())
+		return;
 
 
-	switch (params->stat)
+	// Gather the points of all the bands in a single SoA cloud
+	pcl::PointCloud<pcl::PointNormal>::Ptr points(new pcl::PointCloud<pcl::PointNormal>());
+	std::vector<BandIndices> bands(bands_.size());
+	for (size_t i = 0; i < bands_.size(); i++)
+	{
+		bands[i].direction = bands_[i]->axis.direction();
+		bands[i].planeNormal = bands_[i]->plane.normal();
+		for (size_t j = 0; j < bands_[i]->points->size(); j++)
+			bands[i].points.push_back(points->size() + j);
+
+		*points += *bands_[i]->points;
+	}
+	CloudSoA cloud(points);
+
+
+	// Compute and copy back the descriptor of each band
+	int bandSize = params->sizePerBand();
+	std::vector<float> descriptor(bandSize * bands.size());
+	fillDescriptor(cloud, bands, bands_[0]->origin, params, &descriptor[0]);
+
+	for (size_t i = 0; i < bands_.size(); i++)
+		bands_[i]->descriptor.assign(descriptor.begin() + i * bandSize, descriptor.begin() + (i + 1) * bandSize);
+}
+
+void DCH::fillDescriptor(const CloudSoA &cloud_,
+						 const std::vector<BandIndices> &bands_,
+						 const pcl::PointNormal &point_,
+						 const DCHParams *params_,
+						 float *descriptor_)
+{
+	LOGD << "Filling " << Params::stat[params_->stat];
+
+	int bandSize = params_->sizePerBand();
+	Eigen::Vector3f origin = point_.getVector3fMap();
+	Eigen::Vector3f pointNormal = point_.getNormalVector3fMap();
+
+	switch (params_->stat)
 	{
 	default:
 	case Params::STAT_MEAN:
 	case Params::STAT_MEDIAN:
 	{
-		float binSize = params->binSize();
+		float binSize = params_->binSize();
 		for (size_t i = 0; i < bands_.size(); i++)
 		{
-			BandPtr band = bands_[i];
+			const BandIndices &band = bands_[i];
+			Eigen::Hyperplane<float, 3> bandPlane = Eigen::Hyperplane<float, 3>(band.planeNormal, origin);
 
-			Eigen::Vector3f pointNormal = band->origin.getNormalVector3fMap();
-			Eigen::Vector3f planeNormal = band->plane.normal();
-			Eigen::Vector3f n = planeNormal.cross(pointNormal).normalized();
-			Eigen::Hyperplane<float, 3> plane = Eigen::Hyperplane<float, 3>(n, band->origin.getVector3fMap());
+			Eigen::Vector3f n = band.planeNormal.cross(pointNormal).normalized();
+			Eigen::Hyperplane<float, 3> plane = Eigen::Hyperplane<float, 3>(n, origin);
 
 
 			// Accumulate
 			std::map<int, accumulator_set<double, features<tag::mean, tag::median, tag::min> > > dataMap;
-			for (size_t j = 0; j < band->points->size(); j++)
+			for (size_t j = 0; j < band.points.size(); j++)
 			{
-				pcl::PointNormal p = band->points->at(j);
-				double theta = calculateAngle(pointNormal, (Eigen::Vector3f) p.getNormalVector3fMap(), band->plane, params->useProjection);
-				int index = plane.signedDistance((Eigen::Vector3f) p.getVector3fMap()) / binSize;
+				int k = band.points[j];
+				double theta = calculateAngle(pointNormal, cloud_.normal(k), bandPlane, params_->useProjection);
+				int index = plane.signedDistance(cloud_.point(k)) / binSize;
 
 				if (dataMap.find(index) == dataMap.end())
 					dataMap[index] = accumulator_set<double, features<tag::mean, tag::median, tag::min> >();
@@ -193,17 +357,15 @@ void DCH::fillDescriptor(std::vector<BandPtr> &bands_,
 
 
 			// Fill the descriptor
-			for (int j = 0; j < params->sizePerBand(); j++)
+			float *bandDescriptor = descriptor_ + i * bandSize;
+			for (int j = 0; j < bandSize; j++)
 			{
 				if (dataMap.find(j) != dataMap.end())
-				{
-					float value = params->stat == Params::STAT_MEAN
-								  ? (float) mean(dataMap[j])
-								  : (float) median(dataMap[j]);
-					band->descriptor.push_back(value);
-				}
+					bandDescriptor[j] = params_->stat == Params::STAT_MEAN
+										? (float) mean(dataMap[j])
+										: (float) median(dataMap[j]);
 				else
-					band->descriptor.push_back(5);
+					bandDescriptor[j] = DCH_EMPTY_BIN_VALUE;
 			}
 		}
 	}
@@ -213,30 +375,20 @@ void DCH::fillDescriptor(std::vector<BandPtr> &bands_,
 	case Params::STAT_HISTOGRAM_20:
 	case Params::STAT_HISTOGRAM_30:
 	{
-		float angleStep = params->stat == Params::STAT_HISTOGRAM_10 ? 10 :
-						  (params->stat == Params::STAT_HISTOGRAM_20 ? 20 : 30);
-
-
-		// compute the total number of points and the ratio per band
-		// float totalPoints = 0;
-		// for (size_t i = 0; i < bands_.size(); i++)
-		// 	totalPoints += bands_[i]->points->size();
-		// std::vector<float> ratio;
-		// for (size_t i = 0; i < bands_.size(); i++)
-		// 	ratio.push_back(bands_[i]->points->size() / totalPoints);
+		float angleStep = params_->stat == Params::STAT_HISTOGRAM_10 ? 10 :
+						  (params_->stat == Params::STAT_HISTOGRAM_20 ? 20 : 30);
 
-
-		// compute the histograms
-		std::vector<Histogram> histograms = generateAngleHistograms(bands_, params->useProjection);
-		for (size_t i = 0; i < histograms.size(); i++)
+		for (size_t i = 0; i < bands_.size(); i++)
 		{
-			Bins b = histograms[i].getBins(DEG2RAD(angleStep), -M_PI / 2, M_PI / 2);
-			bands_[i]->descriptor.clear();
-			bands_[i]->descriptor.insert(bands_[i]->descriptor.begin(), b.bins.begin(), b.bins.end());
+			const BandIndices &band = bands_[i];
+			Eigen::Hyperplane<float, 3> bandPlane = Eigen::Hyperplane<float, 3>(band.planeNormal, origin);
+
+			Histogram histogram(ANGLE);
+			for (size_t j = 0; j < band.points.size(); j++)
+				histogram.add(calculateAngle(pointNormal, cloud_.normal(band.points[j]), bandPlane, params_->useProjection));
 
-			// scale the band's descriptor according to the computed ratios
-			// for (size_t j = 0; j < bands_[i]->descriptor.size(); j++)
-			// 	bands_[i]->descriptor[j] *= ratio[i];
+			Bins b = histogram.getBins(DEG2RAD(angleStep), -M_PI / 2, M_PI / 2);
+			std::copy(b.bins.begin(), b.bins.begin() + std::min((int) b.bins.size(), bandSize), descriptor_ + i * bandSize);
 		}
 	}
 	break;
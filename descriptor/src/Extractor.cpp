@@ -3,28 +3,38 @@
  * 2015
  */
 #include "Extractor.hpp"
-#include <pcl/kdtree/kdtree_flann.h>
 #include <pcl/io/pcd_io.h>
 #include <pcl/common/impl/common.hpp>
 #include <boost/algorithm/minmax_element.hpp>
 #include "Utils.hpp"
 #include "Config.hpp"
+#include "CloudUtils.hpp"
 #include "PointFactory.hpp"
 
 
 pcl::PointCloud<pcl::PointNormal>::Ptr
 Extractor::getNeighbors(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 						const pcl::PointNormal &searchPoint_,
-						const double searchRadius_)
+						const double searchRadius_,
+						const int maxNeighbors_)
 {
-	pcl::PointCloud<pcl::PointNormal>::Ptr neighborhood(new pcl::PointCloud<pcl::PointNormal>());
+	pcl::search::Search<pcl::PointNormal>::Ptr search = CloudUtils::createSearch<pcl::PointNormal>(CloudUtils::getSearchBackend(cloud_->isOrganized()), searchRadius_);
+	search->setInputCloud(cloud_);
+
+	return getNeighbors(cloud_, search, searchPoint_, searchRadius_, maxNeighbors_);
+}
 
-	pcl::KdTreeFLANN<pcl::PointNormal> kdtree;
-	kdtree.setInputCloud(cloud_);
+pcl::PointCloud<pcl::PointNormal>::Ptr
+Extractor::getNeighbors(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+						const pcl::search::Search<pcl::PointNormal>::Ptr &search_,
+						const pcl::PointNormal &searchPoint_,
+						const double searchRadius_,
+						const int maxNeighbors_)
+{
+	pcl::PointCloud<pcl::PointNormal>::Ptr neighborhood(new pcl::PointCloud<pcl::PointNormal>());
 
 	std::vector<int> pointIndices;
-	std::vector<float> pointRadiusSquaredDistance;
-	kdtree.radiusSearch(searchPoint_, searchRadius_, pointIndices, pointRadiusSquaredDistance);
+	getNeighborIndices(search_, searchPoint_, searchRadius_, maxNeighbors_, pointIndices);
 
 	neighborhood->reserve(pointIndices.size());
 	for (size_t i = 0; i < pointIndices.size(); i++)
@@ -40,71 +50,139 @@ Extractor::getNeighbors(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 	return neighborhood;
 }
 
+void Extractor::getNeighborIndices(const pcl::search::Search<pcl::PointNormal>::Ptr &search_,
+								   const pcl::PointNormal &searchPoint_,
+								   const double searchRadius_,
+								   const int maxNeighbors_,
+								   std::vector<int> &pointIndices_)
+{
+	std::vector<float> pointRadiusSquaredDistance;
+	search_->radiusSearch(searchPoint_, searchRadius_, pointIndices_, pointRadiusSquaredDistance);
+	subsampleNeighbors(pointIndices_, pointRadiusSquaredDistance, maxNeighbors_);
+}
+
+void Extractor::subsampleNeighbors(std::vector<int> &pointIndices_,
+								   std::vector<float> &pointSquaredDistances_,
+								   const int maxNeighbors_)
+{
+	if (maxNeighbors_ <= 0 || pointIndices_.size() <= (size_t) maxNeighbors_)
+		return;
+
+	/**
+	 * The neighbors come sorted by distance from the radius search, so the list is split into
+	 * maxNeighbors_ strata of consecutive distances and one point is kept per stratum. This keeps
+	 * the radial distribution of the patch (and so the bands' statistics) while bounding its size.
+	 */
+	double stride = (double) pointIndices_.size() / maxNeighbors_;
+	for (int i = 0; i < maxNeighbors_; i++)
+	{
+		size_t index = (size_t) (i * stride);
+		pointIndices_[i] = pointIndices_[index];
+		pointSquaredDistances_[i] = pointSquaredDistances_[index];
+	}
+
+	pointIndices_.resize(maxNeighbors_);
+	pointSquaredDistances_.resize(maxNeighbors_);
+}
+
 std::vector<BandPtr>
 Extractor::getBands(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 					const pcl::PointNormal &point_,
 					const DCHParams *params_)
 {
+	// Extract the bands over the whole given cloud
+	CloudSoA cloud(cloud_);
+	std::vector<int> patch(cloud_->size());
+	for (size_t i = 0; i < patch.size(); i++)
+		patch[i] = i;
+
+	std::vector<BandIndices> bandIndices;
+	getBands(cloud, patch, point_, params_, bandIndices);
+
+
+	// Convert the extracted bands to the band-with-points representation
 	std::vector<BandPtr> bands;
-	bands.reserve(params_->bandNumber);
+	bands.reserve(bandIndices.size());
 
 	Eigen::Vector3f p = point_.getVector3fMap();
-	Eigen::Vector3f n = ((Eigen::Vector3f) point_.getNormalVector3fMap()).normalized();
-	Eigen::Hyperplane<float, 3> plane = Eigen::Hyperplane<float, 3>(n, p);
-	std::pair<Eigen::Vector3f, Eigen::Vector3f> axes = Extractor::generateAxes(p, n, plane, params_->angle);
+	for (size_t j = 0; j < bandIndices.size(); j++)
+	{
+		Eigen::ParametrizedLine<float, 3> line = Eigen::ParametrizedLine<float, 3>(p, bandIndices[j].direction);
+		bands.push_back(BandPtr(new Band(point_, Eigen::Hyperplane<float, 3>(bandIndices[j].planeNormal, p), line)));
+
+		bands.back()->points->reserve(bandIndices[j].points.size());
+		for (size_t i = 0; i < bandIndices[j].points.size(); i++)
+			bands.back()->points->push_back(cloud_->points[bandIndices[j].points[i]]);
+	}
 
 
 	/********** Debug **********/
-	float debugLimit = DEBUG_getLimits(cloud_).second;
 	if (Config::debugEnabled())
 	{
+		Eigen::Vector3f n = ((Eigen::Vector3f) point_.getNormalVector3fMap()).normalized();
+		Eigen::Hyperplane<float, 3> plane = Eigen::Hyperplane<float, 3>(n, p);
+		std::pair<Eigen::Vector3f, Eigen::Vector3f> axes = Extractor::generateAxes(p, n, plane, params_->angle);
+
+		float debugLimit = DEBUG_getLimits(cloud_).second;
 		DEBUG_genPlane(plane, p, n, debugLimit, "plane", COLOR_TURQUOISE);
 		DEBUG_genLine(Eigen::ParametrizedLine<float, 3>(p, axes.first), debugLimit, "x", COLOR_RED, false);
 		DEBUG_genLine(Eigen::ParametrizedLine<float, 3>(p, axes.second), debugLimit, "y", COLOR_GREEN, false);
 		DEBUG_genLine(Eigen::ParametrizedLine<float, 3>(p, n), debugLimit, "z", COLOR_BLUE, false);
+
+		for (size_t l = 0; l < bands.size(); l++)
+			DEBUG_genLine(bands[l]->axis,
+						  debugLimit, "axis_band_" + boost::lexical_cast<std::string>(l),
+						  (PointColor)Utils::palette12(l + 1),
+						  params_->bidirectional);
 	}
 	/********** Debug **********/
 
 
+	return bands;
+}
+
+void Extractor::getBands(const CloudSoA &cloud_,
+						 const std::vector<int> &patch_,
+						 const pcl::PointNormal &point_,
+						 const DCHParams *params_,
+						 std::vector<BandIndices> &bands_)
+{
+	Eigen::Vector3f p = point_.getVector3fMap();
+	Eigen::Vector3f n = ((Eigen::Vector3f) point_.getNormalVector3fMap()).normalized();
+	Eigen::Hyperplane<float, 3> plane = Eigen::Hyperplane<float, 3>(n, p);
+	std::pair<Eigen::Vector3f, Eigen::Vector3f> axes = Extractor::generateAxes(p, n, plane, params_->angle);
+
+
 	// Create the lines defining each band and also each band's longitudinal plane
+	bands_.resize(params_->bandNumber);
 	std::vector<Eigen::ParametrizedLine<float, 3> > lines;
-	std::vector<Eigen::Vector3f> normals, directors;
+	lines.reserve(params_->bandNumber);
 	double angleStep = params_->bandsAngleStep();
 	for (int i = 0; i < params_->bandNumber; i++)
 	{
 		// Calculate the line's director std::vector and define the line
-		directors.push_back((axes.first * cos(angleStep * i) + axes.second * sin(angleStep * i)).normalized());
-		lines.push_back(Eigen::ParametrizedLine<float, 3>(p, directors.back()));
+		bands_[i].points.clear();
+		bands_[i].direction = (axes.first * cos(angleStep * i) + axes.second * sin(angleStep * i)).normalized();
+		lines.push_back(Eigen::ParametrizedLine<float, 3>(p, bands_[i].direction));
 
-		// Calculate the normal to a plane going along the band and then define the plane
-		normals.push_back(n.cross(directors.back()).normalized());
-		bands.push_back(BandPtr(new Band(point_, Eigen::Hyperplane<float, 3>(normals.back(), p), lines.back())));
+		// Calculate the normal to a plane going along the band
+		bands_[i].planeNormal = n.cross(bands_[i].direction).normalized();
 	}
 
 
-	/********** Debug **********/
-	if (Config::debugEnabled())
-		for (size_t l = 0; l < lines.size(); l++)
-			DEBUG_genLine(lines[l],
-						  debugLimit, "axis_band_" + boost::lexical_cast<std::string>(l),
-						  (PointColor)Utils::palette12(l + 1),
-						  params_->bidirectional);
-	/********** Debug **********/
-
-
 	// Extracting points for each band (.52 to give a little extra room)
 	double halfBand = params_->bandWidth * 0.52;
 	for (size_t j = 0; j < lines.size(); j++)
 	{
-		for (size_t i = 0; i < cloud_->size(); i++)
+		for (size_t i = 0; i < patch_.size(); i++)
 		{
-			Eigen::Vector3f point = cloud_->points[i].getVector3fMap();
+			Eigen::Vector3f point = cloud_.point(patch_[i]);
 			Eigen::Vector3f projection = plane.projection(point);
 
 			if (params_->bidirectional)
 			{
 				if (lines[j].distance(projection) <= halfBand)
-					bands[j]->points->push_back(cloud_->points[i]);
+					bands_[j].points.push_back(patch_[i]);
 			}
 			else
 			{
@@ -118,7 +196,7 @@ Extractor::getBands(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 				 */
 
 				// Vector inside the original plane (the point's plane), defining point p1
-				Eigen::Vector3f pointOnPlane = p + normals[j];
+				Eigen::Vector3f pointOnPlane = p + bands_[j].planeNormal;
 
 				// Vector going from a point inside the point's plane (p1) to the current target evaluation
 				Eigen::Vector3f planeToPoint = point - pointOnPlane;
@@ -128,12 +206,10 @@ Extractor::getBands(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 
 				// Add the point if the point is at the correct side of the plane and if it's in the band's limits
 				if (orientation >= 0 && lines[j].distance(projection) <= halfBand)
-					bands[j]->points->push_back(cloud_->points[i]);
+					bands_[j].points.push_back(patch_[i]);
 			}
 		}
 	}
-
-	return bands;
 }
 
 std::pair<Eigen::Vector3f, Eigen::Vector3f>
@@ -173,7 +249,7 @@ void Extractor::DEBUG_genPlane(const Eigen::Hyperplane<float, 3> &plane_,
 			}
 		}
 	}
-	pcl::io::savePCDFileASCII(DEBUG_DIR DEBUG_PREFIX + filename_ + CLOUD_FILE_EXTENSION, *targetPlane);
+	CloudUtils::saveCloud(DEBUG_DIR DEBUG_PREFIX + filename_ + CLOUD_FILE_EXTENSION, *targetPlane);
 }
 
 void Extractor::DEBUG_genLine(const Eigen::ParametrizedLine<float, 3> &line_,
@@ -191,7 +267,7 @@ void Extractor::DEBUG_genLine(const Eigen::ParametrizedLine<float, 3> &line_,
 		lineCloud->push_back(PointFactory::createPointXYZRGB(point.x(), point.y(), point.z(), color_));
 	}
 
-	pcl::io::savePCDFileASCII(DEBUG_DIR DEBUG_PREFIX + filename_ + CLOUD_FILE_EXTENSION, *lineCloud);
+	CloudUtils::saveCloud(DEBUG_DIR DEBUG_PREFIX + filename_ + CLOUD_FILE_EXTENSION, *lineCloud);
 }
 
 std::pair<float, float> Extractor::DEBUG_getLimits(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_)
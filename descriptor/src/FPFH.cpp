@@ -5,11 +5,13 @@
 #include "FPFH.hpp"
 #include <pcl/filters/filter.h>
 #include <pcl/features/normal_3d.h>
+#include "CloudUtils.hpp"
 
 
 void FPFH::computeDense(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 						const DescriptorParamsPtr &params_,
-						cv::Mat &descriptors_)
+						cv::Mat &descriptors_,
+						const NeighborGraphPtr &graph_)
 {
 	LOGD << "Computing FPFH dense";
 
@@ -17,12 +19,12 @@ void FPFH::computeDense(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 
 	// Compute the descriptor
 	pcl::PointCloud<pcl::FPFHSignature33>::Ptr descriptorCloud(new pcl::PointCloud<pcl::FPFHSignature33>());
-	pcl::search::KdTree<pcl::PointNormal>::Ptr kdtree(new pcl::search::KdTree<pcl::PointNormal>);
+	pcl::search::Search<pcl::PointNormal>::Ptr search = CloudUtils::createSearch<pcl::PointNormal>(CloudUtils::getSearchBackend(cloud_->isOrganized()), params->searchRadius, graph_);
 
 	pcl::FPFHEstimation<pcl::PointNormal, pcl::PointNormal, pcl::FPFHSignature33> fpfh;
 	fpfh.setInputCloud (cloud_);
 	fpfh.setInputNormals (cloud_);
-	fpfh.setSearchMethod(kdtree);
+	fpfh.setSearchMethod(search);
 	fpfh.setRadiusSearch(params->searchRadius);
 	fpfh.compute(*descriptorCloud);
 
@@ -47,21 +49,21 @@ void FPFH::computePoint(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 	pcl::NormalEstimation<pcl::PointNormal, pcl::Normal> normalEstimation;
 	normalEstimation.setInputCloud(cloud_);
 	normalEstimation.setRadiusSearch(0.03);
-	pcl::search::KdTree<pcl::PointNormal>::Ptr kdtreeN(new pcl::search::KdTree<pcl::PointNormal>);
-	normalEstimation.setSearchMethod(kdtreeN);
+	pcl::search::Search<pcl::PointNormal>::Ptr searchN = CloudUtils::createSearch<pcl::PointNormal>(CloudUtils::getSearchBackend(cloud_->isOrganized()), 0.03);
+	normalEstimation.setSearchMethod(searchN);
 	normalEstimation.compute(*normals);
 
 
 
 	// Compute the descriptor
 	pcl::PointCloud<pcl::FPFHSignature33>::Ptr descriptorCloud(new pcl::PointCloud<pcl::FPFHSignature33>());
-	pcl::search::KdTree<pcl::PointNormal>::Ptr kdtree(new pcl::search::KdTree<pcl::PointNormal>);
+	pcl::search::Search<pcl::PointNormal>::Ptr search = CloudUtils::createSearch<pcl::PointNormal>(CloudUtils::getSearchBackend(cloud_->isOrganized()), params->searchRadius);
 
 	// pcl::FPFHEstimation<pcl::PointNormal, pcl::PointNormal, pcl::FPFHSignature33> fpfh;
 	pcl::FPFHEstimation<pcl::PointNormal, pcl::Normal, pcl::FPFHSignature33> fpfh;
 	fpfh.setInputCloud (cloud_);
 	fpfh.setInputNormals (normals);
-	fpfh.setSearchMethod(kdtree);
+	fpfh.setSearchMethod(search);
 	fpfh.setRadiusSearch(params->searchRadius);
 	fpfh.compute(*descriptorCloud);
 
@@ -4,11 +4,13 @@
  */
 #include "PFH.hpp"
 #include <pcl/filters/filter.h>
+#include "CloudUtils.hpp"
 
 
 void PFH::computeDense(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 					   const DescriptorParamsPtr &params_,
-					   cv::Mat &descriptors_)
+					   cv::Mat &descriptors_,
+					   const NeighborGraphPtr &graph_)
 {
 	LOGD << "Computing PFH dense";
 
@@ -16,12 +18,12 @@ void PFH::computeDense(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 
 	// Compute the descriptor
 	pcl::PointCloud<pcl::PFHSignature125>::Ptr descriptorCloud(new pcl::PointCloud<pcl::PFHSignature125>());
-	pcl::search::KdTree<pcl::PointNormal>::Ptr kdtree(new pcl::search::KdTree<pcl::PointNormal>);
+	pcl::search::Search<pcl::PointNormal>::Ptr search = CloudUtils::createSearch<pcl::PointNormal>(CloudUtils::getSearchBackend(cloud_->isOrganized()), params->searchRadius, graph_);
 
 	pcl::PFHEstimation<pcl::PointNormal, pcl::PointNormal, pcl::PFHSignature125> pfh;
 	pfh.setInputCloud (cloud_);
 	pfh.setInputNormals (cloud_);
-	pfh.setSearchMethod(kdtree);
+	pfh.setSearchMethod(search);
 	pfh.setRadiusSearch(params->searchRadius);
 	pfh.compute(*descriptorCloud);
 
@@ -51,12 +53,12 @@ void PFH::computePoint(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 
 	// Compute the descriptor
 	pcl::PointCloud<pcl::PFHSignature125>::Ptr descriptorCloud(new pcl::PointCloud<pcl::PFHSignature125>());
-	pcl::search::KdTree<pcl::PointNormal>::Ptr kdtree(new pcl::search::KdTree<pcl::PointNormal>);
+	pcl::search::Search<pcl::PointNormal>::Ptr search = CloudUtils::createSearch<pcl::PointNormal>(CloudUtils::getSearchBackend(cloud_->isOrganized()), params->searchRadius);
 
 	pcl::PFHEstimation<pcl::PointNormal, pcl::PointNormal, pcl::PFHSignature125> pfh;
 	pfh.setInputCloud (cloud_);
 	pfh.setInputNormals (cloud_);
-	pfh.setSearchMethod(kdtree);
+	pfh.setSearchMethod(search);
 	pfh.setRadiusSearch(params->searchRadius);
 	pfh.compute(*descriptorCloud);
 
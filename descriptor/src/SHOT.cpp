@@ -4,13 +4,15 @@
  */
 #include "SHOT.hpp"
 #include <pcl/filters/filter.h>
+#include "CloudUtils.hpp"
 
 typedef pcl::Histogram<153> SpinImage;
 
 
 void SHOT::computeDense(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 						const DescriptorParamsPtr &params_,
-						cv::Mat &descriptors_)
+						cv::Mat &descriptors_,
+						const NeighborGraphPtr &graph_)
 {
 	LOGD << "Computing SHOT dense";
 
@@ -21,6 +23,7 @@ void SHOT::computeDense(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 	pcl::SHOTEstimation<pcl::PointNormal, pcl::PointNormal, pcl::SHOT352> shot;
 	shot.setInputCloud(cloud_);
 	shot.setInputNormals(cloud_);
+	shot.setSearchMethod(CloudUtils::createSearch<pcl::PointNormal>(CloudUtils::getSearchBackend(cloud_->isOrganized()), params->searchRadius, graph_));
 	shot.setRadiusSearch(params->searchRadius);
 	shot.setLRFRadius(params->searchRadius);
 	shot.compute(*descriptorCloud);
@@ -52,6 +55,7 @@ void SHOT::computePoint(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 	pcl::SHOTEstimation<pcl::PointNormal, pcl::PointNormal, pcl::SHOT352> shot;
 	shot.setInputCloud(cloud_);
 	shot.setInputNormals(cloud_);
+	shot.setSearchMethod(CloudUtils::createSearch<pcl::PointNormal>(CloudUtils::getSearchBackend(cloud_->isOrganized()), params->searchRadius));
 	shot.setRadiusSearch(params->searchRadius);
 	shot.setLRFRadius(params->searchRadius);
 	shot.compute(*descriptorCloud);
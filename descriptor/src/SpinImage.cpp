@@ -4,11 +4,13 @@
  */
 #include "SpinImage.hpp"
 #include <pcl/filters/filter.h>
+#include "CloudUtils.hpp"
 
 
 void SpinImage::computeDense(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 							 const DescriptorParamsPtr &params_,
-							 cv::Mat &descriptors_)
+							 cv::Mat &descriptors_,
+							 const NeighborGraphPtr &graph_)
 {
 	LOGD << "Computing SpinImage dense";
 
@@ -20,6 +22,7 @@ void SpinImage::computeDense(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud
 	pcl::SpinImageEstimation<pcl::PointNormal, pcl::PointNormal, SpinImage153> si;
 	si.setInputCloud (cloud_);
 	si.setInputNormals (cloud_);
+	si.setSearchMethod(CloudUtils::createSearch<pcl::PointNormal>(CloudUtils::getSearchBackend(cloud_->isOrganized()), params->searchRadius, graph_));
 	si.setRadiusSearch(params->searchRadius);
 	si.setImageWidth(params->imageWidth);
 	si.compute(*descriptorCloud);
@@ -53,6 +56,7 @@ void SpinImage::computePoint(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud
 	pcl::SpinImageEstimation<pcl::PointNormal, pcl::PointNormal, SpinImage153> si;
 	si.setInputCloud (cloud_);
 	si.setInputNormals (cloud_);
+	si.setSearchMethod(CloudUtils::createSearch<pcl::PointNormal>(CloudUtils::getSearchBackend(cloud_->isOrganized()), params->searchRadius));
 	si.setRadiusSearch(params->searchRadius);
 	si.setImageWidth(params->imageWidth);
 	si.compute(*descriptorCloud);
@@ -8,7 +8,8 @@
 
 void USC::computeDense(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 					   const DescriptorParamsPtr &params_,
-					   cv::Mat &descriptors_)
+					   cv::Mat &descriptors_,
+					   const NeighborGraphPtr &graph_)
 {
 	LOGD << "Computing USC dense";
 
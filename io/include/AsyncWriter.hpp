@@ -0,0 +1,128 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <opencv2/core/core.hpp>
+#include "BoundedQueue.hpp"
+#include "Extractor.hpp"
+#include "DescriptorParams.hpp"
+
+
+/**
+ * Background service running the Writer functions out of the compute thread. Each call takes
+ * ownership of the given clouds and matrices (the caller's references are released, nothing is
+ * copied) and queues the write, so the formatting and the I/O happen in a separate thread. The
+ * queue is bounded, so a slow disk eventually blocks the producer instead of piling up data.
+ *
+ * flush() waits for every queued write and reports the ones that failed since the last flush.
+ * Nothing is written at exit: the caller has to call shutdown() (or at least flush()) before
+ * leaving main, while the singletons used by the writes (Config, CacheManager, the logger) are
+ * still alive. Writes still queued when the service is destroyed are dropped, with a warning.
+ * With a queue size of 0 (outputQueueSize) the writes run synchronously in the caller's thread,
+ * with the same error reporting. Cache entries written while holding their CacheLock have to use
+ * the Writer directly, since the lock would be released before the entry is published.
+ */
+class AsyncWriter
+{
+public:
+	~AsyncWriter();
+
+	/**************************************************/
+	static AsyncWriter *getInstance()
+	{
+		static AsyncWriter instance;
+		return &instance;
+	}
+
+	/**************************************************/
+	static void writeOuputData(pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+							   std::vector<BandPtr> &bands_,
+							   const DescriptorParamsPtr &params_,
+							   const int targetPoint_);
+
+	/**************************************************/
+	static void writeClusteredCloud(const std::string &filename_,
+									pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+									cv::Mat &labels_);
+
+	/**************************************************/
+	static void writeClustersCenters(const std::string &filename_,
+									 cv::Mat &centers_,
+									 const DescriptorParamsPtr &descriptorParams_,
+									 const ClusteringParams &clusteringParams_,
+									 const CloudSmoothingParams &smoothingParams_);
+
+	/**************************************************/
+	static void writeCodebook(const std::string &filename_,
+							  cv::Mat &centers_,
+							  const ClusteringParams &clusteringParams_,
+							  const Params::DescriptorType &type_,
+							  const float searchRadius_,
+							  const int nbands_ = -1,
+							  const int nbins_ = -1,
+							  const bool bidirectional_ = false);
+
+	/**************************************************/
+	static void writeDescriptorsCache(cv::Mat &descriptors_,
+									  const std::string &cacheLocation_,
+									  const std::string &cloudInputFilename_,
+									  const double normalEstimationRadius_,
+									  const DescriptorParamsPtr &descriptorParams_,
+									  const CloudSmoothingParams &smoothingParams_);
+
+	/**************************************************/
+	static bool flush(std::vector<std::string> *errors_ = NULL);
+
+	/**************************************************/
+	static void shutdown();
+
+private:
+	/**
+	 * Write waiting in the queue
+	 */
+	struct Job
+	{
+		std::string description; // Description of the write (for error reporting)
+		boost::function<bool ()> write; // Write to be done, returning false on failure
+	};
+	typedef boost::shared_ptr<Job> JobPtr;
+
+	AsyncWriter()
+	{
+		stopped = discarding = false;
+		submitted = completed = 0;
+	}
+
+	/**************************************************/
+	static void submit(const std::string &description_,
+					   const boost::function<bool ()> &write_);
+
+	/**************************************************/
+	void run(const JobPtr &job_);
+
+	/**************************************************/
+	void writeLoop();
+
+
+	boost::scoped_ptr<BoundedQueue<JobPtr> > queue; // Queue of pending writes (empty until the service is started)
+	boost::thread worker; // Thread doing the writes
+	bool stopped; // Flag indicating if the service has been shut down (later writes run synchronously)
+	bool discarding; // Flag indicating if the queued writes are being dropped (service destroyed without a shutdown)
+	size_t submitted; // Writes queued since the service was started
+	size_t completed; // Writes done since the service was started
+	std::vector<std::string> errors; // Failed writes not reported yet
+	boost::mutex mutex; // Mutex protecting the counters and the errors
+	boost::condition_variable done; // Signaled every time a write is completed
+};
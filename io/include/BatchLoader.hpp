@@ -0,0 +1,101 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include "ExecutionParams.hpp"
+#include "NeighborGraph.hpp"
+#include "BoundedQueue.hpp"
+
+
+/**
+ * Structure holding a cloud delivered by the batch loader
+ */
+struct LoadedCloud
+{
+	std::string filename; // File the cloud was loaded from
+	bool loadOk; // Flag indicating if the cloud was properly loaded
+	pcl::PointCloud<pcl::PointNormal>::Ptr cloud; // Preprocessed cloud (points and normals)
+	NeighborGraphPtr graph; // Neighbor graph of the cloud (if requested)
+
+	/**************************************************/
+	LoadedCloud()
+	{
+		loadOk = false;
+	}
+};
+
+
+/**
+ * Loads and preprocesses a list of clouds in a pipeline: an I/O thread reads the next files
+ * while a compute thread preprocesses the previous ones (smoothing, normals), and the
+ * finished clouds are handed to the consumer in the same order as the input list. Both
+ * stages are connected through bounded queues, so at most about twice the queue size clouds
+ * are held in memory at any time.
+ */
+class BatchLoader
+{
+public:
+	/**************************************************/
+	BatchLoader(const std::vector<std::string> &filenames_,
+				const double normalEstimationRadius_,
+				const CloudSmoothingParams &params_,
+				const int queueSize_ = -1,
+				const bool buildGraph_ = false,
+				const double graphRadius_ = -1);
+
+	/**************************************************/
+	~BatchLoader();
+
+	/**************************************************/
+	bool next(LoadedCloud &cloud_);
+
+	/**************************************************/
+	void stop();
+
+private:
+	/**
+	 * Structure holding a cloud between the reading and the preprocessing stages
+	 */
+	struct RawCloud
+	{
+		std::string filename; // File the cloud was read from
+		std::string entry; // Cache entry of the preprocessed cloud (empty if not cached)
+		bool readOk; // Flag indicating if the file was properly read
+		bool cached; // Flag indicating if the preprocessed cloud came from the cache
+		pcl::PointCloud<pcl::PointXYZ>::Ptr points; // Raw points
+		pcl::PointCloud<pcl::PointNormal>::Ptr preprocessed; // Preprocessed cloud (when cached)
+		CloudSmoothingParams pending; // Preprocessing left after the reading
+
+		/**************************************************/
+		RawCloud()
+		{
+			readOk = false;
+			cached = false;
+		}
+	};
+
+	/**************************************************/
+	void readLoop();
+
+	/**************************************************/
+	void preprocessLoop();
+
+
+	std::vector<std::string> filenames; // Files to load
+	double normalEstimationRadius; // Radius used for the normal estimation
+	CloudSmoothingParams params; // Smoothing params
+	bool buildGraph; // Flag indicating if the neighbor graph has to be delivered with each cloud
+	double graphRadius; // Minimum radius of the delivered graph
+
+	BoundedQueue<RawCloud> readQueue; // Clouds read and waiting to be preprocessed
+	BoundedQueue<LoadedCloud> outputQueue; // Clouds ready for the consumer
+	boost::thread reader; // I/O thread
+	boost::thread preprocessor; // Compute thread
+};
@@ -0,0 +1,38 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+
+/**
+ * Reads and writes float matrices in the binary format used for the descriptor caches, centers
+ * and codebooks. The files are valid .npy (version 1.0, or 2.0 for very long headers) files,
+ * so they can be opened directly with numpy.load. The metadata lines are stored as comments
+ * after the header's dictionary, and the data (little endian, row major) starts at a 64 bytes
+ * aligned offset so it can be copied straight out of a memory mapping of the file.
+ */
+class BinaryMatrix
+{
+public:
+	/**************************************************/
+	static bool isBinary(const std::string &filename_);
+
+	/**************************************************/
+	static bool write(const std::string &filename_,
+					  const cv::Mat &matrix_,
+					  const std::vector<std::string> &metadata_);
+
+	/**************************************************/
+	static bool read(const std::string &filename_,
+					 cv::Mat &matrix_,
+					 std::vector<std::string> *metadata_ = NULL);
+
+private:
+	BinaryMatrix();
+	~BinaryMatrix();
+};
@@ -0,0 +1,51 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <string>
+
+
+/**
+ * Exclusive lock over a single cache entry, shared between threads and processes. It's taken
+ * after a cache miss and held while the entry is computed and written, so any other run missing
+ * the same entry waits for it (and then reads it from the cache) instead of computing it again:
+ *
+ *		if (!Loader::loadDescriptors(...))
+ *		{
+ *			CacheLock lock(entryFilename);
+ *			if (!Loader::loadDescriptors(...))
+ *			{
+ *				// compute the descriptors
+ *				Writer::writeDescriptorsCache(...);
+ *			}
+ *		}
+ *
+ * The lock is an flock over a hidden file next to the entry, so the system releases it if the
+ * owner dies and no stale lock can block other runs.
+ */
+class CacheLock
+{
+public:
+	CacheLock(const std::string &entryFilename_);
+	~CacheLock();
+
+	/**************************************************/
+	inline bool isLocked() const
+	{
+		return fileDescriptor >= 0;
+	}
+
+	/**************************************************/
+	static std::string getLockFilename(const std::string &entryFilename_);
+
+private:
+	// Non copyable, since the lock is released on destruction
+	CacheLock(const CacheLock &other_);
+	CacheLock &operator=(const CacheLock &other_);
+
+
+	std::string filename; // File used for the lock
+	int fileDescriptor; // Descriptor of the locked file (negative if not locked)
+};
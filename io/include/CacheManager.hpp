@@ -0,0 +1,107 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <string>
+#include <map>
+#include <stdint.h>
+#include <boost/thread/mutex.hpp>
+
+
+/**
+ * Keeps track of the entries of the cache directory (descriptors and preprocessed clouds), with
+ * their size and last access time. Every access is appended to an index file in the directory (the
+ * last line of an entry wins), and once the directory exceeds the configured size limit the least
+ * recently used entries are removed. Hits, misses and the bytes served from the cache are counted
+ * and logged when the program exits.
+ */
+class CacheManager
+{
+public:
+	~CacheManager() {};
+
+	/**************************************************/
+	static CacheManager *getInstance()
+	{
+		static CacheManager instance;
+		return &instance;
+	}
+
+	/**************************************************/
+	static void registerHit(const std::string &cacheLocation_,
+							const std::string &filename_);
+
+	/**************************************************/
+	static void registerMiss(const std::string &cacheLocation_,
+							 const std::string &filename_);
+
+	/**************************************************/
+	static void registerWrite(const std::string &cacheLocation_,
+							  const std::string &filename_);
+
+	/**************************************************/
+	static uint64_t getHits()
+	{
+		return getInstance()->hits;
+	}
+
+	/**************************************************/
+	static uint64_t getMisses()
+	{
+		return getInstance()->misses;
+	}
+
+	/**************************************************/
+	static uint64_t getBytesSaved()
+	{
+		return getInstance()->bytesSaved;
+	}
+
+	/**************************************************/
+	static uint64_t getCacheSize(const std::string &cacheLocation_);
+
+	/**************************************************/
+	static void logStats();
+
+private:
+	/**
+	 * Structure holding the state of an entry of the cache
+	 */
+	struct Entry
+	{
+		int64_t size; // Size of the entry in bytes
+		int64_t lastAccess; // Last time the entry was read or written (microseconds since epoch)
+	};
+
+	CacheManager()
+	{
+		hits = misses = bytesSaved = 0;
+		totalSize = 0;
+		statsRegistered = false;
+	}
+
+	/**************************************************/
+	void load(const std::string &cacheLocation_);
+
+	/**************************************************/
+	void touch(const std::string &name_,
+			   const int64_t size_);
+
+	/**************************************************/
+	void evict(const std::string &keep_);
+
+	/**************************************************/
+	void registerStats();
+
+
+	std::map<std::string, Entry> entries; // Entries in the cache, by file name
+	std::string location; // Cache directory currently tracked
+	int64_t totalSize; // Bytes used by all the entries
+	uint64_t hits; // Entries found in the cache
+	uint64_t misses; // Entries not found in the cache
+	uint64_t bytesSaved; // Bytes read from the cache instead of being computed
+	bool statsRegistered; // Flag indicating if the stats have been scheduled to be logged at exit
+	boost::mutex mutex; // Mutex protecting the manager
+};
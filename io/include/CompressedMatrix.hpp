@@ -0,0 +1,53 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+
+/**
+ * Reads and writes float matrices split in blocks of rows, each one compressed independently
+ * with zlib. The bytes of the floats in each block are shuffled (all the first bytes, then all
+ * the second ones, etc) before the compression, which groups the exponents and makes sparse
+ * descriptors (histograms, SHOT) compress much better. Since the blocks are independent, they
+ * are decompressed in parallel and any range of rows can be read without inflating the whole
+ * file.
+ */
+class CompressedMatrix
+{
+public:
+	/**************************************************/
+	static bool isCompressed(const std::string &filename_);
+
+	/**************************************************/
+	static bool write(const std::string &filename_,
+					  const cv::Mat &matrix_,
+					  const std::vector<std::string> &metadata_,
+					  const int rowsPerBlock_ = -1);
+
+	/**************************************************/
+	static bool read(const std::string &filename_,
+					 cv::Mat &matrix_,
+					 std::vector<std::string> *metadata_ = NULL);
+
+	/**************************************************/
+	static bool readRows(const std::string &filename_,
+						 const int firstRow_,
+						 const int rowNumber_,
+						 cv::Mat &matrix_);
+
+private:
+	CompressedMatrix();
+	~CompressedMatrix();
+
+	/**************************************************/
+	static bool load(const std::string &filename_,
+					 const int firstRow_,
+					 const int rowNumber_,
+					 cv::Mat &matrix_,
+					 std::vector<std::string> *metadata_);
+};
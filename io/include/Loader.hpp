@@ -9,6 +9,37 @@
 #include <opencv2/core/core.hpp>
 #include <string>
 #include "DescriptorParams.hpp"
+#include "NeighborGraph.hpp"
+
+
+/**
+ * Structure describing a spatial tile written by Loader::tileCloud
+ */
+struct CloudTile
+{
+	std::string filename; // File holding the points of the tile (margin included)
+	Eigen::Vector3f minCorner; // Minimum corner of the tile's core box
+	Eigen::Vector3f maxCorner; // Maximum corner of the tile's core box
+	size_t points; // Points in the tile (margin included)
+
+	/**************************************************/
+	CloudTile()
+	{
+		minCorner = maxCorner = Eigen::Vector3f::Zero();
+		points = 0;
+	}
+
+	/**************************************************/
+	bool contains(const pcl::PointXYZ &point_) const
+	{
+		return point_.x >= minCorner.x() && point_.x < maxCorner.x()
+			   && point_.y >= minCorner.y() && point_.y < maxCorner.y()
+			   && point_.z >= minCorner.z() && point_.z < maxCorner.z();
+	}
+
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
 
 class Loader
 {
@@ -26,11 +57,93 @@ public:
 								const CloudSmoothingParams &smoothingParams_,
 								cv::Mat &descriptors_);
 
+	/**************************************************/
+	static bool loadCloudCache(const std::string &cacheLocation_,
+							   const std::string &cloudInputFilename_,
+							   const double normalEstimationRadius_,
+							   const CloudSmoothingParams &smoothingParams_,
+							   pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_);
+
+	/**************************************************/
+	static bool loadCloudCache(const std::string &cacheLocation_,
+							   const std::string &cacheFilename_,
+							   const std::string &cloudInputFilename_,
+							   const double normalEstimationRadius_,
+							   const CloudSmoothingParams &smoothingParams_,
+							   pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_);
+
+	/**************************************************/
+	static std::string getCloudCacheFilename(const std::string &cacheLocation_,
+											 const std::string &cloudInputFilename_,
+											 const double normalEstimationRadius_,
+											 const CloudSmoothingParams &smoothingParams_);
+
+	/**************************************************/
+	static bool cloudCacheEnabled();
+
+	/**************************************************/
+	static std::string getCloudCacheEntry(const std::string &cloudInputFilename_,
+										  const double normalEstimationRadius_,
+										  const CloudSmoothingParams &smoothingParams_);
+
+	/**************************************************/
+	static bool loadCachedCloud(const std::string &filename_,
+								const std::string &cacheFilename_,
+								const double normalEstimationRadius_,
+								const CloudSmoothingParams &params_,
+								pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+								NeighborGraphPtr *graph_ = NULL,
+								const double graphRadius_ = -1);
+
+	/**************************************************/
+	static bool readCloud(const std::string &filename_,
+						  pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_);
+
+	/**************************************************/
+	static bool readCloud(const std::string &filename_,
+						  CloudSmoothingParams &params_,
+						  pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_);
+
+	/**************************************************/
+	static bool streamDownsample(const std::string &filename_,
+								 const double voxelSize_,
+								 pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_,
+								 const int chunkSize_ = -1);
+
+	/**************************************************/
+	static bool tileCloud(const std::string &filename_,
+						  const double tileSize_,
+						  const double margin_,
+						  const std::string &outputDirectory_,
+						  std::vector<CloudTile> &tiles_,
+						  const int chunkSize_ = -1);
+
+	/**************************************************/
+	static void preprocessCloud(pcl::PointCloud<pcl::PointXYZ>::Ptr cloudXYZ_,
+								const double normalEstimationRadius_,
+								const CloudSmoothingParams &params_,
+								pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+								NeighborGraphPtr *graph_ = NULL,
+								const double graphRadius_ = -1);
+
+	/**************************************************/
+	static bool preprocessAndCache(const std::string &filename_,
+								   const std::string &cacheFilename_,
+								   const double normalEstimationRadius_,
+								   const CloudSmoothingParams &params_,
+								   pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+								   NeighborGraphPtr *graph_ = NULL,
+								   const double graphRadius_ = -1,
+								   pcl::PointCloud<pcl::PointXYZ>::Ptr cloudXYZ_ = pcl::PointCloud<pcl::PointXYZ>::Ptr(),
+								   const CloudSmoothingParams *pending_ = NULL);
+
 	/**************************************************/
 	static bool loadCloud(const std::string &filename_,
 						  const double normalEstimationRadius_,
 						  const CloudSmoothingParams &params_,
-						  pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_);
+						  pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+						  NeighborGraphPtr *graph_ = NULL,
+						  const double graphRadius_ = -1);
 
 	/**************************************************/
 	static void traverseDirectory(const std::string &inputDirectory_,
@@ -40,4 +153,11 @@ public:
 private:
 	Loader();
 	~Loader();
+
+	/**************************************************/
+	static bool hasLegacyCacheEntries(const std::string &cacheLocation_);
+
+	/**************************************************/
+	static void migrateCacheEntry(const std::string &legacyFilename_,
+								  const std::string &filename_);
 };
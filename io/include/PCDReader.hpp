@@ -0,0 +1,89 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include "ExecutionParams.hpp"
+
+
+/**
+ * Structure holding the header of a PCD file
+ */
+struct PCDHeader
+{
+	std::vector<std::string> fields; // Name of each field
+	std::vector<int> sizes; // Size in bytes of each field
+	std::vector<char> types; // Type of each field (F, I or U)
+	std::vector<int> counts; // Elements of each field
+	int width; // Width of the cloud
+	int height; // Height of the cloud (1 for unorganized clouds)
+	size_t points; // Total number of points
+	Params::PCDEncoding encoding; // Encoding of the data section
+	size_t dataOffset; // Position in the file where the data starts
+	Eigen::Vector4f origin; // Sensor's origin
+	Eigen::Quaternionf orientation; // Sensor's orientation
+
+	/**************************************************/
+	PCDHeader()
+	{
+		width = height = 0;
+		points = 0;
+		encoding = Params::PCD_ASCII;
+		dataOffset = 0;
+		origin = Eigen::Vector4f::Zero();
+		orientation = Eigen::Quaternionf::Identity();
+	}
+
+	/**************************************************/
+	int getFieldIndex(const std::string &name_) const
+	{
+		for (size_t i = 0; i < fields.size(); i++)
+			if (fields[i] == name_)
+				return i;
+		return -1;
+	}
+
+	/**************************************************/
+	size_t getFieldOffset(const int index_) const
+	{
+		size_t offset = 0;
+		for (int i = 0; i < index_; i++)
+			offset += sizes[i] * counts[i];
+		return offset;
+	}
+
+	/**************************************************/
+	size_t getPointSize() const
+	{
+		return getFieldOffset(fields.size());
+	}
+
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+
+class PCDReader
+{
+public:
+	/**************************************************/
+	static bool readHeader(const std::string &filename_,
+						   PCDHeader &header_);
+
+	/**************************************************/
+	static bool read(const std::string &filename_,
+					 pcl::PointCloud<pcl::PointXYZ> &cloud_);
+
+private:
+	PCDReader();
+	~PCDReader();
+
+	/**************************************************/
+	static bool readMapped(const std::string &filename_,
+						   const PCDHeader &header_,
+						   pcl::PointCloud<pcl::PointXYZ> &cloud_);
+};
@@ -0,0 +1,78 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include "PCDReader.hpp"
+
+
+/**
+ * Reads the points of a PCD file in fixed size chunks, so clouds larger than the available
+ * memory can be processed without materializing them. ASCII and uncompressed binary files are
+ * supported (compressed files are stored as a single block and can't be streamed).
+ */
+class PCDStreamReader
+{
+public:
+	/**************************************************/
+	PCDStreamReader();
+
+	/**************************************************/
+	~PCDStreamReader();
+
+	/**************************************************/
+	bool open(const std::string &filename_);
+
+	/**************************************************/
+	size_t read(pcl::PointCloud<pcl::PointXYZ> &chunk_,
+				const size_t maxPoints_);
+
+	/**************************************************/
+	void close();
+
+	/**************************************************/
+	bool isOpen() const
+	{
+		return file.is_open();
+	}
+
+	/**************************************************/
+	bool finished() const
+	{
+		return pointsRead >= header.points;
+	}
+
+	/**************************************************/
+	const PCDHeader &getHeader() const
+	{
+		return header;
+	}
+
+	/**************************************************/
+	size_t getPointsRead() const
+	{
+		return pointsRead;
+	}
+
+private:
+	/**************************************************/
+	size_t readASCII(pcl::PointCloud<pcl::PointXYZ> &chunk_,
+					 const size_t maxPoints_);
+
+	/**************************************************/
+	size_t readBinary(pcl::PointCloud<pcl::PointXYZ> &chunk_,
+					  const size_t maxPoints_);
+
+
+	std::ifstream file; // Stream over the file being read
+	PCDHeader header; // Header of the file being read
+	size_t pointsRead; // Points delivered so far
+	size_t offsets[3]; // Offset of the coordinates (bytes in binary files, columns in ASCII files)
+	std::vector<char> buffer; // Staging buffer for the binary records
+};
@@ -0,0 +1,45 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+
+/**
+ * Reads and writes float matrices in the text format used for the descriptor caches, centers
+ * and codebooks (metadata lines, dimensions and one row of values per line). When reading, the
+ * file is memory mapped and its data section split into line aligned chunks that are parsed in
+ * parallel with a locale independent float parser, straight into the preallocated matrix. When
+ * writing, each value is printed with the fewest digits that read back to the same float, and
+ * blocks of rows are formatted in parallel into reusable buffers written with a single call.
+ */
+class TextMatrix
+{
+public:
+	/**************************************************/
+	static bool read(const std::string &filename_,
+					 cv::Mat &matrix_,
+					 std::vector<std::string> *metadata_ = NULL);
+
+	/**************************************************/
+	static bool write(const std::string &filename_,
+					  const cv::Mat &matrix_,
+					  const std::vector<std::string> &metadata_);
+
+	/**************************************************/
+	static int formatFloat(const float value_,
+						   char *buffer_);
+
+	/**************************************************/
+	static bool parseFloat(const char *begin_,
+						   const char *end_,
+						   float &value_);
+
+private:
+	TextMatrix();
+	~TextMatrix();
+};
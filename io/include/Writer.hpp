@@ -23,7 +23,7 @@ public:
 							   const double upperBound_);
 
 	/**************************************************/
-	static void writeOuputData(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+	static bool writeOuputData(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 							   const std::vector<BandPtr> &bands_,
 							   const DescriptorParamsPtr &params_,
 							   const int targetPoint_);
@@ -34,7 +34,7 @@ public:
 							 const std::vector<double> &sse_);
 
 	/**************************************************/
-	static void writeClusteredCloud(const std::string &filename_,
+	static bool writeClusteredCloud(const std::string &filename_,
 									const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 									const cv::Mat &labels_);
 
@@ -46,14 +46,14 @@ public:
 									const MetricPtr &metric_);
 
 	/**************************************************/
-	static void writeClustersCenters(const std::string &filename_,
+	static bool writeClustersCenters(const std::string &filename_,
 									 const cv::Mat &centers_,
 									 const DescriptorParamsPtr &descriptorParams_,
 									 const ClusteringParams &clusteringParams_,
 									 const CloudSmoothingParams &smoothingParams_);
 
 	/**************************************************/
-	static void writeCodebook(const std::string &filename_,
+	static bool writeCodebook(const std::string &filename_,
 							  const cv::Mat &centers_,
 							  const ClusteringParams &clusteringParams_,
 							  const Params::DescriptorType &type_,
@@ -63,13 +63,25 @@ public:
 							  const bool bidirectional_ = false);
 
 	/**************************************************/
-	static void writeDescriptorsCache(const cv::Mat &descriptors_,
+	static bool writeDescriptorsCache(const cv::Mat &descriptors_,
 									  const std::string &cacheLocation_,
 									  const std::string &cloudInputFilename_,
 									  const double normalEstimationRadius_,
 									  const DescriptorParamsPtr &descriptorParams_,
 									  const CloudSmoothingParams &smoothingParams_);
 
+	/**************************************************/
+	static void writeCloudCache(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+								const std::string &cacheLocation_,
+								const std::string &cloudInputFilename_,
+								const double normalEstimationRadius_,
+								const CloudSmoothingParams &smoothingParams_);
+
+	/**************************************************/
+	static void writeCloudCache(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+								const std::string &cacheLocation_,
+								const std::string &destination_);
+
 	/**************************************************/
 	static void saveCloudMatrix(const std::string &filename_,
 								const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_);
@@ -81,10 +93,14 @@ private:
 	~Writer();
 
 	/**************************************************/
-	static void writeMatrix(const std::string &filename_,
+	static bool writeMatrix(const std::string &filename_,
 							const cv::Mat &matrix_,
 							const std::vector<std::string> &metadata_ = std::vector<std::string>());
 
+	/**************************************************/
+	static bool publish(const std::string &temporary_,
+						const std::string &destination_);
+
 	/**************************************************/
 	static void generateHistogramScript(const std::string &outputFolder_,
 										const std::string &histogramTitle_,
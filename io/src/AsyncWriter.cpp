@@ -0,0 +1,210 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include "AsyncWriter.hpp"
+#include <iostream>
+#include <boost/bind.hpp>
+#include <plog/Log.h>
+#include "Writer.hpp"
+#include "Config.hpp"
+
+
+AsyncWriter::~AsyncWriter()
+{
+	if (!queue || !worker.joinable())
+		return;
+
+	/**
+	 * Destroyed at exit without a shutdown. The writes may depend on singletons already gone, so
+	 * only the one in progress is finished (std::cerr is used since the logger may be gone too)
+	 */
+	size_t pending = 0;
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		discarding = true;
+		pending = submitted - completed;
+	}
+	if (pending > 0)
+		std::cerr << "WARNING: AsyncWriter destroyed without a shutdown, up to " << pending << " pending writes dropped" << std::endl;
+
+	queue->close();
+	worker.join();
+}
+
+void AsyncWriter::writeOuputData(pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+								 std::vector<BandPtr> &bands_,
+								 const DescriptorParamsPtr &params_,
+								 const int targetPoint_)
+{
+	pcl::PointCloud<pcl::PointNormal>::Ptr cloud;
+	cloud.swap(cloud_);
+	std::vector<BandPtr> bands;
+	bands.swap(bands_);
+
+	submit("output data", boost::bind(&Writer::writeOuputData, cloud, bands, params_, targetPoint_));
+}
+
+void AsyncWriter::writeClusteredCloud(const std::string &filename_,
+									  pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+									  cv::Mat &labels_)
+{
+	pcl::PointCloud<pcl::PointNormal>::Ptr cloud;
+	cloud.swap(cloud_);
+	cv::Mat labels = labels_;
+	labels_.release();
+
+	submit(filename_, boost::bind(&Writer::writeClusteredCloud, filename_, cloud, labels));
+}
+
+void AsyncWriter::writeClustersCenters(const std::string &filename_,
+									   cv::Mat &centers_,
+									   const DescriptorParamsPtr &descriptorParams_,
+									   const ClusteringParams &clusteringParams_,
+									   const CloudSmoothingParams &smoothingParams_)
+{
+	cv::Mat centers = centers_;
+	centers_.release();
+
+	submit(filename_, boost::bind(&Writer::writeClustersCenters, filename_, centers, descriptorParams_, clusteringParams_, smoothingParams_));
+}
+
+void AsyncWriter::writeCodebook(const std::string &filename_,
+								cv::Mat &centers_,
+								const ClusteringParams &clusteringParams_,
+								const Params::DescriptorType &type_,
+								const float searchRadius_,
+								const int nbands_,
+								const int nbins_,
+								const bool bidirectional_)
+{
+	cv::Mat centers = centers_;
+	centers_.release();
+
+	submit(filename_, boost::bind(&Writer::writeCodebook, filename_, centers, clusteringParams_, type_, searchRadius_, nbands_, nbins_, bidirectional_));
+}
+
+void AsyncWriter::writeDescriptorsCache(cv::Mat &descriptors_,
+										const std::string &cacheLocation_,
+										const std::string &cloudInputFilename_,
+										const double normalEstimationRadius_,
+										const DescriptorParamsPtr &descriptorParams_,
+										const CloudSmoothingParams &smoothingParams_)
+{
+	cv::Mat descriptors = descriptors_;
+	descriptors_.release();
+
+	submit("descriptors cache of " + cloudInputFilename_, boost::bind(&Writer::writeDescriptorsCache, descriptors, cacheLocation_, cloudInputFilename_, normalEstimationRadius_, descriptorParams_, smoothingParams_));
+}
+
+bool AsyncWriter::flush(std::vector<std::string> *errors_)
+{
+	AsyncWriter *writer = getInstance();
+	boost::unique_lock<boost::mutex> lock(writer->mutex);
+
+	// Only the writes queued so far are waited for
+	size_t target = writer->submitted;
+	while (writer->completed < target)
+		writer->done.wait(lock);
+
+	bool flushOk = writer->errors.empty();
+	if (errors_ != NULL)
+		errors_->insert(errors_->end(), writer->errors.begin(), writer->errors.end());
+	writer->errors.clear();
+
+	return flushOk;
+}
+
+void AsyncWriter::shutdown()
+{
+	AsyncWriter *writer = getInstance();
+	BoundedQueue<JobPtr> *queue = NULL;
+	{
+		boost::mutex::scoped_lock lock(writer->mutex);
+		writer->stopped = true;
+		queue = writer->queue.get();
+	}
+
+	// The queue is drained before the worker finishes
+	if (queue != NULL)
+	{
+		queue->close();
+		if (writer->worker.joinable())
+			writer->worker.join();
+	}
+
+	std::vector<std::string> errors;
+	if (!flush(&errors))
+		LOGE << errors.size() << " background writes failed";
+}
+
+void AsyncWriter::submit(const std::string &description_,
+						 const boost::function<bool ()> &write_)
+{
+	AsyncWriter *writer = getInstance();
+	JobPtr job(new Job());
+	job->description = description_;
+	job->write = write_;
+
+	bool queued = false;
+	{
+		boost::mutex::scoped_lock lock(writer->mutex);
+		writer->submitted++;
+
+		// The service is started with the first write
+		int capacity = Config::getOutputQueueSize();
+		if (!writer->queue && capacity > 0 && !writer->stopped)
+		{
+			writer->queue.reset(new BoundedQueue<JobPtr>(capacity));
+			writer->worker = boost::thread(boost::bind(&AsyncWriter::writeLoop, writer));
+		}
+		queued = writer->queue && !writer->stopped;
+	}
+
+	// Synchronous if there's no service (or it has been closed meanwhile)
+	if (!queued || !writer->queue->push(job))
+		writer->run(job);
+}
+
+void AsyncWriter::run(const JobPtr &job_)
+{
+	bool writeOk = false;
+	std::string error = "write failed";
+	try
+	{
+		writeOk = job_->write();
+	}
+	catch (std::exception &_ex)
+	{
+		error = _ex.what();
+	}
+
+	boost::mutex::scoped_lock lock(mutex);
+	if (!writeOk)
+	{
+		LOGE << "Unable to write " << job_->description << ": " << error;
+		errors.push_back(job_->description + ": " + error);
+	}
+
+	completed++;
+	done.notify_all();
+}
+
+void AsyncWriter::writeLoop()
+{
+	JobPtr job;
+	while (queue->pop(job))
+	{
+		bool discard = false;
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			discard = discarding;
+		}
+
+		if (!discard)
+			run(job);
+
+		// Release the data before blocking on an empty queue
+		job.reset();
+	}
+}
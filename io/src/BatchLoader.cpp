@@ -0,0 +1,133 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include "BatchLoader.hpp"
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <plog/Log.h>
+#include "Loader.hpp"
+#include "CloudUtils.hpp"
+#include "Config.hpp"
+
+
+static inline size_t queueCapacity(const int queueSize_)
+{
+	return queueSize_ > 0 ? queueSize_ : Config::getBatchQueueSize();
+}
+
+BatchLoader::BatchLoader(const std::vector<std::string> &filenames_,
+						 const double normalEstimationRadius_,
+						 const CloudSmoothingParams &params_,
+						 const int queueSize_,
+						 const bool buildGraph_,
+						 const double graphRadius_)
+	: readQueue(queueCapacity(queueSize_)), outputQueue(queueCapacity(queueSize_))
+{
+	filenames = filenames_;
+	normalEstimationRadius = normalEstimationRadius_;
+	params = params_;
+	buildGraph = buildGraph_;
+	graphRadius = graphRadius_;
+
+	reader = boost::thread(boost::bind(&BatchLoader::readLoop, this));
+	preprocessor = boost::thread(boost::bind(&BatchLoader::preprocessLoop, this));
+}
+
+BatchLoader::~BatchLoader()
+{
+	stop();
+}
+
+bool BatchLoader::next(LoadedCloud &cloud_)
+{
+	return outputQueue.pop(cloud_);
+}
+
+void BatchLoader::stop()
+{
+	// Closing the queues unblocks both stages, which then finish without processing anything else
+	readQueue.close();
+	outputQueue.close();
+
+	if (reader.joinable())
+		reader.join();
+	if (preprocessor.joinable())
+		preprocessor.join();
+}
+
+void BatchLoader::readLoop()
+{
+	for (size_t i = 0; i < filenames.size(); i++)
+	{
+		RawCloud raw;
+		raw.filename = filenames[i];
+
+		try
+		{
+			// Already preprocessed clouds skip the compute stage (besides the graph)
+			raw.entry = Loader::getCloudCacheEntry(raw.filename, normalEstimationRadius, params);
+			raw.preprocessed.reset(new pcl::PointCloud<pcl::PointNormal>());
+			if (!raw.entry.empty() && Loader::loadCloudCache(Config::getCacheDirectory(), raw.entry, raw.filename, normalEstimationRadius, params, raw.preprocessed))
+				raw.readOk = raw.cached = true;
+			else
+			{
+				raw.preprocessed.reset();
+				raw.pending = params;
+				raw.readOk = Loader::readCloud(raw.filename, raw.pending, raw.points);
+			}
+		}
+		catch (std::exception &_ex)
+		{
+			LOGE << "Unable to read " << raw.filename << ": " << _ex.what();
+			raw.readOk = false;
+		}
+
+		if (!readQueue.push(raw))
+			return;
+	}
+
+	readQueue.close();
+}
+
+void BatchLoader::preprocessLoop()
+{
+	RawCloud raw;
+	while (readQueue.pop(raw))
+	{
+		LoadedCloud loaded;
+		loaded.filename = raw.filename;
+		loaded.loadOk = raw.readOk;
+
+		try
+		{
+			if (raw.cached)
+			{
+				loaded.cloud = raw.preprocessed;
+
+				// Same graph the preprocessing delivers (none without a positive radius)
+				double radius = std::max(normalEstimationRadius, graphRadius);
+				if (buildGraph && radius > 0)
+					loaded.graph = CloudUtils::buildNeighborGraph<pcl::PointNormal>(loaded.cloud, radius, CloudUtils::getSearchBackend(loaded.cloud->isOrganized()));
+			}
+			else if (raw.readOk)
+			{
+				loaded.cloud.reset(new pcl::PointCloud<pcl::PointNormal>());
+				Loader::preprocessAndCache(loaded.filename, raw.entry, normalEstimationRadius, params, loaded.cloud, buildGraph ? &loaded.graph : NULL, graphRadius, raw.points, &raw.pending);
+			}
+		}
+		catch (std::exception &_ex)
+		{
+			LOGE << "Unable to preprocess " << raw.filename << ": " << _ex.what();
+			loaded.loadOk = false;
+		}
+
+		// Release the raw points before blocking on a full output queue
+		raw = RawCloud();
+
+		if (!outputQueue.push(loaded))
+			return;
+	}
+
+	outputQueue.close();
+}
@@ -0,0 +1,190 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include "BinaryMatrix.hpp"
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <boost/algorithm/string.hpp>
+#include <plog/Log.h>
+
+
+#define NPY_MAGIC				"\x93NUMPY"
+#define NPY_MAGIC_LENGTH		6
+#define NPY_PREAMBLE_V1			10
+#define NPY_PREAMBLE_V2			12
+#define NPY_ALIGNMENT			64
+#define MATRIX_FORMAT_VERSION	1
+
+
+static inline bool littleEndian()
+{
+	uint16_t value = 1;
+	return *((uint8_t *) &value) == 1;
+}
+
+static inline size_t alignedSize(const size_t size_)
+{
+	return ((size_ + NPY_ALIGNMENT - 1) / NPY_ALIGNMENT) * NPY_ALIGNMENT;
+}
+
+static inline uint32_t readLittleEndian(const unsigned char *data_,
+										const int bytes_)
+{
+	uint32_t value = 0;
+	for (int i = bytes_ - 1; i >= 0; i--)
+		value = (value << 8) | data_[i];
+	return value;
+}
+
+bool BinaryMatrix::isBinary(const std::string &filename_)
+{
+	std::ifstream file(filename_.c_str(), std::ios::in | std::ios::binary);
+	char magic[NPY_MAGIC_LENGTH];
+	return file.read(magic, NPY_MAGIC_LENGTH) && memcmp(magic, NPY_MAGIC, NPY_MAGIC_LENGTH) == 0;
+}
+
+bool BinaryMatrix::write(const std::string &filename_,
+						 const cv::Mat &matrix_,
+						 const std::vector<std::string> &metadata_)
+{
+	if (matrix_.type() != CV_32FC1)
+	{
+		LOGE << "Only float matrices can be written in binary format";
+		return false;
+	}
+
+	if (!littleEndian())
+	{
+		LOGE << "Binary matrices can only be written on little endian hosts";
+		return false;
+	}
+
+	// Dictionary expected by numpy, followed by the metadata as comments
+	std::ostringstream header;
+	header << "{'descr': '<f4', 'fortran_order': False, 'shape': (" << matrix_.rows << ", " << matrix_.cols << "), }\n";
+	header << "# format_version " << MATRIX_FORMAT_VERSION << "\n";
+	header << "# metadata_lines " << metadata_.size() << "\n";
+	for (size_t i = 0; i < metadata_.size(); i++)
+		header << "# " << metadata_[i] << "\n";
+
+	// Pad the header so the data starts at an aligned offset (the header must end with a new line)
+	std::string text = header.str();
+	size_t preamble = NPY_PREAMBLE_V1;
+	if (alignedSize(preamble + text.size() + 1) - preamble > 0xFFFF)
+		preamble = NPY_PREAMBLE_V2; // The header's length doesn't fit in 16 bits
+	text += std::string(alignedSize(preamble + text.size() + 1) - preamble - text.size() - 1, ' ') + "\n";
+
+	std::ofstream file(filename_.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	uint32_t length = text.size();
+	file.write(NPY_MAGIC, NPY_MAGIC_LENGTH);
+	file.put(preamble == NPY_PREAMBLE_V1 ? 1 : 2);
+	file.put(0);
+	file.write((const char *) &length, preamble - NPY_MAGIC_LENGTH - 2);
+	file.write(text.c_str(), text.size());
+
+	// Strided matrices (views over clouds) are written row by row
+	if (matrix_.isContinuous())
+		file.write((const char *) matrix_.data, matrix_.total() * sizeof(float));
+	else
+		for (int i = 0; i < matrix_.rows; i++)
+			file.write((const char *) matrix_.ptr<float>(i), matrix_.cols * sizeof(float));
+
+	file.close();
+	return !file.fail();
+}
+
+bool BinaryMatrix::read(const std::string &filename_,
+						cv::Mat &matrix_,
+						std::vector<std::string> *metadata_)
+{
+	int fileDescriptor = open(filename_.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat statbuf;
+	if (fstat(fileDescriptor, &statbuf) < 0 || (size_t) statbuf.st_size < NPY_PREAMBLE_V1)
+	{
+		close(fileDescriptor);
+		return false;
+	}
+
+	size_t fileSize = statbuf.st_size;
+	const unsigned char *buffer = (const unsigned char *) mmap(0, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	close(fileDescriptor);
+	if (buffer == MAP_FAILED)
+		return false;
+	madvise((void *) buffer, fileSize, MADV_SEQUENTIAL);
+
+	bool loadOk = false;
+	try
+	{
+		if (memcmp(buffer, NPY_MAGIC, NPY_MAGIC_LENGTH) != 0)
+			throw std::runtime_error("not a binary matrix file");
+
+		int major = buffer[NPY_MAGIC_LENGTH];
+		size_t preamble = major == 1 ? NPY_PREAMBLE_V1 : NPY_PREAMBLE_V2;
+		size_t headerLength = readLittleEndian(buffer + NPY_MAGIC_LENGTH + 2, preamble - NPY_MAGIC_LENGTH - 2);
+		if (preamble + headerLength > fileSize)
+			throw std::runtime_error("truncated header");
+
+		std::string header((const char *) buffer + preamble, headerLength);
+		if (header.find("'descr': '<f4'") == std::string::npos || header.find("'fortran_order': False") == std::string::npos)
+			throw std::runtime_error("only little endian, row major, float matrices are supported");
+
+		int rows = 0, cols = 0;
+		size_t shape = header.find("'shape': (");
+		if (shape == std::string::npos || sscanf(header.c_str() + shape, "'shape': (%d, %d)", &rows, &cols) != 2)
+			throw std::runtime_error("unsupported matrix shape");
+
+		// Recover the metadata lines from the comments
+		std::vector<std::string> lines;
+		boost::split(lines, header, boost::is_any_of("\n"));
+		int metadataLines = 0;
+		for (size_t i = 0; i < lines.size(); i++)
+		{
+			if (!boost::starts_with(lines[i], "# "))
+				continue;
+
+			std::string line = lines[i].substr(2);
+			if (boost::starts_with(line, "format_version "))
+			{
+				if (atoi(line.c_str() + 15) > MATRIX_FORMAT_VERSION)
+					throw std::runtime_error("unsupported format version " + line.substr(15));
+			}
+			else if (boost::starts_with(line, "metadata_lines "))
+				metadataLines = atoi(line.c_str() + 15);
+			else if (metadataLines-- > 0 && metadata_ != NULL)
+				metadata_->push_back(line);
+		}
+
+		size_t dataSize = (size_t) rows * cols * sizeof(float);
+		if (preamble + headerLength + dataSize > fileSize)
+			throw std::runtime_error("truncated data");
+
+		// Single copy from the mapped pages into the matrix
+		matrix_ = cv::Mat(rows, cols, CV_32FC1);
+		if (dataSize > 0)
+			memcpy(matrix_.data, buffer + preamble + headerLength, dataSize);
+		loadOk = true;
+	}
+	catch (std::exception &_ex)
+	{
+		LOGE << "Unable to read binary matrix " << filename_ << ": " << _ex.what();
+	}
+
+	munmap((void *) buffer, fileSize);
+	return loadOk;
+}
@@ -0,0 +1,75 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include "CacheLock.hpp"
+#include <cerrno>
+#include <cstring>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
+#include <plog/Log.h>
+
+
+CacheLock::CacheLock(const std::string &entryFilename_)
+{
+	filename = getLockFilename(entryFilename_);
+	fileDescriptor = -1;
+
+	boost::system::error_code error;
+	boost::filesystem::create_directories(boost::filesystem::path(filename).parent_path(), error);
+
+	while (true)
+	{
+		int descriptor = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+		if (descriptor < 0)
+		{
+			LOGW << "Unable to create cache lock " << filename << ": " << strerror(errno);
+			return;
+		}
+
+		if (flock(descriptor, LOCK_EX | LOCK_NB) != 0)
+		{
+			LOGI << "Waiting for another run computing " << entryFilename_;
+			if (flock(descriptor, LOCK_EX) != 0)
+			{
+				LOGW << "Unable to lock " << filename << ": " << strerror(errno);
+				close(descriptor);
+				return;
+			}
+		}
+
+		/**
+		 * The previous owner removes the file on release, so the lock is only valid if the file
+		 * locked is still the one at that path (otherwise a new one has to be locked)
+		 */
+		struct stat locked, current;
+		if (fstat(descriptor, &locked) == 0 && stat(filename.c_str(), &current) == 0
+				&& locked.st_dev == current.st_dev && locked.st_ino == current.st_ino)
+		{
+			fileDescriptor = descriptor;
+			return;
+		}
+
+		close(descriptor);
+	}
+}
+
+CacheLock::~CacheLock()
+{
+	if (fileDescriptor < 0)
+		return;
+
+	// Removed while still locked, so waiting runs notice it and nobody locks a stale file
+	unlink(filename.c_str());
+	close(fileDescriptor);
+}
+
+std::string CacheLock::getLockFilename(const std::string &entryFilename_)
+{
+	// Hidden, so it never looks like a cache entry
+	boost::filesystem::path entry(entryFilename_);
+	return (entry.parent_path() / ("." + entry.filename().string() + ".lock")).string();
+}
@@ -0,0 +1,220 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include "CacheManager.hpp"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <sys/time.h>
+#include <boost/filesystem.hpp>
+#include <plog/Log.h>
+#include "Utils.hpp"
+#include "AppendLog.hpp"
+#include "Config.hpp"
+
+
+#define CACHE_INDEX_FILE	"cache.index"
+#define BYTES_PER_MB		(1024 * 1024)
+
+
+static inline int64_t currentTime()
+{
+	timeval t;
+	gettimeofday(&t, NULL);
+	return (int64_t) t.tv_sec * 1000000 + t.tv_usec;
+}
+
+void CacheManager::registerHit(const std::string &cacheLocation_,
+							   const std::string &filename_)
+{
+	CacheManager *manager = getInstance();
+	boost::mutex::scoped_lock lock(manager->mutex);
+	if (manager->location != cacheLocation_)
+		manager->load(cacheLocation_);
+
+	boost::system::error_code error;
+	int64_t size = boost::filesystem::file_size(filename_, error);
+	if (error)
+		size = 0;
+
+	manager->hits++;
+	manager->bytesSaved += size;
+	manager->touch(boost::filesystem::path(filename_).filename().string(), size);
+	manager->registerStats();
+}
+
+void CacheManager::registerMiss(const std::string &cacheLocation_,
+								const std::string &filename_)
+{
+	CacheManager *manager = getInstance();
+	boost::mutex::scoped_lock lock(manager->mutex);
+
+	LOGD << "Cache miss " << filename_ << " in " << cacheLocation_;
+	manager->misses++;
+	manager->registerStats();
+}
+
+void CacheManager::registerWrite(const std::string &cacheLocation_,
+								 const std::string &filename_)
+{
+	CacheManager *manager = getInstance();
+	boost::mutex::scoped_lock lock(manager->mutex);
+	if (manager->location != cacheLocation_)
+		manager->load(cacheLocation_);
+
+	boost::system::error_code error;
+	int64_t size = boost::filesystem::file_size(filename_, error);
+	if (error)
+		return;
+
+	std::string name = boost::filesystem::path(filename_).filename().string();
+	manager->touch(name, size);
+	manager->evict(name);
+}
+
+uint64_t CacheManager::getCacheSize(const std::string &cacheLocation_)
+{
+	CacheManager *manager = getInstance();
+	boost::mutex::scoped_lock lock(manager->mutex);
+	if (manager->location != cacheLocation_)
+		manager->load(cacheLocation_);
+
+	return manager->totalSize;
+}
+
+void CacheManager::logStats()
+{
+	CacheManager *manager = getInstance();
+	boost::mutex::scoped_lock lock(manager->mutex);
+
+	uint64_t accesses = manager->hits + manager->misses;
+	if (accesses == 0)
+		return;
+
+	LOGI << "Cache stats -- hits: " << manager->hits
+		 << " misses: " << manager->misses
+		 << " hit rate: " << 100.0 * manager->hits / accesses << "%"
+		 << " saved: " << manager->bytesSaved / BYTES_PER_MB << " MB"
+		 << " size: " << manager->totalSize / BYTES_PER_MB << " MB";
+}
+
+void CacheManager::load(const std::string &cacheLocation_)
+{
+	entries.clear();
+	totalSize = 0;
+	location = cacheLocation_;
+
+	// Last access of each entry, as recorded in the index (each line holds: lastAccess name)
+	std::map<std::string, int64_t> accesses;
+	size_t lines = 0;
+	std::ifstream index((location + CACHE_INDEX_FILE).c_str());
+	std::string line;
+	while (std::getline(index, line))
+	{
+		std::istringstream iss(line);
+		int64_t lastAccess;
+		std::string name;
+		if (iss >> lastAccess >> name)
+		{
+			accesses[name] = lastAccess;
+			lines++;
+		}
+	}
+	index.close();
+
+	// The directory is the actual state, entries never accessed get their modification time
+	boost::system::error_code error;
+	if (!boost::filesystem::is_directory(location, error))
+		return;
+
+	boost::filesystem::directory_iterator end;
+	for (boost::filesystem::directory_iterator it(location, error); !error && it != end; it.increment(error))
+	{
+		if (!boost::filesystem::is_regular_file(it->status()) || !Utils::isCacheEntry(it->path().filename().string()))
+			continue;
+
+		std::string name = it->path().filename().string();
+		Entry entry;
+		entry.size = boost::filesystem::file_size(it->path(), error);
+		if (error)
+		{
+			error.clear();
+			continue;
+		}
+
+		std::map<std::string, int64_t>::const_iterator access = accesses.find(name);
+		entry.lastAccess = access != accesses.end() ? access->second : (int64_t) boost::filesystem::last_write_time(it->path()) * 1000000;
+
+		entries[name] = entry;
+		totalSize += entry.size;
+	}
+
+	if (AppendLog::isOutdated(lines, entries.size()))
+	{
+		std::ostringstream contents;
+		for (std::map<std::string, Entry>::const_iterator it = entries.begin(); it != entries.end(); it++)
+			contents << it->second.lastAccess << " " << it->first << "\n";
+		AppendLog::rewrite(location + CACHE_INDEX_FILE, contents.str());
+	}
+}
+
+void CacheManager::touch(const std::string &name_,
+						 const int64_t size_)
+{
+	Entry &entry = entries[name_];
+	totalSize += size_ - entry.size;
+	entry.size = size_;
+	entry.lastAccess = currentTime();
+
+	std::ostringstream line;
+	line << entry.lastAccess << " " << name_;
+	AppendLog::append(location + CACHE_INDEX_FILE, line.str());
+}
+
+void CacheManager::evict(const std::string &keep_)
+{
+	int64_t limit = (int64_t) Config::getCacheSizeLimit() * BYTES_PER_MB;
+	if (limit <= 0)
+		return;
+
+	int evicted = 0;
+	int64_t freed = 0;
+	while (totalSize > limit)
+	{
+		// Least recently used entry (never the one just written)
+		std::map<std::string, Entry>::iterator oldest = entries.end();
+		for (std::map<std::string, Entry>::iterator it = entries.begin(); it != entries.end(); it++)
+			if (it->first != keep_ && (oldest == entries.end() || it->second.lastAccess < oldest->second.lastAccess))
+				oldest = it;
+
+		if (oldest == entries.end())
+			break;
+
+		boost::system::error_code error;
+		boost::filesystem::remove(location + oldest->first, error);
+		if (error)
+			LOGW << "Unable to evict cache entry " << oldest->first << ": " << error.message();
+		else
+		{
+			evicted++;
+			freed += oldest->second.size;
+		}
+
+		// Dropped anyway, so a file that can't be removed doesn't block the eviction
+		totalSize -= oldest->second.size;
+		entries.erase(oldest);
+	}
+
+	if (evicted > 0)
+		LOGI << "Evicted " << evicted << " cache entries (" << freed / BYTES_PER_MB << " MB)";
+}
+
+void CacheManager::registerStats()
+{
+	if (statsRegistered)
+		return;
+
+	statsRegistered = true;
+	atexit(&CacheManager::logStats);
+}
@@ -0,0 +1,279 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include "CompressedMatrix.hpp"
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <boost/algorithm/string.hpp>
+#include <plog/Log.h>
+
+
+#define COMPRESSED_MAGIC			"PCLTZMAT"
+#define COMPRESSED_MAGIC_LENGTH		8
+#define COMPRESSED_VERSION			1
+#define FILTER_BYTE_SHUFFLE			1
+#define DEFAULT_ROWS_PER_BLOCK		1024
+#define COMPRESSION_LEVEL			6
+
+
+/**
+ * Fixed size header at the beginning of the file, followed by the metadata text, the index of
+ * blocks and the compressed blocks themselves (everything little endian)
+ */
+struct FileHeader
+{
+	char magic[COMPRESSED_MAGIC_LENGTH]; // File identifier
+	uint32_t version; // Version of the format
+	uint32_t filter; // Filter applied to each block before compressing it
+	int32_t rows; // Rows of the matrix
+	int32_t cols; // Columns of the matrix
+	uint32_t rowsPerBlock; // Rows stored in each block (except maybe the last one)
+	uint32_t blocks; // Number of blocks
+	uint32_t metadataSize; // Bytes of metadata text (lines separated by new lines)
+	uint32_t reserved; // Unused (keeps the index aligned)
+};
+
+
+/**
+ * Entry of the index of blocks
+ */
+struct BlockEntry
+{
+	uint64_t offset; // Position of the block in the file
+	uint64_t size; // Compressed size of the block
+};
+
+
+static inline bool littleEndian()
+{
+	uint16_t value = 1;
+	return *((uint8_t *) &value) == 1;
+}
+
+bool CompressedMatrix::isCompressed(const std::string &filename_)
+{
+	std::ifstream file(filename_.c_str(), std::ios::in | std::ios::binary);
+	char magic[COMPRESSED_MAGIC_LENGTH];
+	return file.read(magic, COMPRESSED_MAGIC_LENGTH) && memcmp(magic, COMPRESSED_MAGIC, COMPRESSED_MAGIC_LENGTH) == 0;
+}
+
+bool CompressedMatrix::write(const std::string &filename_,
+							 const cv::Mat &matrix_,
+							 const std::vector<std::string> &metadata_,
+							 const int rowsPerBlock_)
+{
+	if (matrix_.type() != CV_32FC1)
+	{
+		LOGE << "Only float matrices can be written in compressed format";
+		return false;
+	}
+
+	if (!littleEndian())
+	{
+		LOGE << "Compressed matrices can only be written on little endian hosts";
+		return false;
+	}
+
+	FileHeader header;
+	memcpy(header.magic, COMPRESSED_MAGIC, COMPRESSED_MAGIC_LENGTH);
+	header.version = COMPRESSED_VERSION;
+	header.filter = FILTER_BYTE_SHUFFLE;
+	header.rows = matrix_.rows;
+	header.cols = matrix_.cols;
+	header.rowsPerBlock = rowsPerBlock_ > 0 ? rowsPerBlock_ : DEFAULT_ROWS_PER_BLOCK;
+	header.blocks = (matrix_.rows + header.rowsPerBlock - 1) / header.rowsPerBlock;
+	header.reserved = 0;
+
+	std::string metadata = boost::algorithm::join(metadata_, "\n");
+	header.metadataSize = metadata.size();
+
+	// Shuffle and compress each block independently
+	std::vector<std::vector<Bytef> > blocks(header.blocks);
+	std::vector<char> blockOk(header.blocks, 1);
+	#pragma omp parallel for schedule(dynamic)
+	for (int b = 0; b < (int) header.blocks; b++)
+	{
+		int firstRow = b * header.rowsPerBlock;
+		int rows = std::min<int>(header.rowsPerBlock, matrix_.rows - firstRow);
+		size_t values = (size_t) rows * matrix_.cols;
+		if (values == 0)
+			continue; // Blocks without values (matrices without columns) are stored empty
+
+		std::vector<Bytef> shuffled(values * sizeof(float));
+		for (int r = 0; r < rows; r++)
+		{
+			const uint8_t *row = matrix_.ptr<uint8_t>(firstRow + r);
+			for (int c = 0; c < matrix_.cols; c++)
+				for (size_t k = 0; k < sizeof(float); k++)
+					shuffled[k * values + (size_t) r * matrix_.cols + c] = row[c * sizeof(float) + k];
+		}
+
+		uLongf size = compressBound(shuffled.size());
+		blocks[b].resize(size);
+		blockOk[b] = compress2(&blocks[b][0], &size, &shuffled[0], shuffled.size(), COMPRESSION_LEVEL) == Z_OK;
+		blocks[b].resize(size);
+	}
+
+	if (std::find(blockOk.begin(), blockOk.end(), 0) != blockOk.end())
+	{
+		LOGE << "Unable to compress matrix " << filename_;
+		return false;
+	}
+
+	// Index of blocks
+	std::vector<BlockEntry> index(header.blocks);
+	uint64_t offset = sizeof(FileHeader) + metadata.size() + index.size() * sizeof(BlockEntry);
+	for (size_t b = 0; b < index.size(); b++)
+	{
+		index[b].offset = offset;
+		index[b].size = blocks[b].size();
+		offset += blocks[b].size();
+	}
+
+	FILE *file = fopen(filename_.c_str(), "wb");
+	if (file == NULL)
+		return false;
+
+	bool writeOk = fwrite(&header, sizeof(FileHeader), 1, file) == 1;
+	writeOk = writeOk && fwrite(metadata.data(), 1, metadata.size(), file) == metadata.size();
+	writeOk = writeOk && (index.empty() || fwrite(&index[0], sizeof(BlockEntry), index.size(), file) == index.size());
+	for (size_t b = 0; b < blocks.size() && writeOk; b++)
+		writeOk = blocks[b].empty() || fwrite(&blocks[b][0], 1, blocks[b].size(), file) == blocks[b].size();
+
+	writeOk = fclose(file) == 0 && writeOk;
+	return writeOk;
+}
+
+bool CompressedMatrix::read(const std::string &filename_,
+							cv::Mat &matrix_,
+							std::vector<std::string> *metadata_)
+{
+	return load(filename_, 0, -1, matrix_, metadata_);
+}
+
+bool CompressedMatrix::readRows(const std::string &filename_,
+								const int firstRow_,
+								const int rowNumber_,
+								cv::Mat &matrix_)
+{
+	return load(filename_, firstRow_, rowNumber_, matrix_, NULL);
+}
+
+bool CompressedMatrix::load(const std::string &filename_,
+							const int firstRow_,
+							const int rowNumber_,
+							cv::Mat &matrix_,
+							std::vector<std::string> *metadata_)
+{
+	int fileDescriptor = open(filename_.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat statbuf;
+	if (fstat(fileDescriptor, &statbuf) < 0 || (size_t) statbuf.st_size < sizeof(FileHeader))
+	{
+		close(fileDescriptor);
+		return false;
+	}
+
+	size_t fileSize = statbuf.st_size;
+	const uint8_t *buffer = (const uint8_t *) mmap(0, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	close(fileDescriptor);
+	if (buffer == MAP_FAILED)
+		return false;
+
+	bool loadOk = false;
+	try
+	{
+		FileHeader header;
+		memcpy(&header, buffer, sizeof(FileHeader));
+		if (memcmp(header.magic, COMPRESSED_MAGIC, COMPRESSED_MAGIC_LENGTH) != 0)
+			throw std::runtime_error("not a compressed matrix file");
+		if (header.version > COMPRESSED_VERSION || header.filter != FILTER_BYTE_SHUFFLE)
+			throw std::runtime_error("unsupported format version");
+		if (header.rows < 0 || header.cols < 0 || header.rowsPerBlock == 0
+				|| header.blocks != (header.rows + header.rowsPerBlock - 1) / header.rowsPerBlock)
+			throw std::runtime_error("wrong dimensions");
+
+		size_t indexOffset = sizeof(FileHeader) + header.metadataSize;
+		if (indexOffset + (size_t) header.blocks * sizeof(BlockEntry) > fileSize)
+			throw std::runtime_error("truncated header");
+
+		if (metadata_ != NULL && header.metadataSize > 0)
+		{
+			std::string metadata((const char *) buffer + sizeof(FileHeader), header.metadataSize);
+			boost::split(*metadata_, metadata, boost::is_any_of("\n"));
+		}
+
+		// Range of rows to read (a negative number means up to the end)
+		int rowNumber = rowNumber_ < 0 ? header.rows - firstRow_ : rowNumber_;
+		if (firstRow_ < 0 || rowNumber < 0 || firstRow_ + rowNumber > header.rows)
+			throw std::runtime_error("rows out of range");
+
+		std::vector<BlockEntry> index(header.blocks);
+		if (!index.empty())
+			memcpy(&index[0], buffer + indexOffset, index.size() * sizeof(BlockEntry));
+
+		// Only the blocks overlapping the requested rows are inflated
+		matrix_ = cv::Mat(rowNumber, header.cols, CV_32FC1);
+		int firstBlock = firstRow_ / header.rowsPerBlock;
+		int lastBlock = rowNumber > 0 ? (firstRow_ + rowNumber - 1) / header.rowsPerBlock : firstBlock - 1;
+		std::vector<char> blockOk(std::max(lastBlock - firstBlock + 1, 0), 1);
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int b = firstBlock; b <= lastBlock; b++)
+		{
+			int blockStart = b * header.rowsPerBlock;
+			int blockRows = std::min<int>(header.rowsPerBlock, header.rows - blockStart);
+			size_t values = (size_t) blockRows * header.cols;
+			if (values == 0)
+			{
+				blockOk[b - firstBlock] = index[b].size == 0;
+				continue;
+			}
+
+			std::vector<Bytef> shuffled(values * sizeof(float));
+			uLongf size = shuffled.size();
+			if (index[b].offset + index[b].size > fileSize
+					|| uncompress(&shuffled[0], &size, buffer + index[b].offset, index[b].size) != Z_OK
+					|| size != shuffled.size())
+			{
+				blockOk[b - firstBlock] = 0;
+				continue;
+			}
+
+			// Unshuffle the requested rows straight into the matrix
+			int from = std::max(firstRow_, blockStart);
+			int to = std::min(firstRow_ + rowNumber, blockStart + blockRows);
+			for (int r = from; r < to; r++)
+			{
+				uint8_t *row = matrix_.ptr<uint8_t>(r - firstRow_);
+				size_t base = (size_t) (r - blockStart) * header.cols;
+				for (int c = 0; c < header.cols; c++)
+					for (size_t k = 0; k < sizeof(float); k++)
+						row[c * sizeof(float) + k] = shuffled[k * values + base + c];
+			}
+		}
+
+		if (std::find(blockOk.begin(), blockOk.end(), 0) != blockOk.end())
+			throw std::runtime_error("corrupted block");
+		loadOk = true;
+	}
+	catch (std::exception &_ex)
+	{
+		LOGE << "Unable to read compressed matrix " << filename_ << ": " << _ex.what();
+	}
+
+	munmap((void *) buffer, fileSize);
+	return loadOk;
+}
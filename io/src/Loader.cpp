@@ -5,112 +5,133 @@
 #include "Loader.hpp"
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <pcl/io/pcd_io.h>
 #include <boost/lexical_cast.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <plog/Log.h>
 #include "CloudUtils.hpp"
 #include "Utils.hpp"
 #include "Config.hpp"
+#include "Writer.hpp"
+#include "PCDReader.hpp"
+#include "PCDStreamReader.hpp"
+#include "BinaryMatrix.hpp"
+#include "TextMatrix.hpp"
+#include "CompressedMatrix.hpp"
+#include "CacheManager.hpp"
+#include "CacheLock.hpp"
+#include "VoxelCentroids.hpp"
 
 
-enum ReadingState
+/**
+ * Integer coordinates of a tile in a regular grid
+ */
+struct GridCell
 {
-	READING_METADATA,
-	READING_DIMENSIONS,
-	READING_DATA
+	int i, j, k;
+
+	/**************************************************/
+	GridCell(const int i_, const int j_, const int k_)
+	{
+		i = i_;
+		j = j_;
+		k = k_;
+	}
+
+	/**************************************************/
+	bool operator<(const GridCell &other_) const
+	{
+		if (k != other_.k)
+			return k < other_.k;
+		if (j != other_.j)
+			return j < other_.j;
+		return i < other_.i;
+	}
 };
 
 
-bool Loader::loadMatrix(const std::string &filename_,
-						cv::Mat &matrix_,
-						std::map<std::string, std::string> *metadata_)
+static void parseMetadata(const std::string &line_,
+						  std::map<std::string, std::string> &metadata_)
 {
-	bool loadOk = true;
-	size_t row = 0;
+	std::vector<std::string> tokens;
+	std::istringstream iss(line_);
+	std::copy(std::istream_iterator<std::string>(iss), std::istream_iterator<std::string>(), std::back_inserter(tokens));
 
-	try
+	for (size_t i = 0; i < tokens.size(); i++)
 	{
-		ReadingState state = READING_METADATA;
-		int metadataLines = -1;
-		int metadataLinesRead = 0;
-		std::string line;
-		std::ifstream cacheFile;
-		cacheFile.open(filename_.c_str(), std::fstream::in);
-		if (cacheFile.is_open())
-		{
-			while (getline(cacheFile, line))
-			{
-				if (line.empty())
-					continue;
+		std::vector<std::string> parts;
+		boost::split(parts, tokens[i], boost::is_any_of(":"), boost::token_compress_on);
+		metadata_[parts[0]] = parts[1];
+	}
+}
 
-				std::vector<std::string> tokens;
-				std::istringstream iss(line);
-				std::copy(std::istream_iterator<std::string>(iss), std::istream_iterator<std::string>(), std::back_inserter(tokens));
+static inline size_t streamChunkSize(const int chunkSize_)
+{
+	return chunkSize_ > 0 ? chunkSize_ : Config::getStreamChunkSize();
+}
 
-				switch (state)
-				{
-				case READING_METADATA:
-					if (metadataLines < 0)
-						metadataLines = atoi(tokens[1].c_str());
-					else
-					{
-						if (metadata_ != NULL)
-						{
-							// Parse metadata
-							for (size_t i = 0; i < tokens.size(); i++)
-							{
-								std::vector<std::string> parts;
-								boost::split(parts, tokens[i], boost::is_any_of(":"), boost::token_compress_on);
-								metadata_->operator [](parts[0]) = parts[1];
-							}
-						}
-						metadataLinesRead++;
-					}
+static inline bool isFinite(const pcl::PointXYZ &point_)
+{
+	return pcl_isfinite(point_.x) && pcl_isfinite(point_.y) && pcl_isfinite(point_.z);
+}
 
-					if (metadataLinesRead >= metadataLines)
-						state = READING_DIMENSIONS;
-					break;
+static std::string tileFilename(const boost::filesystem::path &directory_,
+								const std::string &basename_,
+								const GridCell &cell_)
+{
+	std::string name = basename_ + "_tile_" + boost::lexical_cast<std::string>(cell_.i) + "_" + boost::lexical_cast<std::string>(cell_.j) + "_" + boost::lexical_cast<std::string>(cell_.k);
+	return (directory_ / (name + CLOUD_FILE_EXTENSION)).string();
+}
 
-				case READING_DIMENSIONS:
-					matrix_ = cv::Mat::zeros(atoi(tokens[1].c_str()), atoi(tokens[2].c_str()), CV_32FC1);
-					state = READING_DATA;
-					break;
+static void writeTile(const std::string &rawFilename_,
+					  const std::string &filename_,
+					  const size_t points_,
+					  const PCDHeader &header_)
+{
+	std::ofstream output(filename_.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	output << "# .PCD v0.7 - Point Cloud Data file format\n"
+		   << "VERSION 0.7\n"
+		   << "FIELDS x y z\n"
+		   << "SIZE 4 4 4\n"
+		   << "TYPE F F F\n"
+		   << "COUNT 1 1 1\n"
+		   << "WIDTH " << points_ << "\n"
+		   << "HEIGHT 1\n"
+		   << "VIEWPOINT " << header_.origin[0] << " " << header_.origin[1] << " " << header_.origin[2] << " "
+		   << header_.orientation.w() << " " << header_.orientation.x() << " " << header_.orientation.y() << " " << header_.orientation.z() << "\n"
+		   << "POINTS " << points_ << "\n"
+		   << "DATA binary\n";
 
-				case READING_DATA:
-					loadOk = (int) tokens.size() == matrix_.cols;
-					if (!loadOk)
-						break;
+	std::ifstream raw(rawFilename_.c_str(), std::ios::in | std::ios::binary);
+	output << raw.rdbuf();
+	raw.close();
+	output.close();
 
-					for (size_t col = 0; col < tokens.size(); col++)
-					{
-						// Attempt to covert the strings into numbers
-						float value = 0;
-						try
-						{
-							value = boost::lexical_cast<float>(tokens[col]);
-						}
-						catch (boost::bad_lexical_cast ex_)
-						{
-							LOGW << "NaN found at (r,c) = (" << row << "," << col << "). Changing to zero.";
-						}
-
-						matrix_.at<float>(row, col) = value;
-					}
-					row++;
+	boost::filesystem::remove(rawFilename_);
+}
+
+
+bool Loader::loadMatrix(const std::string &filename_,
+						cv::Mat &matrix_,
+						std::map<std::string, std::string> *metadata_)
+{
+	// Binary and compressed matrices are detected by their magic string, anything else is parsed as text
+	std::vector<std::string> lines;
+	bool loadOk;
+	if (BinaryMatrix::isBinary(filename_))
+		loadOk = BinaryMatrix::read(filename_, matrix_, &lines);
+	else if (CompressedMatrix::isCompressed(filename_))
+		loadOk = CompressedMatrix::read(filename_, matrix_, &lines);
+	else
+		loadOk = TextMatrix::read(filename_, matrix_, &lines);
+
+	if (loadOk && metadata_ != NULL)
+		for (size_t i = 0; i < lines.size(); i++)
+			parseMetadata(lines[i], *metadata_);
 
-					break;
-				}
-			}
-			cacheFile.close();
-		}
-		else
-			loadOk = false;
-	}
-	catch (std::exception &_ex)
-	{
-		LOGE << "ERROR: " << _ex.what();
-		loadOk = false;
-	}
 	return loadOk;
 }
 
@@ -122,48 +143,422 @@ bool Loader::loadDescriptors(const std::string &cacheLocation_,
 							 cv::Mat &descriptors_)
 {
 	std::string filename = cacheLocation_ + Utils::getCalculationConfigHash(cloudInputFilename_, normalEstimationRadius_, descritorParams_, smoothingParams_);
-	return loadMatrix(filename, descriptors_);
+	if (!boost::filesystem::exists(filename) && hasLegacyCacheEntries(cacheLocation_))
+		migrateCacheEntry(cacheLocation_ + Utils::getCalculationConfigHash(cloudInputFilename_, normalEstimationRadius_, descritorParams_, smoothingParams_, true), filename);
+
+	bool loadOk = boost::filesystem::exists(filename) && loadMatrix(filename, descriptors_);
+	if (loadOk)
+		CacheManager::registerHit(cacheLocation_, filename);
+	else
+		CacheManager::registerMiss(cacheLocation_, filename);
+
+	return loadOk;
 }
 
-bool Loader::loadCloud(const std::string &filename_,
-					   const double normalEstimationRadius_,
-					   const CloudSmoothingParams &params_,
-					   pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_)
+bool Loader::loadCloudCache(const std::string &cacheLocation_,
+							const std::string &cloudInputFilename_,
+							const double normalEstimationRadius_,
+							const CloudSmoothingParams &smoothingParams_,
+							pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_)
 {
-	// Load cartesian data from disk
-	pcl::PointCloud<pcl::PointXYZ>::Ptr cloudXYZ(new pcl::PointCloud<pcl::PointXYZ>());
-	bool loadOk = pcl::io::loadPCDFile<pcl::PointXYZ>(filename_, *cloudXYZ) == 0;
+	if (!boost::filesystem::exists(cloudInputFilename_))
+		return false;
+
+	std::string filename = getCloudCacheFilename(cacheLocation_, cloudInputFilename_, normalEstimationRadius_, smoothingParams_);
+	return loadCloudCache(cacheLocation_, filename, cloudInputFilename_, normalEstimationRadius_, smoothingParams_, cloud_);
+}
 
+bool Loader::loadCloudCache(const std::string &cacheLocation_,
+							const std::string &cacheFilename_,
+							const std::string &cloudInputFilename_,
+							const double normalEstimationRadius_,
+							const CloudSmoothingParams &smoothingParams_,
+							pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_)
+{
+	if (!boost::filesystem::exists(cacheFilename_) && hasLegacyCacheEntries(cacheLocation_))
+		migrateCacheEntry(cacheLocation_ + Utils::getPreprocessingHash(cloudInputFilename_, normalEstimationRadius_, smoothingParams_, true) + CLOUD_FILE_EXTENSION, cacheFilename_);
+	if (!boost::filesystem::exists(cacheFilename_))
+	{
+		CacheManager::registerMiss(cacheLocation_, cacheFilename_);
+		return false;
+	}
+
+	cloud_->clear();
+	bool loadOk = pcl::io::loadPCDFile<pcl::PointNormal>(cacheFilename_, *cloud_) == 0;
 	if (loadOk)
+		CacheManager::registerHit(cacheLocation_, cacheFilename_);
+	else
+		CacheManager::registerMiss(cacheLocation_, cacheFilename_);
+
+	return loadOk;
+}
+
+std::string Loader::getCloudCacheFilename(const std::string &cacheLocation_,
+		const std::string &cloudInputFilename_,
+		const double normalEstimationRadius_,
+		const CloudSmoothingParams &smoothingParams_)
+{
+	return cacheLocation_ + Utils::getPreprocessingHash(cloudInputFilename_, normalEstimationRadius_, smoothingParams_) + CLOUD_FILE_EXTENSION;
+}
+
+bool Loader::hasLegacyCacheEntries(const std::string &cacheLocation_)
+{
+	/**
+	 * The directory is scanned only once per run, so misses don't pay for the legacy keys (which
+	 * need the MD5 of the input) once every legacy entry has been migrated
+	 */
+	static std::map<std::string, bool> scanned;
+	static boost::mutex mutex;
+	boost::mutex::scoped_lock lock(mutex);
+
+	std::map<std::string, bool>::iterator it = scanned.find(cacheLocation_);
+	if (it != scanned.end())
+		return it->second;
+
+	bool found = false;
+	boost::system::error_code error;
+	if (boost::filesystem::is_directory(cacheLocation_, error))
 	{
-		// Remove NANs
-		CloudUtils::removeNANs(cloudXYZ);
+		boost::filesystem::directory_iterator end;
+		for (boost::filesystem::directory_iterator entry(cacheLocation_, error); !error && entry != end && !found; entry.increment(error))
+			found = boost::filesystem::is_regular_file(entry->status()) && Utils::isLegacyCacheEntry(entry->path().filename().string());
+	}
+
+	if (found)
+		LOGI << "Legacy cache entries found in " << cacheLocation_ << ", they will be migrated when used";
+
+	scanned[cacheLocation_] = found;
+	return found;
+}
+
+void Loader::migrateCacheEntry(const std::string &legacyFilename_,
+							   const std::string &filename_)
+{
+	if (!boost::filesystem::exists(legacyFilename_))
+		return;
+
+	// Renamed, so the entry is hit from now on without hashing the input twice
+	boost::system::error_code error;
+	boost::filesystem::rename(legacyFilename_, filename_, error);
+	if (error)
+		LOGW << "Unable to migrate cache entry " << legacyFilename_ << ": " << error.message();
+	else
+		LOGI << "Cache entry " << legacyFilename_ << " migrated to " << filename_;
+}
+
+bool Loader::cloudCacheEnabled()
+{
+	return Config::useCloudCache() && !Config::getCacheDirectory().empty();
+}
+
+std::string Loader::getCloudCacheEntry(const std::string &cloudInputFilename_,
+									   const double normalEstimationRadius_,
+									   const CloudSmoothingParams &smoothingParams_)
+{
+	if (!cloudCacheEnabled() || !boost::filesystem::exists(cloudInputFilename_))
+		return "";
+	return getCloudCacheFilename(Config::getCacheDirectory(), cloudInputFilename_, normalEstimationRadius_, smoothingParams_);
+}
 
+bool Loader::loadCachedCloud(const std::string &filename_,
+							 const std::string &cacheFilename_,
+							 const double normalEstimationRadius_,
+							 const CloudSmoothingParams &params_,
+							 pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+							 NeighborGraphPtr *graph_,
+							 const double graphRadius_)
+{
+	if (cacheFilename_.empty() || !loadCloudCache(Config::getCacheDirectory(), cacheFilename_, filename_, normalEstimationRadius_, params_, cloud_))
+		return false;
 
-		// Generate debug data
-		if (Config::debugEnabled())
+	LOGI << "Preprocessed cloud loaded from cache";
+	if (graph_ != NULL)
+	{
+		// The normals are already computed, so only the graph asked by the caller is built (if any)
+		double radius = std::max(normalEstimationRadius_, graphRadius_);
+		*graph_ = radius > 0 ? CloudUtils::buildNeighborGraph<pcl::PointNormal>(cloud_, radius, CloudUtils::getSearchBackend(cloud_->isOrganized())) : NeighborGraphPtr();
+	}
+
+	return true;
+}
+
+bool Loader::readCloud(const std::string &filename_,
+					   pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_)
+{
+	cloud_.reset(new pcl::PointCloud<pcl::PointXYZ>());
+	return PCDReader::read(filename_, *cloud_);
+}
+
+bool Loader::readCloud(const std::string &filename_,
+					   CloudSmoothingParams &params_,
+					   pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_)
+{
+	/**
+	 * Downsampled clouds are reduced while being streamed from disk, so the full cloud is never
+	 * held in memory. This can't be done if the duplicates have to be collapsed first, nor for
+	 * organized clouds (they keep their grid) or compressed files (they can't be streamed).
+	 */
+	PCDHeader header;
+	bool streamable = params_.useDownsampling && !params_.collapseDuplicates
+					  && PCDReader::readHeader(filename_, header)
+					  && header.encoding != Params::PCD_BINARY_COMPRESSED
+					  && !(header.height > 1 && Config::useOrganizedPath());
+
+	if (streamable && streamDownsample(filename_, params_.voxelSize, cloud_))
+	{
+		params_.useDownsampling = false;
+		return true;
+	}
+
+	return readCloud(filename_, cloud_);
+}
+
+bool Loader::streamDownsample(const std::string &filename_,
+							  const double voxelSize_,
+							  pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_,
+							  const int chunkSize_)
+{
+	PCDStreamReader reader;
+	if (!reader.open(filename_))
+		return false;
+
+	// Accumulate the points of each voxel chunk by chunk (NaNs are dropped on the way)
+	VoxelCentroids voxels(voxelSize_);
+	pcl::PointCloud<pcl::PointXYZ> chunk;
+	while (reader.read(chunk, streamChunkSize(chunkSize_)) > 0)
+		voxels.add(chunk);
+
+	// Each occupied voxel is replaced by the centroid of its points (the same ones than in memory)
+	cloud_ = voxels.getCentroids();
+	cloud_->sensor_origin_ = reader.getHeader().origin;
+	cloud_->sensor_orientation_ = reader.getHeader().orientation;
+
+	LOGI << "Cloud streamed and downsampled from " << reader.getPointsRead() << " to " << cloud_->size() << " points (voxelSize: " << voxelSize_ << ")";
+	return true;
+}
+
+bool Loader::tileCloud(const std::string &filename_,
+					   const double tileSize_,
+					   const double margin_,
+					   const std::string &outputDirectory_,
+					   std::vector<CloudTile> &tiles_,
+					   const int chunkSize_)
+{
+	tiles_.clear();
+	if (tileSize_ <= 0 || margin_ < 0)
+	{
+		LOGE << "Wrong tiling parameters (tileSize: " << tileSize_ << ", margin: " << margin_ << ")";
+		return false;
+	}
+
+	PCDStreamReader reader;
+	if (!reader.open(filename_))
+		return false;
+
+	boost::filesystem::path directory(outputDirectory_);
+	if (!boost::filesystem::exists(directory))
+		boost::filesystem::create_directories(directory);
+	std::string basename = boost::filesystem::path(filename_).stem().string();
+
+	/**
+	 * Each point is written to every tile whose box, grown by the margin, contains it, so the
+	 * neighborhoods of the points in the core of a tile are complete. The points of each chunk
+	 * are appended to raw files, which are wrapped into PCD files once the sizes are known.
+	 */
+	std::map<GridCell, size_t> counts;
+	pcl::PointCloud<pcl::PointXYZ> chunk;
+	while (reader.read(chunk, streamChunkSize(chunkSize_)) > 0)
+	{
+		std::map<GridCell, std::vector<float> > pending;
+		for (size_t i = 0; i < chunk.size(); i++)
 		{
-			pcl::PointCloud<pcl::Normal>::Ptr rawNormals = CloudUtils::estimateNormals(cloudXYZ, normalEstimationRadius_);
-			pcl::PointCloud<pcl::PointNormal>::Ptr rawCloud(new pcl::PointCloud<pcl::PointNormal>());
-			pcl::concatenateFields(*cloudXYZ, *rawNormals, *rawCloud);
-			pcl::io::savePCDFileASCII(DEBUG_DIR DEBUG_PREFIX + std::string("raw_normals") + CLOUD_FILE_EXTENSION, *rawCloud);
+			const pcl::PointXYZ &p = chunk.points[i];
+			if (!isFinite(p))
+				continue;
+
+			GridCell first((int) floor((p.x - margin_) / tileSize_), (int) floor((p.y - margin_) / tileSize_), (int) floor((p.z - margin_) / tileSize_));
+			GridCell last((int) floor((p.x + margin_) / tileSize_), (int) floor((p.y + margin_) / tileSize_), (int) floor((p.z + margin_) / tileSize_));
+			for (int x = first.i; x <= last.i; x++)
+				for (int y = first.j; y <= last.j; y++)
+					for (int z = first.k; z <= last.k; z++)
+					{
+						std::vector<float> &data = pending[GridCell(x, y, z)];
+						data.push_back(p.x);
+						data.push_back(p.y);
+						data.push_back(p.z);
+					}
 		}
 
+		for (std::map<GridCell, std::vector<float> >::iterator it = pending.begin(); it != pending.end(); it++)
+		{
+			std::string raw = tileFilename(directory, basename, it->first) + ".raw";
+
+			// The first write of each tile truncates any leftover of a previous run
+			bool newTile = counts.find(it->first) == counts.end();
+			std::ofstream output(raw.c_str(), std::ios::out | std::ios::binary | (newTile ? std::ios::trunc : std::ios::app));
+			output.write((const char *) &it->second[0], it->second.size() * sizeof(float));
+			output.close();
 
-		// Apply smoothing
-		if (params_.useSmoothing)
-			cloudXYZ = CloudUtils::gaussianSmoothing(cloudXYZ, params_.sigma, params_.radius);
+			counts[it->first] += it->second.size() / 3;
+		}
+	}
 
-		// Estimate normals
-		pcl::PointCloud<pcl::Normal>::Ptr normals = CloudUtils::estimateNormals(cloudXYZ, normalEstimationRadius_);
+	tiles_.reserve(counts.size());
+	for (std::map<GridCell, size_t>::const_iterator it = counts.begin(); it != counts.end(); it++)
+	{
+		CloudTile tile;
+		tile.filename = tileFilename(directory, basename, it->first);
+		tile.minCorner = Eigen::Vector3f(it->first.i, it->first.j, it->first.k) * tileSize_;
+		tile.maxCorner = tile.minCorner + Eigen::Vector3f::Constant(tileSize_);
+		tile.points = it->second;
 
-		// Deliver the cloud
-		cloud_->clear();
-		pcl::concatenateFields(*cloudXYZ, *normals, *cloud_);
-		cloud_->sensor_origin_ = cloudXYZ->sensor_origin_;
+		writeTile(tile.filename + ".raw", tile.filename, tile.points, reader.getHeader());
+		tiles_.push_back(tile);
 	}
 
-	return loadOk;
+	LOGI << "Cloud of " << reader.getPointsRead() << " points split into " << tiles_.size() << " tiles (tileSize: " << tileSize_ << ", margin: " << margin_ << ")";
+	return true;
+}
+
+void Loader::preprocessCloud(pcl::PointCloud<pcl::PointXYZ>::Ptr cloudXYZ_,
+							 const double normalEstimationRadius_,
+							 const CloudSmoothingParams &params_,
+							 pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+							 NeighborGraphPtr *graph_,
+							 const double graphRadius_)
+{
+	/**
+	 * Organized clouds (depth frames) keep their grid, NaN points included, so normals can be
+	 * estimated over integral images and neighborhoods searched in image space. Any stage that
+	 * would break the grid is skipped for them.
+	 */
+	bool organized = cloudXYZ_->isOrganized() && Config::useOrganizedPath();
+	bool useSmoothing = params_.useSmoothing && !organized;
+	if (organized)
+	{
+		LOGI << "Using organized path (" << cloudXYZ_->width << "x" << cloudXYZ_->height << ")";
+		if (params_.modifiesCloud())
+			LOGW << "Downsampling and smoothing are skipped for organized clouds";
+	}
+	else
+	{
+		// Remove NANs
+		CloudUtils::removeNANs(cloudXYZ_);
+
+		// Reduce the cloud before any neighborhood processing
+		if (params_.collapseDuplicates)
+		{
+			size_t removed = CloudUtils::collapseDuplicates(cloudXYZ_);
+			LOGD << "Collapsed " << removed << " duplicated points";
+		}
+		if (params_.useDownsampling)
+		{
+			size_t original = cloudXYZ_->size();
+			cloudXYZ_ = CloudUtils::downsample(cloudXYZ_, params_.voxelSize);
+			LOGI << "Cloud downsampled from " << original << " to " << cloudXYZ_->size() << " points (voxelSize: " << params_.voxelSize << ")";
+		}
+	}
+
+	/**
+	 * The neighbors of the raw cloud are searched only once, at the largest radius used over it,
+	 * and shared by the stages working on it (every smaller radius is read by truncation). It's
+	 * only built for the stages doing radius searches (normals estimated by KNN or over integral
+	 * images don't use it), so no graph is built at all with the default (non positive) radii.
+	 */
+	double normalsRadius = organized ? -1 : normalEstimationRadius_;
+	double finalRadius = std::max(normalsRadius, graph_ != NULL ? std::max(normalEstimationRadius_, graphRadius_) : -1);
+	double rawRadius = useSmoothing ? params_.radius : finalRadius;
+	if (Config::debugEnabled())
+		rawRadius = std::max(rawRadius, normalsRadius);
+
+	NeighborGraphPtr graph;
+	if (rawRadius > 0)
+		graph = CloudUtils::buildNeighborGraph<pcl::PointXYZ>(cloudXYZ_, rawRadius, CloudUtils::getSearchBackend(cloudXYZ_->isOrganized()));
+
+
+	// Generate debug data
+	pcl::PointCloud<pcl::Normal>::Ptr rawNormals;
+	if (Config::debugEnabled())
+	{
+		rawNormals = CloudUtils::estimateNormals(cloudXYZ_, normalEstimationRadius_, -1, graph);
+		pcl::PointCloud<pcl::PointNormal>::Ptr rawCloud(new pcl::PointCloud<pcl::PointNormal>());
+		pcl::concatenateFields(*cloudXYZ_, *rawNormals, *rawCloud);
+		CloudUtils::saveCloud(DEBUG_DIR DEBUG_PREFIX + std::string("raw_normals") + CLOUD_FILE_EXTENSION, *rawCloud);
+	}
+
+
+	// Apply smoothing (the points move, so the neighbors have to be searched again afterwards)
+	if (useSmoothing)
+	{
+		cloudXYZ_ = CloudUtils::gaussianSmoothing(cloudXYZ_, params_.sigma, params_.radius, params_.threads, graph);
+		graph.reset();
+		if (finalRadius > 0)
+			graph = CloudUtils::buildNeighborGraph<pcl::PointXYZ>(cloudXYZ_, finalRadius, CloudUtils::getSearchBackend(cloudXYZ_->isOrganized()));
+	}
+
+	// Estimate normals (unless already done over the same cloud for the debug data)
+	pcl::PointCloud<pcl::Normal>::Ptr normals = rawNormals && !useSmoothing ? rawNormals : CloudUtils::estimateNormals(cloudXYZ_, normalEstimationRadius_, -1, graph);
+
+	// Deliver the cloud
+	cloud_->clear();
+	pcl::concatenateFields(*cloudXYZ_, *normals, *cloud_);
+	cloud_->sensor_origin_ = cloudXYZ_->sensor_origin_;
+
+	if (graph_ != NULL)
+		*graph_ = graph;
+}
+
+bool Loader::preprocessAndCache(const std::string &filename_,
+								const std::string &cacheFilename_,
+								const double normalEstimationRadius_,
+								const CloudSmoothingParams &params_,
+								pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+								NeighborGraphPtr *graph_,
+								const double graphRadius_,
+								pcl::PointCloud<pcl::PointXYZ>::Ptr cloudXYZ_,
+								const CloudSmoothingParams *pending_)
+{
+	// Another run may be preprocessing the same cloud, in which case its result is waited for
+	boost::scoped_ptr<CacheLock> lock;
+	if (!cacheFilename_.empty())
+	{
+		lock.reset(new CacheLock(cacheFilename_));
+		if (boost::filesystem::exists(cacheFilename_) && loadCachedCloud(filename_, cacheFilename_, normalEstimationRadius_, params_, cloud_, graph_, graphRadius_))
+		{
+			LOGD << "Cloud " << filename_ << " preprocessed by another run";
+			return true;
+		}
+	}
+
+	// Load cartesian data from disk, unless already read (reductions done while reading are disabled afterwards)
+	CloudSmoothingParams pending = cloudXYZ_ && pending_ != NULL ? *pending_ : params_;
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloudXYZ = cloudXYZ_;
+	if (!cloudXYZ && !readCloud(filename_, pending, cloudXYZ))
+		return false;
+
+	preprocessCloud(cloudXYZ, normalEstimationRadius_, pending, cloud_, graph_, graphRadius_);
+
+	if (!cacheFilename_.empty())
+		Writer::writeCloudCache(cloud_, Config::getCacheDirectory(), cacheFilename_);
+
+	return true;
+}
+
+bool Loader::loadCloud(const std::string &filename_,
+					   const double normalEstimationRadius_,
+					   const CloudSmoothingParams &params_,
+					   pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+					   NeighborGraphPtr *graph_,
+					   const double graphRadius_)
+{
+	// The cache key hashes the input, so it's computed only once for the whole load
+	std::string entry = getCloudCacheEntry(filename_, normalEstimationRadius_, params_);
+
+	// Skip the whole preprocessing if the resulting cloud is already cached
+	if (loadCachedCloud(filename_, entry, normalEstimationRadius_, params_, cloud_, graph_, graphRadius_))
+		return true;
+
+	return preprocessAndCache(filename_, entry, normalEstimationRadius_, params_, cloud_, graph_, graphRadius_);
 }
 
 void Loader::traverseDirectory(const std::string &inputDirectory_,
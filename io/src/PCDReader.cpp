@@ -0,0 +1,199 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include "PCDReader.hpp"
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pcl/io/pcd_io.h>
+#include <plog/Log.h>
+
+
+bool PCDReader::readHeader(const std::string &filename_,
+						   PCDHeader &header_)
+{
+	std::ifstream file(filename_.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	header_ = PCDHeader();
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream iss(line);
+		std::string key;
+		iss >> key;
+
+		if (key == "FIELDS")
+		{
+			std::string name;
+			while (iss >> name)
+				header_.fields.push_back(name);
+		}
+		else if (key == "SIZE")
+		{
+			int size;
+			while (iss >> size)
+				header_.sizes.push_back(size);
+		}
+		else if (key == "TYPE")
+		{
+			char type;
+			while (iss >> type)
+				header_.types.push_back(type);
+		}
+		else if (key == "COUNT")
+		{
+			int count;
+			while (iss >> count)
+				header_.counts.push_back(count);
+		}
+		else if (key == "WIDTH")
+			iss >> header_.width;
+		else if (key == "HEIGHT")
+			iss >> header_.height;
+		else if (key == "POINTS")
+			iss >> header_.points;
+		else if (key == "VIEWPOINT")
+		{
+			float qw, qx, qy, qz;
+			iss >> header_.origin[0] >> header_.origin[1] >> header_.origin[2] >> qw >> qx >> qy >> qz;
+			header_.orientation = Eigen::Quaternionf(qw, qx, qy, qz);
+		}
+		else if (key == "DATA")
+		{
+			std::string encoding;
+			iss >> encoding;
+			try
+			{
+				header_.encoding = Params::toPCDEncoding(encoding);
+			}
+			catch (std::exception &_ex)
+			{
+				LOGE << _ex.what() << " in " << filename_;
+				return false;
+			}
+
+			header_.dataOffset = file.tellg();
+			break;
+		}
+	}
+
+	// COUNT is optional (one element per field by default)
+	if (header_.counts.empty())
+		header_.counts.assign(header_.fields.size(), 1);
+
+	return header_.dataOffset > 0
+		   && header_.sizes.size() == header_.fields.size()
+		   && header_.types.size() == header_.fields.size()
+		   && header_.counts.size() == header_.fields.size();
+}
+
+bool PCDReader::read(const std::string &filename_,
+					 pcl::PointCloud<pcl::PointXYZ> &cloud_)
+{
+	PCDHeader header;
+	if (!readHeader(filename_, header))
+		return false;
+
+	// Uncompressed binary files holding float coordinates are read straight from a mapping of the file
+	if (header.encoding == Params::PCD_BINARY)
+	{
+		bool mappable = true;
+		const char *names[] = {"x", "y", "z"};
+		for (int i = 0; i < 3 && mappable; i++)
+		{
+			int index = header.getFieldIndex(names[i]);
+			mappable = index >= 0 && header.sizes[index] == 4 && header.types[index] == 'F' && header.counts[index] == 1;
+		}
+
+		if (mappable)
+			return readMapped(filename_, header, cloud_);
+	}
+
+	// Anything else (ASCII, compressed, other layouts) goes through PCL's reader
+	return pcl::io::loadPCDFile<pcl::PointXYZ>(filename_, cloud_) == 0;
+}
+
+bool PCDReader::readMapped(const std::string &filename_,
+						   const PCDHeader &header_,
+						   pcl::PointCloud<pcl::PointXYZ> &cloud_)
+{
+	int fileDescriptor = open(filename_.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat statbuf;
+	if (fstat(fileDescriptor, &statbuf) < 0)
+	{
+		close(fileDescriptor);
+		return false;
+	}
+
+	size_t pointSize = header_.getPointSize();
+	size_t fileSize = statbuf.st_size;
+	if (fileSize < header_.dataOffset + header_.points * pointSize)
+	{
+		LOGE << "Truncated PCD file " << filename_;
+		close(fileDescriptor);
+		return false;
+	}
+
+	char *buffer = (char *) mmap(0, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	close(fileDescriptor);
+	if (buffer == MAP_FAILED)
+		return false;
+
+	// The pages are read in order, so let the kernel read ahead aggressively
+	madvise(buffer, fileSize, MADV_SEQUENTIAL);
+
+	size_t offsetX = header_.getFieldOffset(header_.getFieldIndex("x"));
+	size_t offsetY = header_.getFieldOffset(header_.getFieldIndex("y"));
+	size_t offsetZ = header_.getFieldOffset(header_.getFieldIndex("z"));
+	bool contiguous = offsetY == offsetX + 4 && offsetZ == offsetY + 4;
+
+	// Copy the coordinates from the mapped records directly into the point buffer (no parsing, no staging copy)
+	cloud_.resize(header_.points);
+	const char *data = buffer + header_.dataOffset;
+	bool dense = true;
+	for (size_t i = 0; i < header_.points; i++)
+	{
+		const char *record = data + i * pointSize;
+		pcl::PointXYZ &p = cloud_.points[i];
+		if (contiguous)
+			memcpy(&p.x, record + offsetX, 3 * sizeof(float));
+		else
+		{
+			memcpy(&p.x, record + offsetX, sizeof(float));
+			memcpy(&p.y, record + offsetY, sizeof(float));
+			memcpy(&p.z, record + offsetZ, sizeof(float));
+		}
+
+		dense = dense && pcl_isfinite(p.x) && pcl_isfinite(p.y) && pcl_isfinite(p.z);
+	}
+
+	munmap(buffer, fileSize);
+
+	// Keep the organization of the cloud
+	cloud_.width = header_.width;
+	cloud_.height = header_.height;
+	if ((size_t) cloud_.width * cloud_.height != header_.points)
+	{
+		cloud_.width = header_.points;
+		cloud_.height = 1;
+	}
+	cloud_.is_dense = dense;
+	cloud_.sensor_origin_ = header_.origin;
+	cloud_.sensor_orientation_ = header_.orientation;
+
+	return true;
+}
@@ -0,0 +1,174 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include "PCDStreamReader.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <plog/Log.h>
+
+
+PCDStreamReader::PCDStreamReader()
+{
+	pointsRead = 0;
+	offsets[0] = offsets[1] = offsets[2] = 0;
+}
+
+PCDStreamReader::~PCDStreamReader()
+{
+	close();
+}
+
+bool PCDStreamReader::open(const std::string &filename_)
+{
+	close();
+
+	if (!PCDReader::readHeader(filename_, header))
+	{
+		LOGE << "Unable to read the header of " << filename_;
+		return false;
+	}
+
+	if (header.encoding == Params::PCD_BINARY_COMPRESSED)
+	{
+		LOGE << "Compressed PCD files can't be streamed (" << filename_ << ")";
+		return false;
+	}
+
+	const char *names[] = {"x", "y", "z"};
+	for (int i = 0; i < 3; i++)
+	{
+		int index = header.getFieldIndex(names[i]);
+		if (index < 0)
+		{
+			LOGE << "Field " << names[i] << " not found in " << filename_;
+			return false;
+		}
+
+		if (header.encoding == Params::PCD_BINARY)
+		{
+			if (header.sizes[index] != 4 || header.types[index] != 'F')
+			{
+				LOGE << "Only float coordinates can be streamed from binary files (" << filename_ << ")";
+				return false;
+			}
+			offsets[i] = header.getFieldOffset(index);
+		}
+		else
+		{
+			// In ASCII files every element of every field is a column
+			offsets[i] = 0;
+			for (int j = 0; j < index; j++)
+				offsets[i] += header.counts[j];
+		}
+	}
+
+	file.open(filename_.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	file.seekg(header.dataOffset);
+	pointsRead = 0;
+	return true;
+}
+
+size_t PCDStreamReader::read(pcl::PointCloud<pcl::PointXYZ> &chunk_,
+							 const size_t maxPoints_)
+{
+	chunk_.clear();
+	if (!file.is_open() || finished() || maxPoints_ == 0)
+		return 0;
+
+	size_t read = header.encoding == Params::PCD_BINARY ? readBinary(chunk_, maxPoints_) : readASCII(chunk_, maxPoints_);
+	pointsRead += read;
+
+	// Chunks are unorganized, regardless of the file's layout
+	chunk_.width = chunk_.size();
+	chunk_.height = 1;
+	chunk_.is_dense = true;
+	for (size_t i = 0; i < chunk_.size() && chunk_.is_dense; i++)
+		chunk_.is_dense = pcl_isfinite(chunk_.points[i].x) && pcl_isfinite(chunk_.points[i].y) && pcl_isfinite(chunk_.points[i].z);
+	chunk_.sensor_origin_ = header.origin;
+	chunk_.sensor_orientation_ = header.orientation;
+
+	if (read < maxPoints_ && !finished())
+	{
+		LOGW << "PCD file ended after " << pointsRead << " of " << header.points << " points";
+		pointsRead = header.points;
+	}
+
+	return read;
+}
+
+void PCDStreamReader::close()
+{
+	if (file.is_open())
+		file.close();
+	file.clear();
+	pointsRead = 0;
+}
+
+size_t PCDStreamReader::readASCII(pcl::PointCloud<pcl::PointXYZ> &chunk_,
+								  const size_t maxPoints_)
+{
+	size_t lastColumn = std::max(offsets[0], std::max(offsets[1], offsets[2]));
+	size_t target = std::min(maxPoints_, header.points - pointsRead);
+	chunk_.reserve(target);
+
+	std::string line;
+	while (chunk_.size() < target && std::getline(file, line))
+	{
+		if (line.empty())
+			continue;
+
+		// Walk the columns of the line without tokenizing it
+		float values[3];
+		const char *ptr = line.c_str();
+		char *end = NULL;
+		bool lineOk = true;
+		for (size_t column = 0; column <= lastColumn && lineOk; column++)
+		{
+			float value = strtof(ptr, &end);
+			lineOk = end != ptr;
+			ptr = end;
+
+			for (int i = 0; i < 3; i++)
+				if (offsets[i] == column)
+					values[i] = value;
+		}
+
+		if (!lineOk)
+		{
+			LOGW << "Skipping malformed PCD line " << pointsRead + chunk_.size();
+			continue;
+		}
+
+		chunk_.push_back(pcl::PointXYZ(values[0], values[1], values[2]));
+	}
+
+	return chunk_.size();
+}
+
+size_t PCDStreamReader::readBinary(pcl::PointCloud<pcl::PointXYZ> &chunk_,
+								   const size_t maxPoints_)
+{
+	size_t pointSize = header.getPointSize();
+	size_t target = std::min(maxPoints_, header.points - pointsRead);
+	buffer.resize(target * pointSize);
+
+	file.read(&buffer[0], buffer.size());
+	size_t read = file.gcount() / pointSize;
+
+	chunk_.resize(read);
+	for (size_t i = 0; i < read; i++)
+	{
+		const char *record = &buffer[i * pointSize];
+		pcl::PointXYZ &p = chunk_.points[i];
+		memcpy(&p.x, record + offsets[0], sizeof(float));
+		memcpy(&p.y, record + offsets[1], sizeof(float));
+		memcpy(&p.z, record + offsets[2], sizeof(float));
+	}
+
+	return read;
+}
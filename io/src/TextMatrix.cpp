@@ -0,0 +1,427 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include "TextMatrix.hpp"
+#include <sstream>
+#include <locale>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <pcl/pcl_macros.h>
+#include <plog/Log.h>
+
+
+#define MIN_CHUNK_SIZE		(1 << 20)
+#define CHUNKS_PER_THREAD	4
+#define WRITE_BLOCK_ROWS	4096
+#define MATRIX_DIMENSIONS	"dims"
+
+
+static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+									 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+									};
+
+static inline bool isSpace(const char character_)
+{
+	return character_ == ' ' || character_ == '\t' || character_ == '\r' || character_ == '\v' || character_ == '\f';
+}
+
+static inline bool isDigit(const char character_)
+{
+	return character_ >= '0' && character_ <= '9';
+}
+
+static inline bool nextLine(const char *&position_,
+							const char *end_,
+							const char *&lineBegin_,
+							const char *&lineEnd_)
+{
+	if (position_ >= end_)
+		return false;
+
+	lineBegin_ = position_;
+	lineEnd_ = (const char *) memchr(position_, '\n', end_ - position_);
+	if (lineEnd_ == NULL)
+		lineEnd_ = end_;
+	position_ = lineEnd_ < end_ ? lineEnd_ + 1 : end_;
+
+	return true;
+}
+
+static std::vector<std::string> tokenize(const char *begin_,
+										 const char *end_)
+{
+	std::vector<std::string> tokens;
+	const char *ptr = begin_;
+	while (ptr < end_)
+	{
+		while (ptr < end_ && isSpace(*ptr))
+			ptr++;
+		const char *token = ptr;
+		while (ptr < end_ && !isSpace(*ptr))
+			ptr++;
+		if (ptr > token)
+			tokens.push_back(std::string(token, ptr));
+	}
+	return tokens;
+}
+
+static size_t countLines(const char *begin_,
+						 const char *end_)
+{
+	size_t lines = 0;
+	const char *position = begin_, *lineBegin, *lineEnd;
+	while (nextLine(position, end_, lineBegin, lineEnd))
+		if (lineEnd > lineBegin)
+			lines++;
+	return lines;
+}
+
+static bool parseChunk(const char *begin_,
+					   const char *end_,
+					   const size_t firstRow_,
+					   cv::Mat &matrix_)
+{
+	size_t row = firstRow_;
+	const char *position = begin_, *lineBegin, *lineEnd;
+	while (nextLine(position, end_, lineBegin, lineEnd))
+	{
+		if (lineEnd == lineBegin)
+			continue;
+
+		float *data = matrix_.ptr<float>(row);
+		int col = 0;
+		const char *ptr = lineBegin;
+		while (ptr < lineEnd)
+		{
+			while (ptr < lineEnd && isSpace(*ptr))
+				ptr++;
+			const char *token = ptr;
+			while (ptr < lineEnd && !isSpace(*ptr))
+				ptr++;
+			if (ptr == token)
+				break;
+
+			if (col >= matrix_.cols)
+				return false;
+
+			// Values that can't be converted are replaced by zeros
+			if (!TextMatrix::parseFloat(token, ptr, data[col]))
+			{
+				LOGW << "NaN found at (r,c) = (" << row << "," << col << "). Changing to zero.";
+				data[col] = 0;
+			}
+			col++;
+		}
+
+		if (col != matrix_.cols)
+			return false;
+		row++;
+	}
+
+	return true;
+}
+
+bool TextMatrix::parseFloat(const char *begin_,
+							const char *end_,
+							float &value_)
+{
+	const char *ptr = begin_;
+	bool negative = false;
+	if (ptr < end_ && (*ptr == '-' || *ptr == '+'))
+		negative = *ptr++ == '-';
+	if (ptr == end_)
+		return false;
+
+	// Special values (accepted by the previous lexical_cast based parsing too)
+	if (!isDigit(*ptr) && *ptr != '.')
+	{
+		size_t length = end_ - ptr;
+		if (length == 3 && strncasecmp(ptr, "nan", 3) == 0)
+			value_ = std::numeric_limits<float>::quiet_NaN();
+		else if ((length == 3 && strncasecmp(ptr, "inf", 3) == 0) || (length == 8 && strncasecmp(ptr, "infinity", 8) == 0))
+			value_ = std::numeric_limits<float>::infinity();
+		else
+			return false;
+
+		value_ = negative ? -value_ : value_;
+		return true;
+	}
+
+	// Decimal digits (up to 19 significant ones fit in the mantissa)
+	uint64_t mantissa = 0;
+	int digits = 0, exponent = 0;
+	bool anyDigit = false, truncated = false;
+	for (; ptr < end_ && isDigit(*ptr); ptr++, anyDigit = true)
+	{
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*ptr - '0');
+			digits += mantissa > 0 ? 1 : 0;
+		}
+		else
+		{
+			exponent++;
+			truncated = truncated || *ptr != '0';
+		}
+	}
+	if (ptr < end_ && *ptr == '.')
+	{
+		for (ptr++; ptr < end_ && isDigit(*ptr); ptr++, anyDigit = true)
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*ptr - '0');
+				digits += mantissa > 0 ? 1 : 0;
+				exponent--;
+			}
+			else
+				truncated = truncated || *ptr != '0';
+		}
+	}
+	if (!anyDigit)
+		return false;
+
+	if (ptr < end_ && (*ptr == 'e' || *ptr == 'E'))
+	{
+		ptr++;
+		bool negativeExponent = false;
+		if (ptr < end_ && (*ptr == '-' || *ptr == '+'))
+			negativeExponent = *ptr++ == '-';
+		if (ptr == end_ || !isDigit(*ptr))
+			return false;
+
+		int value = 0;
+		for (; ptr < end_ && isDigit(*ptr); ptr++)
+			value = std::min(value * 10 + (*ptr - '0'), 100000);
+		exponent += negativeExponent ? -value : value;
+	}
+
+	// Trailing characters make the whole value invalid
+	if (ptr != end_)
+		return false;
+
+	// Both the mantissa and the power of ten are exact doubles, so the double is correctly rounded
+	bool exact = !truncated && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22;
+	double result = 0;
+	if (exact)
+		result = exponent < 0 ? mantissa / powersOfTen[-exponent] : mantissa * powersOfTen[exponent];
+
+	/**
+	 * Rounding that double to float gives the correctly rounded float, unless the double fell
+	 * exactly halfway between two floats (the tie may not be a tie in the decimal value)
+	 */
+	float rounded = result;
+	if (exact && (double) rounded != result)
+	{
+		float other = nextafterf(rounded, result > rounded ? std::numeric_limits<float>::infinity() : -std::numeric_limits<float>::infinity());
+		exact = (double) rounded + (double) other != 2 * result;
+	}
+
+	if (!exact)
+	{
+		// Uncommon values go straight to float through a stream with the classic locale (values
+		// out of the float range fail, as with lexical_cast)
+		std::istringstream stream(std::string(begin_, end_));
+		stream.imbue(std::locale::classic());
+		if (!(stream >> rounded))
+			return false;
+		rounded = std::abs(rounded);
+	}
+
+	value_ = negative ? -rounded : rounded;
+	return true;
+}
+
+int TextMatrix::formatFloat(const float value_,
+							char *buffer_)
+{
+	/**
+	 * With %g trailing zeros are dropped, so a value having a representation shorter than 6
+	 * digits is already printed that way. Otherwise the precision is increased until the text
+	 * reads back to the same float, which is guaranteed with 9 digits.
+	 */
+	int length = 0;
+	for (int precision = 6; precision <= 9; precision++)
+	{
+		length = snprintf(buffer_, 32, "%.*g", precision, value_);
+
+		float parsed;
+		if (!pcl_isfinite(value_) || (parseFloat(buffer_, buffer_ + length, parsed) && parsed == value_))
+			break;
+	}
+	return length;
+}
+
+bool TextMatrix::write(const std::string &filename_,
+					   const cv::Mat &matrix_,
+					   const std::vector<std::string> &metadata_)
+{
+	FILE *file = fopen(filename_.c_str(), "w");
+	if (file == NULL)
+		return false;
+
+	// Metadata and dimensions
+	std::ostringstream header;
+	header << "metadata_lines " << metadata_.size() << "\n";
+	for (size_t i = 0; i < metadata_.size(); i++)
+		header << metadata_[i] << "\n";
+	header << MATRIX_DIMENSIONS << " " << matrix_.rows << " " << matrix_.cols << "\n";
+	bool writeOk = fputs(header.str().c_str(), file) >= 0;
+
+	// Rows are formatted in blocks, each row into its own reusable buffer
+	std::vector<std::string> rows(std::min(WRITE_BLOCK_ROWS, std::max(matrix_.rows, 1)));
+	std::string block;
+	for (int first = 0; first < matrix_.rows && writeOk; first += WRITE_BLOCK_ROWS)
+	{
+		int count = std::min(WRITE_BLOCK_ROWS, matrix_.rows - first);
+
+		#pragma omp parallel for
+		for (int i = 0; i < count; i++)
+		{
+			char buffer[32];
+			const float *data = matrix_.ptr<float>(first + i);
+			rows[i].clear();
+			for (int j = 0; j < matrix_.cols; j++)
+			{
+				rows[i].append(buffer, formatFloat(data[j], buffer));
+				rows[i] += ' ';
+			}
+			rows[i] += '\n';
+		}
+
+		block.clear();
+		for (int i = 0; i < count; i++)
+			block += rows[i];
+		writeOk = fwrite(block.data(), 1, block.size(), file) == block.size();
+	}
+
+	writeOk = fclose(file) == 0 && writeOk;
+	return writeOk;
+}
+
+bool TextMatrix::read(const std::string &filename_,
+					  cv::Mat &matrix_,
+					  std::vector<std::string> *metadata_)
+{
+	int fileDescriptor = open(filename_.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat statbuf;
+	if (fstat(fileDescriptor, &statbuf) < 0)
+	{
+		close(fileDescriptor);
+		return false;
+	}
+
+	// Nothing to read from empty files
+	size_t fileSize = statbuf.st_size;
+	if (fileSize == 0)
+	{
+		close(fileDescriptor);
+		return true;
+	}
+
+	const char *buffer = (const char *) mmap(0, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	close(fileDescriptor);
+	if (buffer == MAP_FAILED)
+		return false;
+	madvise((void *) buffer, fileSize, MADV_SEQUENTIAL);
+
+	bool loadOk = true;
+	try
+	{
+		const char *end = buffer + fileSize;
+		const char *position = buffer, *lineBegin, *lineEnd;
+
+		// Metadata and dimensions are parsed sequentially (empty lines are skipped)
+		int metadataLines = -1;
+		bool dimensionsRead = false;
+		while (!dimensionsRead && nextLine(position, end, lineBegin, lineEnd))
+		{
+			if (lineEnd == lineBegin)
+				continue;
+
+			std::vector<std::string> tokens = tokenize(lineBegin, lineEnd);
+			if (metadataLines < 0)
+			{
+				if (tokens.size() < 2)
+					throw std::runtime_error("wrong metadata header");
+				metadataLines = atoi(tokens[1].c_str());
+			}
+			else if (metadataLines > 0)
+			{
+				if (metadata_ != NULL)
+					metadata_->push_back(std::string(lineBegin, lineEnd));
+				metadataLines--;
+			}
+			else
+			{
+				if (tokens.size() < 3)
+					throw std::runtime_error("wrong dimensions line");
+				matrix_ = cv::Mat::zeros(atoi(tokens[1].c_str()), atoi(tokens[2].c_str()), CV_32FC1);
+				dimensionsRead = true;
+			}
+		}
+
+		if (dimensionsRead && position < end)
+		{
+			// Split the data section in line aligned chunks
+			size_t dataSize = end - position;
+			size_t chunkNumber = std::max<size_t>(1, std::min<size_t>(sysconf(_SC_NPROCESSORS_ONLN) * CHUNKS_PER_THREAD, dataSize / MIN_CHUNK_SIZE));
+			std::vector<const char *> bounds(1, position);
+			for (size_t i = 1; i < chunkNumber; i++)
+			{
+				const char *candidate = std::max(position + i * dataSize / chunkNumber, bounds.back());
+				const char *newLine = (const char *) memchr(candidate, '\n', end - candidate);
+				if (newLine != NULL && newLine + 1 < end)
+					bounds.push_back(newLine + 1);
+			}
+			bounds.push_back(end);
+			int chunks = bounds.size() - 1;
+
+			// Find the first row of each chunk
+			std::vector<size_t> lines(chunks, 0);
+			#pragma omp parallel for
+			for (int i = 0; i < chunks; i++)
+				lines[i] = countLines(bounds[i], bounds[i + 1]);
+
+			std::vector<size_t> firstRow(chunks, 0);
+			for (int i = 1; i < chunks; i++)
+				firstRow[i] = firstRow[i - 1] + lines[i - 1];
+			if (firstRow.back() + lines.back() > (size_t) matrix_.rows)
+				throw std::runtime_error("more rows than declared");
+
+			// Parse the chunks directly into their rows
+			std::vector<char> chunkOk(chunks, 1);
+			#pragma omp parallel for schedule(dynamic)
+			for (int i = 0; i < chunks; i++)
+				chunkOk[i] = parseChunk(bounds[i], bounds[i + 1], firstRow[i], matrix_);
+
+			for (int i = 0; i < chunks; i++)
+				loadOk = loadOk && chunkOk[i];
+			if (!loadOk)
+				LOGE << "Wrong number of columns in " << filename_;
+		}
+	}
+	catch (std::exception &_ex)
+	{
+		LOGE << "ERROR: " << _ex.what();
+		loadOk = false;
+	}
+
+	munmap((void *) buffer, fileSize);
+	return loadOk;
+}
@@ -9,6 +9,8 @@
 #include <sstream>
 #include <stdlib.h>
 #include <cstdlib>
+#include <cstdio>
+#include <boost/filesystem.hpp>
 #include <pcl/pcl_macros.h>
 #include <pcl/io/pcd_io.h>
 #include <opencv2/core/core.hpp>
@@ -17,11 +19,15 @@
 #include "CloudFactory.hpp"
 #include "PointFactory.hpp"
 #include "Utils.hpp"
+#include "CloudUtils.hpp"
+#include "BinaryMatrix.hpp"
+#include "TextMatrix.hpp"
+#include "CompressedMatrix.hpp"
+#include "CacheManager.hpp"
 #include "Config.hpp"
 #include "DCH.hpp"
 
 
-#define MATRIX_DIMENSIONS			"dims"
 #define SCRIPT_HISTOGRAM_NAME		OUTPUT_DIR "histogram.script"
 #define SCRIPT_SSE_NAME				OUTPUT_DIR "sse.script"
 #define HISTOGRAM_DATA_FILE			OUTPUT_DIR "histogram.dat"
@@ -178,7 +184,7 @@ Writer::generatePlanes(const std::vector<BandPtr> &bands_,
 	return planes;
 }
 
-void Writer::writeOuputData(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+bool Writer::writeOuputData(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 							const std::vector<BandPtr> &bands_,
 							const DescriptorParamsPtr &params_,
 							const int targetPoint_)
@@ -187,20 +193,21 @@ void Writer::writeOuputData(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_
 	if (params == NULL)
 	{
 		LOGW << "Output data generation only for DCH, skipping";
-		return;
+		return true;
 	}
 
 
+	bool writeOk = true;
 	pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr colorCloud = CloudFactory::createColorCloud(cloud_, Utils::palette12(0));
-	pcl::io::savePCDFileASCII(OUTPUT_DIR "cloud.pcd", *colorCloud);
+	writeOk = CloudUtils::saveCloud(OUTPUT_DIR "cloud.pcd", *colorCloud) && writeOk;
 
 
 	(*colorCloud)[targetPoint_].rgba = Utils::getColor(255, 0, 0);
-	pcl::io::savePCDFileASCII(OUTPUT_DIR "pointPosition.pcd", *colorCloud);
+	writeOk = CloudUtils::saveCloud(OUTPUT_DIR "pointPosition.pcd", *colorCloud) && writeOk;
 
 
 	pcl::PointCloud<pcl::PointNormal>::Ptr patch = Extractor::getNeighbors(cloud_, cloud_->at(targetPoint_), params->searchRadius);
-	pcl::io::savePCDFileASCII(OUTPUT_DIR "patch.pcd", *patch);
+	writeOk = CloudUtils::saveCloud(OUTPUT_DIR "patch.pcd", *patch) && writeOk;
 
 
 	std::vector<pcl::PointCloud<pcl::PointNormal>::Ptr> planes = generatePlanes(bands_, params);
@@ -210,10 +217,10 @@ void Writer::writeOuputData(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_
 		{
 			char name[100];
 			sprintf(name, OUTPUT_DIR "band%d.pcd", (int) i);
-			pcl::io::savePCDFileASCII(name, *CloudFactory::createColorCloud(bands_[i]->points, Utils::palette12(i + 1)));
+			writeOk = CloudUtils::saveCloud(name, *CloudFactory::createColorCloud(bands_[i]->points, Utils::palette12(i + 1))) && writeOk;
 
 			sprintf(name, OUTPUT_DIR "planeBand%d.pcd", (int) i);
-			pcl::io::savePCDFileASCII(name, *planes[i]);
+			writeOk = CloudUtils::saveCloud(name, *planes[i]) && writeOk;
 		}
 	}
 
@@ -234,6 +241,8 @@ void Writer::writeOuputData(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_
 		output << "\n";
 	}
 	output.close();
+
+	return writeOk && !output.fail();
 }
 
 void Writer::writePlotSSE(const std::string &filename_,
@@ -278,7 +287,7 @@ void Writer::writePlotSSE(const std::string &filename_,
 		LOGW << "Bad return for command: " << cmd;
 }
 
-void Writer::writeClusteredCloud(const std::string &filename_,
+bool Writer::writeClusteredCloud(const std::string &filename_,
 								 const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 								 const cv::Mat &labels_)
 {
@@ -316,7 +325,7 @@ void Writer::writeClusteredCloud(const std::string &filename_,
 		(*colored)[i].rgba = Utils::palette35(index);
 	}
 
-	pcl::io::savePCDFileASCII(filename_, *colored);
+	return CloudUtils::saveCloud(filename_, *colored);
 }
 
 void Writer::writeDistanceMatrix(const std::string &outputFolder_,
@@ -375,7 +384,7 @@ void Writer::writeDistanceMatrix(const std::string &outputFolder_,
 	cv::imwrite(outputFolder_ + "distanceToCenter.png", imageDistToCenter);
 }
 
-void Writer::writeDescriptorsCache(const cv::Mat &descriptors_,
+bool Writer::writeDescriptorsCache(const cv::Mat &descriptors_,
 								   const std::string &cacheLocation_,
 								   const std::string &cloudInputFilename_,
 								   const double normalEstimationRadius_,
@@ -393,10 +402,46 @@ void Writer::writeDescriptorsCache(const cv::Mat &descriptors_,
 	metadata.push_back(descriptorParams_->toString());
 	metadata.push_back(smoothingParams_.toString());
 
-	writeMatrix(destination, descriptors_, metadata);
+	std::string temporary = Utils::getTemporaryFilename(destination);
+	if (!writeMatrix(temporary, descriptors_, metadata) || !publish(temporary, destination))
+	{
+		remove(temporary.c_str());
+		return false;
+	}
+
+	CacheManager::registerWrite(cacheLocation_, destination);
+	return true;
+}
+
+void Writer::writeCloudCache(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+							 const std::string &cacheLocation_,
+							 const std::string &cloudInputFilename_,
+							 const double normalEstimationRadius_,
+							 const CloudSmoothingParams &smoothingParams_)
+{
+	writeCloudCache(cloud_, cacheLocation_, cacheLocation_ + Utils::getPreprocessingHash(cloudInputFilename_, normalEstimationRadius_, smoothingParams_) + CLOUD_FILE_EXTENSION);
+}
+
+void Writer::writeCloudCache(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+							 const std::string &cacheLocation_,
+							 const std::string &destination_)
+{
+	if (!boost::filesystem::exists(cacheLocation_))
+		if (system(("mkdir " + cacheLocation_).c_str()) != 0)
+			LOGW << "Can't create cache folder";
+
+	// Binary, so the cloud is read back without any parsing (nor precision loss)
+	std::string temporary = Utils::getTemporaryFilename(destination_);
+	if (pcl::io::savePCDFileBinary(temporary, *cloud_) != 0)
+	{
+		LOGW << "Unable to write cloud cache " << destination_;
+		remove(temporary.c_str());
+	}
+	else if (publish(temporary, destination_))
+		CacheManager::registerWrite(cacheLocation_, destination_);
 }
 
-void Writer::writeClustersCenters(const std::string &filename_,
+bool Writer::writeClustersCenters(const std::string &filename_,
 								  const cv::Mat &centers_,
 								  const DescriptorParamsPtr &descriptorParams_,
 								  const ClusteringParams &clusteringParams_,
@@ -407,10 +452,10 @@ void Writer::writeClustersCenters(const std::string &filename_,
 	metadata.push_back(clusteringParams_.toString());
 	metadata.push_back(smoothingParams_.toString());
 
-	writeMatrix(filename_, centers_, metadata);
+	return writeMatrix(filename_, centers_, metadata);
 }
 
-void Writer::writeCodebook(const std::string &filename_,
+bool Writer::writeCodebook(const std::string &filename_,
 						   const cv::Mat &centers_,
 						   const ClusteringParams &clusteringParams_,
 						   const Params::DescriptorType &type_,
@@ -444,45 +489,49 @@ void Writer::writeCodebook(const std::string &filename_,
 	metadata.push_back(clusteringParams_.toString());
 	metadata.push_back(str);
 
-	Writer::writeMatrix(filename_, centers_, metadata);
+	return Writer::writeMatrix(filename_, centers_, metadata);
 }
 
 void Writer::saveCloudMatrix(const std::string &filename_,
 							 const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_)
 {
-	cv::Mat items = cv::Mat::zeros(cloud_->size(), 3, CV_32FC1);
-	for (size_t i = 0; i < cloud_->size(); i++)
-	{
-		items.at<float>(i, 0) = cloud_->at(i).x;
-		items.at<float>(i, 1) = cloud_->at(i).y;
-		items.at<float>(i, 2) = cloud_->at(i).z;
-	}
-
-	Writer::writeMatrix(filename_, items);
+	// The matrix is only read while writing, so a view over the cloud is enough
+	Writer::writeMatrix(filename_, CloudUtils::pointsView(cloud_));
 }
 
-void Writer::writeMatrix(const std::string &filename_,
+bool Writer::writeMatrix(const std::string &filename_,
 						 const cv::Mat &matrix_,
 						 const std::vector<std::string> &metadata_)
 {
-	std::ofstream outputFile;
-	outputFile.open(filename_.c_str(), std::fstream::out);
+	bool writeOk = false;
+	switch (Config::getMatrixFormat())
+	{
+	case Params::MATRIX_TEXT:
+		writeOk = TextMatrix::write(filename_, matrix_, metadata_);
+		break;
+	case Params::MATRIX_BINARY:
+		writeOk = BinaryMatrix::write(filename_, matrix_, metadata_);
+		break;
+	case Params::MATRIX_COMPRESSED:
+		writeOk = CompressedMatrix::write(filename_, matrix_, metadata_);
+		break;
+	}
 
-	// Write metadata header
-	outputFile << "metadata_lines " << metadata_.size() << "\n";
+	if (!writeOk)
+		LOGE << "Unable to write matrix " << filename_;
 
-	// Write metadata
-	for (size_t i = 0; i < metadata_.size(); i++)
-		outputFile << metadata_[i] << "\n";
+	return writeOk;
+}
 
-	// Write the matrix actual data
-	outputFile << MATRIX_DIMENSIONS << " " << matrix_.rows << " " << matrix_.cols << "\n";
-	for (int i = 0; i < matrix_.rows; i++)
+bool Writer::publish(const std::string &temporary_,
+					 const std::string &destination_)
+{
+	// rename() is atomic, so readers see either no entry or the complete one
+	if (rename(temporary_.c_str(), destination_.c_str()) != 0)
 	{
-		for (int j = 0; j < matrix_.cols; j++)
-			outputFile << std::setprecision(15) << matrix_.at<float>(i, j) << " ";
-		outputFile << "\n";
+		LOGW << "Unable to publish " << destination_;
+		remove(temporary_.c_str());
+		return false;
 	}
-
-	outputFile.close();
+	return true;
 }
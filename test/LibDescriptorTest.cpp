@@ -108,6 +108,52 @@ BOOST_FIXTURE_TEST_CASE(fillDescriptor_halfSphere, DCHFixture)
 	}
 }
 
+BOOST_FIXTURE_TEST_CASE(canonicalize, DCHFixture)
+{
+	params->bandNumber = 4;
+	params->binNumber = 2;
+	params->stat = Params::STAT_MEAN;
+
+	// Band 1 has the largest mean absolute angle (empty bins ignored)
+	float descriptor[] = {0.1, DCH_EMPTY_BIN_VALUE, 0.5, -0.6, DCH_EMPTY_BIN_VALUE, DCH_EMPTY_BIN_VALUE, 0.2, 0.2};
+	float expected[] = {0.5, -0.6, DCH_EMPTY_BIN_VALUE, DCH_EMPTY_BIN_VALUE, 0.2, 0.2, 0.1, DCH_EMPTY_BIN_VALUE};
+
+	BOOST_CHECK_EQUAL(DCH::canonicalize(descriptor, params), 1);
+	for (int i = 0; i < 8; i++)
+		BOOST_CHECK_EQUAL(descriptor[i], expected[i]);
+
+	// Already canonical
+	BOOST_CHECK_EQUAL(DCH::canonicalize(descriptor, params), 0);
+
+	// Ties resolved by the lowest index
+	float tied[] = {0.1, 0.1, 0.3, -0.3, 0.1, 0.1, -0.3, 0.3};
+	BOOST_CHECK_EQUAL(DCH::canonicalize(tied, params), 1);
+	BOOST_CHECK_EQUAL(tied[0], 0.3f);
+	BOOST_CHECK_EQUAL(tied[1], -0.3f);
+}
+
+BOOST_FIXTURE_TEST_CASE(computeDense_matches_computePoint, DCHFixture)
+{
+	// Generate cloud
+	pcl::PointCloud<pcl::PointNormal>::Ptr cloud = CloudFactory::createSphereSection(M_PI, 10, Eigen::Vector3f(0, 0, 0), 2000);
+
+	cv::Mat descriptors;
+	DCH::computeDense(cloud, paramsPtr, descriptors);
+	BOOST_CHECK_EQUAL(descriptors.rows, cloud->size());
+	BOOST_CHECK_EQUAL(descriptors.cols, params->sizePerBand() * params->bandNumber);
+
+	// The dense (SoA based) computation must give exactly the same values than the per point one
+	for (int i = 0; i < descriptors.rows; i += 97)
+	{
+		Eigen::VectorXf descriptor;
+		DCH::computePoint(cloud, paramsPtr, i, descriptor);
+
+		BOOST_CHECK_EQUAL(descriptor.size(), descriptors.cols);
+		for (int j = 0; j < descriptor.size(); j++)
+			BOOST_CHECK_EQUAL(descriptors.at<float>(i, j), descriptor(j));
+	}
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 /**************************************************/
 
@@ -176,6 +222,35 @@ BOOST_AUTO_TEST_SUITE_END()
 /**************************************************/
 BOOST_AUTO_TEST_SUITE(Extractor_class_suite)
 
+BOOST_AUTO_TEST_CASE(subsampleNeighbors)
+{
+	std::vector<int> indices;
+	std::vector<float> distances;
+	for (int i = 0; i < 100; i++)
+	{
+		indices.push_back(i * 2);
+		distances.push_back(i * 0.5);
+	}
+
+	// No changes if the limit isn't reached or if there's no limit
+	std::vector<int> indices2 = indices;
+	std::vector<float> distances2 = distances;
+	Extractor::subsampleNeighbors(indices2, distances2, -1);
+	BOOST_CHECK_EQUAL(indices2.size(), 100);
+	Extractor::subsampleNeighbors(indices2, distances2, 100);
+	BOOST_CHECK_EQUAL(indices2.size(), 100);
+
+	// One point per stratum, covering the whole range of distances
+	Extractor::subsampleNeighbors(indices, distances, 10);
+	BOOST_CHECK_EQUAL(indices.size(), 10);
+	BOOST_CHECK_EQUAL(distances.size(), 10);
+	for (int i = 0; i < 10; i++)
+	{
+		BOOST_CHECK_EQUAL(indices[i], i * 20);
+		BOOST_CHECK_CLOSE(distances[i], i * 5, 1e-5);
+	}
+}
+
 BOOST_FIXTURE_TEST_CASE(getBands_no_bidirectional, DCHFixture)
 {
 	params->bidirectional = false;
@@ -0,0 +1,1116 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include <boost/test/unit_test.hpp>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <stdint.h>
+#include <map>
+#include <limits>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/filesystem.hpp>
+#include <pcl/io/pcd_io.h>
+#include <pcl/common/io.h>
+#include "PCDReader.hpp"
+#include "PCDStreamReader.hpp"
+#include "BatchLoader.hpp"
+#include "Loader.hpp"
+#include "CloudUtils.hpp"
+#include "BinaryMatrix.hpp"
+#include "TextMatrix.hpp"
+#include "CompressedMatrix.hpp"
+#include "CacheLock.hpp"
+#include "CacheManager.hpp"
+#include "Writer.hpp"
+#include "AsyncWriter.hpp"
+#include "Config.hpp"
+#include "Utils.hpp"
+
+/**************************************************/
+// Auxiliary method defined to be used while testing
+static pcl::PointCloud<pcl::PointXYZ>::Ptr generateCloud(const int points_)
+{
+	// Points over a slightly bent surface, so every normal is well defined
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
+	for (int i = 0; i < points_; i++)
+	{
+		float x = (i % 7) * 0.01;
+		float y = (i / 7) * 0.01;
+		cloud->push_back(pcl::PointXYZ(x, y, x * x + 0.5 * y * y));
+	}
+	return cloud;
+}
+
+static pcl::PointCloud<pcl::PointXYZ>::Ptr generateGrid(const int points_)
+{
+	// Coordinates exactly representable in float and in text, so every read has to match bit by bit
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
+	for (int i = 0; i < points_; i++)
+		cloud->push_back(pcl::PointXYZ((i % 8) * 0.0625, ((i / 8) % 8) * 0.0625, (i / 64) * 0.0625 - 0.125));
+	return cloud;
+}
+
+static void readStream(const std::string &filename_,
+					   const size_t chunkSize_,
+					   pcl::PointCloud<pcl::PointXYZ> &cloud_,
+					   std::vector<size_t> &chunkSizes_)
+{
+	cloud_.clear();
+	chunkSizes_.clear();
+
+	PCDStreamReader reader;
+	BOOST_REQUIRE(reader.open(filename_));
+
+	pcl::PointCloud<pcl::PointXYZ> chunk;
+	while (reader.read(chunk, chunkSize_) > 0)
+	{
+		BOOST_CHECK_EQUAL(chunk.height, 1U);
+		BOOST_CHECK_EQUAL(chunk.width, chunk.size());
+		chunkSizes_.push_back(chunk.size());
+		cloud_ += chunk;
+	}
+	BOOST_CHECK(reader.finished());
+	reader.close();
+}
+
+static bool parsesAsStrtof(const std::string &token_)
+{
+	float parsed, expected = strtof(token_.c_str(), NULL);
+	return TextMatrix::parseFloat(token_.c_str(), token_.c_str() + token_.size(), parsed) && memcmp(&parsed, &expected, sizeof(float)) == 0;
+}
+
+static bool rejected(const std::string &token_)
+{
+	float parsed;
+	return !TextMatrix::parseFloat(token_.c_str(), token_.c_str() + token_.size(), parsed);
+}
+
+static void computeOnce(const std::string &cacheLocation_,
+						const std::string &input_,
+						const DescriptorParamsPtr &params_,
+						const float value_,
+						int &computed_,
+						cv::Mat &descriptors_)
+{
+	// Same pattern than the applications: check, lock, check again, compute and publish
+	CloudSmoothingParams smoothing;
+	if (Loader::loadDescriptors(cacheLocation_, input_, 0.01, params_, smoothing, descriptors_))
+		return;
+
+	CacheLock lock(cacheLocation_ + Utils::getCalculationConfigHash(input_, 0.01, params_, smoothing));
+	BOOST_CHECK(lock.isLocked());
+	if (Loader::loadDescriptors(cacheLocation_, input_, 0.01, params_, smoothing, descriptors_))
+		return;
+
+	// Slow enough for the other thread to find the entry missing and wait on the lock
+	boost::this_thread::sleep(boost::posix_time::milliseconds(300));
+	descriptors_ = cv::Mat(20, 5, CV_32FC1, cv::Scalar(value_));
+	BOOST_CHECK(Writer::writeDescriptorsCache(descriptors_, cacheLocation_, input_, 0.01, params_, smoothing));
+	computed_++;
+}
+
+static void setOutputQueueSize(const int size_)
+{
+	std::string configFile = "./async_writer_test.yaml";
+	std::ofstream config(configFile.c_str());
+	config << "outputQueueSize: " << size_ << "\n";
+	config.close();
+	BOOST_CHECK(Config::load(configFile));
+	remove(configFile.c_str());
+}
+
+static void setCacheSizeLimit(const int limit_)
+{
+	std::string configFile = "./cache_manager_test.yaml";
+	std::ofstream config(configFile.c_str());
+	config << "cacheSizeLimit: " << limit_ << "\n";
+	config.close();
+	BOOST_CHECK(Config::load(configFile));
+	remove(configFile.c_str());
+}
+
+static void setCloudCache(const std::string &cacheLocation_)
+{
+	// An empty location disables the cloud cache
+	std::string configFile = "./cloud_cache_test.yaml";
+	std::ofstream config(configFile.c_str());
+	config << "cacheLocation: \"" << cacheLocation_ << "\"\n";
+	config << "cloudCache: " << (cacheLocation_.empty() ? "false" : "true") << "\n";
+	config.close();
+	BOOST_CHECK(Config::load(configFile));
+	remove(configFile.c_str());
+}
+
+static void writeFile(const std::string &filename_,
+					  const size_t size_)
+{
+	std::ofstream file(filename_.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	file << std::string(size_, 'x');
+	file.close();
+}
+
+static void writeClusteredClouds(const std::vector<std::string> &filenames_)
+{
+	for (size_t i = 0; i < filenames_.size(); i++)
+	{
+		pcl::PointCloud<pcl::PointNormal>::Ptr cloud(new pcl::PointCloud<pcl::PointNormal>());
+		pcl::copyPointCloud(*generateCloud(40 + i), *cloud);
+		cv::Mat labels = cv::Mat::zeros(cloud->size(), 1, CV_32SC1);
+
+		// The data is handed over, nothing is left to the caller
+		AsyncWriter::writeClusteredCloud(filenames_[i], cloud, labels);
+		BOOST_CHECK(!cloud);
+		BOOST_CHECK(labels.empty());
+	}
+}
+
+static void checkClusteredClouds(const std::vector<std::string> &filenames_)
+{
+	for (size_t i = 0; i < filenames_.size(); i++)
+	{
+		pcl::PointCloud<pcl::PointXYZRGBNormal> cloud;
+		BOOST_REQUIRE(pcl::io::loadPCDFile(filenames_[i], cloud) == 0);
+		BOOST_CHECK_EQUAL(cloud.size(), 40 + i);
+		remove(filenames_[i].c_str());
+	}
+}
+
+static void checkEqual(const cv::Mat &expected_,
+					   const cv::Mat &actual_)
+{
+	BOOST_REQUIRE_EQUAL(actual_.type(), CV_32FC1);
+	BOOST_REQUIRE_EQUAL(actual_.rows, expected_.rows);
+	BOOST_REQUIRE_EQUAL(actual_.cols, expected_.cols);
+	for (int i = 0; i < expected_.rows; i++)
+		BOOST_CHECK(memcmp(expected_.ptr<float>(i), actual_.ptr<float>(i), expected_.cols * sizeof(float)) == 0);
+}
+/**************************************************/
+
+/**************************************************/
+BOOST_AUTO_TEST_SUITE(PCDReader_class_suite)
+
+BOOST_AUTO_TEST_CASE(readHeader)
+{
+	std::string filename = "./pcd_reader_header_test.pcd";
+	std::string header = "VERSION 0.7\nFIELDS x y z\nSIZE 4 4 4\nTYPE F F F\nCOUNT 1 1 1\nWIDTH 2\nHEIGHT 1\nVIEWPOINT 0 0 0 1 0 0 0\nPOINTS 2\n";
+
+	std::ofstream file(filename.c_str());
+	file << header << "DATA ascii\n0 0 0\n1 1 1\n";
+	file.close();
+
+	PCDHeader parsed;
+	BOOST_CHECK(PCDReader::readHeader(filename, parsed));
+	BOOST_CHECK_EQUAL(parsed.encoding, Params::PCD_ASCII);
+	BOOST_CHECK_EQUAL(parsed.points, 2U);
+	BOOST_CHECK_EQUAL(parsed.fields.size(), 3U);
+
+	// An unknown encoding must never be read as binary
+	file.open(filename.c_str());
+	file << header << "DATA binery\n0 0 0\n1 1 1\n";
+	file.close();
+	BOOST_CHECK(!PCDReader::readHeader(filename, parsed));
+
+	pcl::PointCloud<pcl::PointXYZ> cloud;
+	BOOST_CHECK(!PCDReader::read(filename, cloud));
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/**************************************************/
+
+/**************************************************/
+BOOST_AUTO_TEST_SUITE(PCDStreamReader_class_suite)
+
+BOOST_AUTO_TEST_CASE(chunks)
+{
+	std::string filename = "./pcd_stream_test.pcd";
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud = generateGrid(25);
+
+	for (int encoding = 0; encoding < 2; encoding++)
+	{
+		if (encoding == 0)
+			pcl::io::savePCDFileASCII(filename, *cloud);
+		else
+			pcl::io::savePCDFileBinary(filename, *cloud);
+
+		pcl::PointCloud<pcl::PointXYZ> streamed;
+		std::vector<size_t> chunkSizes;
+		readStream(filename, 10, streamed, chunkSizes);
+
+		BOOST_REQUIRE_EQUAL(chunkSizes.size(), 3U);
+		BOOST_CHECK_EQUAL(chunkSizes[0], 10U);
+		BOOST_CHECK_EQUAL(chunkSizes[1], 10U);
+		BOOST_CHECK_EQUAL(chunkSizes[2], 5U);
+
+		BOOST_REQUIRE_EQUAL(streamed.size(), cloud->size());
+		for (size_t i = 0; i < cloud->size(); i++)
+		{
+			BOOST_CHECK_EQUAL(streamed.points[i].x, cloud->points[i].x);
+			BOOST_CHECK_EQUAL(streamed.points[i].y, cloud->points[i].y);
+			BOOST_CHECK_EQUAL(streamed.points[i].z, cloud->points[i].z);
+		}
+	}
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(truncatedFiles)
+{
+	std::string filename = "./pcd_stream_truncated_test.pcd";
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud = generateGrid(25);
+
+	// Binary file cut in the middle of the 13th point
+	pcl::io::savePCDFileBinary(filename, *cloud);
+	uintmax_t dataStart = boost::filesystem::file_size(filename) - 25 * 3 * sizeof(float);
+	boost::filesystem::resize_file(filename, dataStart + 12 * 3 * sizeof(float) + 5);
+
+	pcl::PointCloud<pcl::PointXYZ> streamed;
+	std::vector<size_t> chunkSizes;
+	readStream(filename, 10, streamed, chunkSizes);
+	BOOST_REQUIRE_EQUAL(streamed.size(), 12U);
+	BOOST_CHECK_EQUAL(streamed.points[11].x, cloud->points[11].x);
+	BOOST_CHECK_EQUAL(streamed.points[11].y, cloud->points[11].y);
+
+	// ASCII file missing its last lines
+	std::ofstream file(filename.c_str());
+	file << "VERSION 0.7\nFIELDS x y z\nSIZE 4 4 4\nTYPE F F F\nCOUNT 1 1 1\nWIDTH 25\nHEIGHT 1\nVIEWPOINT 0 0 0 1 0 0 0\nPOINTS 25\nDATA ascii\n";
+	for (int i = 0; i < 12; i++)
+		file << cloud->points[i].x << " " << cloud->points[i].y << " " << cloud->points[i].z << "\n";
+	file.close();
+
+	readStream(filename, 10, streamed, chunkSizes);
+	BOOST_REQUIRE_EQUAL(streamed.size(), 12U);
+	BOOST_CHECK_EQUAL(streamed.points[11].x, cloud->points[11].x);
+
+	// Compressed files are stored as a single block, so they're refused
+	pcl::io::savePCDFileBinaryCompressed(filename, *cloud);
+	PCDStreamReader reader;
+	BOOST_CHECK(!reader.open(filename));
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/**************************************************/
+
+/**************************************************/
+BOOST_AUTO_TEST_SUITE(Loader_class_suite)
+
+BOOST_AUTO_TEST_CASE(streamDownsample)
+{
+	std::string filename = "./stream_downsample_test.pcd";
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud = generateCloud(300);
+	cloud->points[17].x = std::numeric_limits<float>::quiet_NaN();
+	cloud->points[150].z = std::numeric_limits<float>::quiet_NaN();
+	cloud->is_dense = false;
+	pcl::io::savePCDFileBinary(filename, *cloud);
+
+	// Streaming in small chunks has to give exactly the same centroids than downsampling in memory
+	pcl::PointCloud<pcl::PointXYZ>::Ptr streamed;
+	BOOST_REQUIRE(Loader::streamDownsample(filename, 0.025, streamed, 7));
+
+	CloudUtils::removeNANs(cloud);
+	pcl::PointCloud<pcl::PointXYZ>::Ptr downsampled = CloudUtils::downsample(cloud, 0.025);
+
+	BOOST_CHECK(downsampled->size() < cloud->size());
+	BOOST_REQUIRE_EQUAL(streamed->size(), downsampled->size());
+	for (size_t i = 0; i < downsampled->size(); i++)
+	{
+		BOOST_CHECK_EQUAL(streamed->points[i].x, downsampled->points[i].x);
+		BOOST_CHECK_EQUAL(streamed->points[i].y, downsampled->points[i].y);
+		BOOST_CHECK_EQUAL(streamed->points[i].z, downsampled->points[i].z);
+	}
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(tileCloud)
+{
+	std::string filename = "./tile_cloud_test.pcd";
+	std::string directory = "./tile_cloud_test";
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud = generateGrid(256);
+	cloud->points[3].y = std::numeric_limits<float>::quiet_NaN();
+	cloud->is_dense = false;
+	pcl::io::savePCDFileBinary(filename, *cloud);
+
+	float tileSize = 0.25;
+	float margin = 0.0625;
+	std::vector<CloudTile> tiles;
+	BOOST_REQUIRE(Loader::tileCloud(filename, tileSize, margin, directory, tiles, 50));
+	BOOST_CHECK(tiles.size() > 1);
+
+	std::vector<int> owners(cloud->size(), 0);
+	for (size_t t = 0; t < tiles.size(); t++)
+	{
+		pcl::PointCloud<pcl::PointXYZ> tile;
+		BOOST_REQUIRE(pcl::io::loadPCDFile(tiles[t].filename, tile) == 0);
+		BOOST_CHECK_EQUAL(tile.size(), tiles[t].points);
+
+		// Every point in a tile lies in its box grown by the margin
+		Eigen::Vector3f low = tiles[t].minCorner - Eigen::Vector3f::Constant(margin);
+		Eigen::Vector3f high = tiles[t].maxCorner + Eigen::Vector3f::Constant(margin);
+		for (size_t i = 0; i < tile.size(); i++)
+		{
+			Eigen::Vector3f p = tile.points[i].getVector3fMap();
+			BOOST_CHECK((p.array() >= low.array()).all() && (p.array() < high.array()).all());
+		}
+
+		for (size_t i = 0; i < cloud->size(); i++)
+			if (tiles[t].contains(cloud->points[i]))
+				owners[i]++;
+	}
+
+	// Every finite point belongs to the core of exactly one tile
+	for (size_t i = 0; i < cloud->size(); i++)
+		BOOST_CHECK_EQUAL(owners[i], i == 3 ? 0 : 1);
+
+	boost::filesystem::remove_all(directory);
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/**************************************************/
+
+/**************************************************/
+BOOST_AUTO_TEST_SUITE(BatchLoader_class_suite)
+
+BOOST_AUTO_TEST_CASE(inputOrder)
+{
+	std::vector<std::string> filenames;
+	std::map<std::string, size_t> sizes;
+	for (int i = 0; i < 5; i++)
+	{
+		std::string filename = "./batch_loader_test_" + boost::lexical_cast<std::string>(i) + ".pcd";
+		pcl::io::savePCDFileBinary(filename, *generateCloud(20 + 5 * i));
+		filenames.push_back(filename);
+		sizes[filename] = 20 + 5 * i;
+	}
+
+	// Files that can't be read are reported in their place, without stopping the batch
+	std::string missing = "./batch_loader_missing.pcd";
+	std::string corrupted = "./batch_loader_corrupted.pcd";
+	std::ofstream file(corrupted.c_str());
+	file << "not a cloud";
+	file.close();
+	filenames.insert(filenames.begin() + 1, missing);
+	filenames.insert(filenames.begin() + 4, corrupted);
+
+	BatchLoader loader(filenames, -1, CloudSmoothingParams(), 1);
+	LoadedCloud loaded;
+	size_t count = 0;
+	while (loader.next(loaded))
+	{
+		BOOST_REQUIRE(count < filenames.size());
+		BOOST_CHECK_EQUAL(loaded.filename, filenames[count]);
+
+		bool readable = loaded.filename != missing && loaded.filename != corrupted;
+		BOOST_CHECK_EQUAL(loaded.loadOk, readable);
+		if (readable && loaded.loadOk)
+		{
+			BOOST_CHECK_EQUAL(loaded.cloud->size(), sizes[loaded.filename]);
+			BOOST_CHECK(pcl_isfinite(loaded.cloud->points[0].normal_z));
+		}
+
+		// No graph asked (nor any radius to build it with)
+		BOOST_CHECK(!loaded.graph);
+		count++;
+	}
+	BOOST_CHECK_EQUAL(count, filenames.size());
+
+	for (size_t i = 0; i < filenames.size(); i++)
+		remove(filenames[i].c_str());
+}
+
+BOOST_AUTO_TEST_CASE(graph)
+{
+	std::string filename = "./batch_loader_graph_test.pcd";
+	pcl::io::savePCDFileBinary(filename, *generateCloud(50));
+	std::vector<std::string> filenames(2, filename);
+
+	BatchLoader loader(filenames, -1, CloudSmoothingParams(), 1, true, 0.02);
+	LoadedCloud loaded;
+	while (loader.next(loaded))
+	{
+		BOOST_CHECK(loaded.loadOk);
+		BOOST_REQUIRE(loaded.graph);
+		BOOST_CHECK_EQUAL(loaded.graph->size(), loaded.cloud->size());
+		BOOST_CHECK(loaded.graph->getRadius() >= 0.02);
+	}
+
+	// Without a positive radius there's no graph to deliver
+	BatchLoader noRadius(filenames, -1, CloudSmoothingParams(), 1, true);
+	while (noRadius.next(loaded))
+		BOOST_CHECK(!loaded.graph);
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(earlyStop)
+{
+	std::string filename = "./batch_loader_stop_test.pcd";
+	pcl::io::savePCDFileBinary(filename, *generateCloud(30));
+	std::vector<std::string> filenames(20, filename);
+
+	{
+		BatchLoader loader(filenames, -1, CloudSmoothingParams(), 1);
+
+		// Give both stages time to fill their queues and block on them
+		boost::this_thread::sleep(boost::posix_time::milliseconds(200));
+
+		LoadedCloud loaded;
+		BOOST_CHECK(loader.next(loaded));
+		loader.stop();
+
+		// Once stopped, only what was already delivered can be drained
+		size_t remaining = 0;
+		while (loader.next(loaded))
+			remaining++;
+		BOOST_CHECK(remaining <= 1);
+	}
+
+	{
+		// The destructor has to unblock both stages too
+		BatchLoader loader(filenames, -1, CloudSmoothingParams(), 1);
+		boost::this_thread::sleep(boost::posix_time::milliseconds(200));
+	}
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(cloudCache)
+{
+	std::string cacheLocation = "./batch_loader_cache_test/";
+	std::string input = "./batch_loader_cache_test.pcd";
+	boost::filesystem::remove_all(cacheLocation);
+	pcl::io::savePCDFileBinary(input, *generateCloud(30));
+	setCloudCache(cacheLocation);
+
+	std::string entry = Loader::getCloudCacheEntry(input, -1, CloudSmoothingParams());
+	BOOST_REQUIRE(!entry.empty());
+
+	// The first batch preprocesses and publishes the cloud, the second one reads it back
+	uint64_t hits = CacheManager::getHits();
+	for (int run = 0; run < 2; run++)
+	{
+		BatchLoader loader(std::vector<std::string>(1, input), -1, CloudSmoothingParams(), 1);
+		LoadedCloud loaded;
+		BOOST_REQUIRE(loader.next(loaded));
+		BOOST_CHECK(loaded.loadOk);
+		BOOST_CHECK_EQUAL(loaded.cloud->size(), (size_t) 30);
+		BOOST_CHECK(boost::filesystem::exists(entry));
+		BOOST_CHECK_EQUAL(CacheManager::getHits(), hits + run);
+	}
+
+	// The single cloud loader shares the same entry
+	pcl::PointCloud<pcl::PointNormal>::Ptr cloud(new pcl::PointCloud<pcl::PointNormal>());
+	BOOST_CHECK(Loader::loadCloud(input, -1, CloudSmoothingParams(), cloud));
+	BOOST_CHECK_EQUAL(cloud->size(), (size_t) 30);
+	BOOST_CHECK_EQUAL(CacheManager::getHits(), hits + 2);
+	BOOST_CHECK(!boost::filesystem::exists(CacheLock::getLockFilename(entry)));
+
+	setCloudCache("");
+	boost::filesystem::remove_all(cacheLocation);
+	remove(input.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/**************************************************/
+
+/**************************************************/
+BOOST_AUTO_TEST_SUITE(BinaryMatrix_class_suite)
+
+BOOST_AUTO_TEST_CASE(roundTrip)
+{
+	std::string filename = "./binary_matrix_test.npy";
+
+	cv::Mat matrix(17, 5, CV_32FC1);
+	cv::randu(matrix, -1000, 1000);
+	matrix.at<float>(3, 2) = std::numeric_limits<float>::denorm_min();
+	matrix.at<float>(4, 4) = -0.0f;
+
+	std::vector<std::string> metadata;
+	metadata.push_back("descriptor DCH");
+	metadata.push_back("bandNumber:4 bandWidth:0.01");
+
+	BOOST_CHECK(BinaryMatrix::write(filename, matrix, metadata));
+	BOOST_CHECK(BinaryMatrix::isBinary(filename));
+
+	cv::Mat read;
+	std::vector<std::string> readMetadata;
+	BOOST_REQUIRE(BinaryMatrix::read(filename, read, &readMetadata));
+	checkEqual(matrix, read);
+	BOOST_CHECK(readMetadata == metadata);
+
+	// The data must start at an aligned offset
+	uintmax_t size = boost::filesystem::file_size(filename);
+	BOOST_CHECK_EQUAL((size - matrix.total() * sizeof(float)) % 64, 0U);
+
+	// Empty matrices are valid too
+	BOOST_CHECK(BinaryMatrix::write(filename, cv::Mat(0, 5, CV_32FC1), std::vector<std::string>()));
+	BOOST_REQUIRE(BinaryMatrix::read(filename, read));
+	BOOST_CHECK(read.empty());
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(stridedMatrix)
+{
+	std::string filename = "./binary_matrix_strided_test.npy";
+
+	pcl::PointCloud<pcl::PointNormal>::Ptr cloud(new pcl::PointCloud<pcl::PointNormal>());
+	for (int i = 0; i < 40; i++)
+	{
+		pcl::PointNormal p;
+		p.x = i * 0.1;
+		p.y = -i * 0.2;
+		p.z = i * i * 0.01;
+		p.normal_x = p.normal_y = p.normal_z = p.curvature = 7;
+		cloud->push_back(p);
+	}
+
+	// A view over the cloud skips the padding and the normals between points
+	cv::Mat view = CloudUtils::pointsView(cloud);
+	BOOST_REQUIRE(!view.isContinuous());
+
+	BOOST_CHECK(BinaryMatrix::write(filename, view, std::vector<std::string>()));
+
+	cv::Mat read;
+	BOOST_REQUIRE(BinaryMatrix::read(filename, read));
+	checkEqual(view, read);
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(longHeader)
+{
+	std::string filename = "./binary_matrix_v2_test.npy";
+
+	// Metadata too long for a 16 bits header length forces a version 2.0 header
+	std::vector<std::string> metadata;
+	for (int i = 0; i < 1000; i++)
+		metadata.push_back("line " + boost::lexical_cast<std::string>(i) + " " + std::string(80, 'x'));
+
+	cv::Mat matrix(3, 4, CV_32FC1);
+	cv::randu(matrix, -1, 1);
+	BOOST_CHECK(BinaryMatrix::write(filename, matrix, metadata));
+
+	std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+	char preamble[8];
+	file.read(preamble, 8);
+	file.close();
+	BOOST_CHECK_EQUAL((int) preamble[6], 2);
+
+	cv::Mat read;
+	std::vector<std::string> readMetadata;
+	BOOST_REQUIRE(BinaryMatrix::read(filename, read, &readMetadata));
+	checkEqual(matrix, read);
+	BOOST_CHECK(readMetadata == metadata);
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(rejectedFiles)
+{
+	std::string filename = "./binary_matrix_rejected_test.npy";
+	cv::Mat matrix(10, 10, CV_32FC1);
+	cv::randu(matrix, -1, 1);
+	cv::Mat read;
+
+	// Only float matrices are written
+	BOOST_CHECK(!BinaryMatrix::write(filename, cv::Mat::zeros(2, 2, CV_64FC1), std::vector<std::string>()));
+
+	// Data cut short
+	BOOST_CHECK(BinaryMatrix::write(filename, matrix, std::vector<std::string>()));
+	uintmax_t size = boost::filesystem::file_size(filename);
+	boost::filesystem::resize_file(filename, size - 1);
+	BOOST_CHECK(!BinaryMatrix::read(filename, read));
+
+	// Header cut short
+	boost::filesystem::resize_file(filename, 20);
+	BOOST_CHECK(!BinaryMatrix::read(filename, read));
+
+	// Any type other than little endian float
+	BOOST_CHECK(BinaryMatrix::write(filename, matrix, std::vector<std::string>()));
+	std::fstream file(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+	std::string header(128, '\0');
+	file.read(&header[0], header.size());
+	size_t descr = header.find("<f4");
+	BOOST_REQUIRE(descr != std::string::npos);
+	file.seekp(descr);
+	file.write("<f8", 3);
+	file.close();
+	BOOST_CHECK(BinaryMatrix::isBinary(filename));
+	BOOST_CHECK(!BinaryMatrix::read(filename, read));
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/**************************************************/
+
+/**************************************************/
+BOOST_AUTO_TEST_SUITE(TextMatrix_class_suite)
+
+BOOST_AUTO_TEST_CASE(parseFloat)
+{
+	// Values printed the way the writers do, over the whole float range (denormals included)
+	char buffer[64];
+	for (uint64_t bits = 1; bits < 0xFFFFFFFFULL; bits += 0x10003)
+	{
+		uint32_t pattern = bits;
+		float value;
+		memcpy(&value, &pattern, sizeof(float));
+		if (!pcl_isfinite(value))
+			continue;
+
+		snprintf(buffer, sizeof(buffer), "%.9g", value);
+		BOOST_CHECK_MESSAGE(parsesAsStrtof(buffer), buffer);
+		snprintf(buffer, sizeof(buffer), "%.6g", value);
+		BOOST_CHECK_MESSAGE(parsesAsStrtof(buffer), buffer);
+		snprintf(buffer, sizeof(buffer), "%.6f", value);
+		BOOST_CHECK_MESSAGE(parsesAsStrtof(buffer), buffer);
+	}
+
+	// Leading and trailing zeros, signs and bare points
+	BOOST_CHECK(parsesAsStrtof("0"));
+	BOOST_CHECK(parsesAsStrtof("-0"));
+	BOOST_CHECK(parsesAsStrtof("+1.5"));
+	BOOST_CHECK(parsesAsStrtof("000000000000000000000000123.25"));
+	BOOST_CHECK(parsesAsStrtof("0.00000000000000000000000000000000000001"));
+	BOOST_CHECK(parsesAsStrtof("1.50000000000000000000000000000000000000"));
+	BOOST_CHECK(parsesAsStrtof(".5"));
+	BOOST_CHECK(parsesAsStrtof("5."));
+	BOOST_CHECK(parsesAsStrtof("1E3"));
+
+	// More than 19 significant digits
+	BOOST_CHECK(parsesAsStrtof("12345678901234567890123"));
+	BOOST_CHECK(parsesAsStrtof("0.33333333333333333333333333"));
+	BOOST_CHECK(parsesAsStrtof("16777217.0000000000000000000001"));
+	BOOST_CHECK(parsesAsStrtof("1.00000005960464477539062500001"));
+
+	// Exponents beyond the exactly representable powers of ten
+	BOOST_CHECK(parsesAsStrtof("1e23"));
+	BOOST_CHECK(parsesAsStrtof("3.4028234e38"));
+	BOOST_CHECK(parsesAsStrtof("1e-23"));
+	BOOST_CHECK(parsesAsStrtof("1.17549435e-38"));
+	BOOST_CHECK(parsesAsStrtof("1.4e-45"));
+	BOOST_CHECK(parsesAsStrtof("1e-50"));
+	BOOST_CHECK(parsesAsStrtof("0.0001e-40"));
+	BOOST_CHECK(parsesAsStrtof("123456e-30"));
+
+	// Special values
+	float value;
+	BOOST_CHECK(TextMatrix::parseFloat("nan", "nan" + 3, value) && pcl_isnan(value));
+	BOOST_CHECK(TextMatrix::parseFloat("-NaN", "-NaN" + 4, value) && pcl_isnan(value));
+	BOOST_CHECK(parsesAsStrtof("inf"));
+	BOOST_CHECK(parsesAsStrtof("-Infinity"));
+
+	// Out of the float range
+	BOOST_CHECK(rejected("3.5e38"));
+	BOOST_CHECK(rejected("-1e39"));
+	BOOST_CHECK(rejected("1e400"));
+	BOOST_CHECK(rejected("123456789012345678901234567890123456789012"));
+
+	// Garbage tokens
+	BOOST_CHECK(rejected(""));
+	BOOST_CHECK(rejected("-"));
+	BOOST_CHECK(rejected("."));
+	BOOST_CHECK(rejected("-.e5"));
+	BOOST_CHECK(rejected("1e"));
+	BOOST_CHECK(rejected("1e+"));
+	BOOST_CHECK(rejected("1.2.3"));
+	BOOST_CHECK(rejected("1,5"));
+	BOOST_CHECK(rejected("12abc"));
+	BOOST_CHECK(rejected("abc"));
+	BOOST_CHECK(rejected("0x10"));
+	BOOST_CHECK(rejected("infinit"));
+	BOOST_CHECK(rejected("--1"));
+}
+
+BOOST_AUTO_TEST_CASE(roundTrip)
+{
+	std::string filename = "./text_matrix_test.dat";
+
+	// Arbitrary float bit patterns (denormals and extreme exponents included), over several write blocks
+	cv::Mat matrix(20000, 7, CV_32FC1);
+	uint32_t state = 12345;
+	for (int i = 0; i < matrix.rows; i++)
+		for (int j = 0; j < matrix.cols; j++)
+		{
+			float value;
+			do
+			{
+				state = state * 1664525 + 1013904223;
+				memcpy(&value, &state, sizeof(float));
+			}
+			while (!pcl_isfinite(value));
+			matrix.at<float>(i, j) = value;
+		}
+	matrix.at<float>(0, 0) = -0.0f;
+	matrix.at<float>(0, 1) = std::numeric_limits<float>::max();
+	matrix.at<float>(0, 2) = std::numeric_limits<float>::denorm_min();
+	matrix.at<float>(0, 3) = 0.1f;
+
+	std::vector<std::string> metadata;
+	metadata.push_back("descriptor DCH");
+
+	BOOST_CHECK(TextMatrix::write(filename, matrix, metadata));
+
+	cv::Mat read;
+	std::vector<std::string> readMetadata;
+	BOOST_REQUIRE(TextMatrix::read(filename, read, &readMetadata));
+	checkEqual(matrix, read);
+	BOOST_CHECK(readMetadata == metadata);
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/**************************************************/
+
+/**************************************************/
+BOOST_AUTO_TEST_SUITE(CompressedMatrix_class_suite)
+
+BOOST_AUTO_TEST_CASE(roundTrip)
+{
+	std::string filename = "./compressed_matrix_test.zmat";
+
+	// Sparse rows, like the descriptors, with a partial last block
+	cv::Mat matrix = cv::Mat::zeros(1050, 13, CV_32FC1);
+	cv::Mat values(1050, 13, CV_32FC1);
+	cv::randu(values, -50, 50);
+	values.copyTo(matrix, values > 20);
+	matrix.at<float>(7, 3) = std::numeric_limits<float>::denorm_min();
+
+	std::vector<std::string> metadata;
+	metadata.push_back("descriptor SHOT");
+	metadata.push_back("searchRadius:0.05");
+
+	for (int rowsPerBlock = -1; rowsPerBlock <= 100; rowsPerBlock += 101)
+	{
+		BOOST_CHECK(CompressedMatrix::write(filename, matrix, metadata, rowsPerBlock));
+		BOOST_CHECK(CompressedMatrix::isCompressed(filename));
+
+		cv::Mat read;
+		std::vector<std::string> readMetadata;
+		BOOST_REQUIRE(CompressedMatrix::read(filename, read, &readMetadata));
+		checkEqual(matrix, read);
+		BOOST_CHECK(readMetadata == metadata);
+	}
+
+	// Strided views are written row by row too
+	pcl::PointCloud<pcl::PointNormal>::Ptr cloud(new pcl::PointCloud<pcl::PointNormal>());
+	pcl::copyPointCloud(*generateCloud(300), *cloud);
+	cv::Mat view = CloudUtils::pointsView(cloud);
+	BOOST_CHECK(CompressedMatrix::write(filename, view, std::vector<std::string>(), 64));
+
+	cv::Mat read;
+	BOOST_REQUIRE(CompressedMatrix::read(filename, read));
+	checkEqual(view, read);
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(readRows)
+{
+	std::string filename = "./compressed_matrix_rows_test.zmat";
+
+	cv::Mat matrix(1050, 6, CV_32FC1);
+	cv::randu(matrix, -1, 1);
+	BOOST_REQUIRE(CompressedMatrix::write(filename, matrix, std::vector<std::string>(), 100));
+
+	// Ranges inside a block, across block boundaries, aligned to blocks, in the partial last block and empty
+	int ranges[][2] = {{0, 1050}, {0, 10}, {95, 10}, {99, 2}, {100, 100}, {150, 700}, {990, 60}, {1000, 50}, {1049, 1}, {1050, 0}, {300, 0}};
+	for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++)
+	{
+		cv::Mat rows;
+		BOOST_REQUIRE(CompressedMatrix::readRows(filename, ranges[i][0], ranges[i][1], rows));
+		checkEqual(matrix.rowRange(ranges[i][0], ranges[i][0] + ranges[i][1]), rows);
+	}
+
+	// A negative number of rows reads up to the end
+	cv::Mat rows;
+	BOOST_REQUIRE(CompressedMatrix::readRows(filename, 1020, -1, rows));
+	checkEqual(matrix.rowRange(1020, 1050), rows);
+
+	// Ranges out of the matrix
+	BOOST_CHECK(!CompressedMatrix::readRows(filename, 1000, 51, rows));
+	BOOST_CHECK(!CompressedMatrix::readRows(filename, -1, 5, rows));
+	BOOST_CHECK(!CompressedMatrix::readRows(filename, 1051, 0, rows));
+
+	// A block cut short is detected
+	boost::filesystem::resize_file(filename, boost::filesystem::file_size(filename) - 10);
+	BOOST_CHECK(CompressedMatrix::readRows(filename, 0, 100, rows));
+	BOOST_CHECK(!CompressedMatrix::readRows(filename, 1000, 50, rows));
+	BOOST_CHECK(!CompressedMatrix::read(filename, rows));
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(zeroSize)
+{
+	std::string filename = "./compressed_matrix_empty_test.zmat";
+
+	// Without rows, without columns, or without both
+	int sizes[][2] = {{0, 5}, {5, 0}, {2000, 0}, {0, 0}};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		cv::Mat matrix(sizes[i][0], sizes[i][1], CV_32FC1);
+		BOOST_REQUIRE(CompressedMatrix::write(filename, matrix, std::vector<std::string>(1, "empty")));
+
+		cv::Mat read;
+		std::vector<std::string> metadata;
+		BOOST_REQUIRE(CompressedMatrix::read(filename, read, &metadata));
+		BOOST_CHECK(read.empty());
+		BOOST_CHECK_EQUAL(metadata.size(), 1U);
+
+		if (sizes[i][0] > 0)
+		{
+			BOOST_CHECK(CompressedMatrix::readRows(filename, 1, sizes[i][0] - 1, read));
+			BOOST_CHECK(read.empty());
+		}
+	}
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/**************************************************/
+
+/**************************************************/
+BOOST_AUTO_TEST_SUITE(CacheLock_class_suite)
+
+BOOST_AUTO_TEST_CASE(concurrentMiss)
+{
+	std::string cacheLocation = "./cache_lock_test/";
+	std::string input = "./cache_lock_test.pcd";
+	boost::filesystem::remove_all(cacheLocation);
+	boost::filesystem::create_directories(cacheLocation);
+	pcl::io::savePCDFileBinary(input, *generateCloud(20));
+
+	DescriptorParamsPtr params = DescriptorParams::create(Params::DESCRIPTOR_DCH);
+	int computedFirst = 0, computedSecond = 0;
+	cv::Mat first, second;
+
+	// The first thread takes the lock, the second one misses the entry while it's being computed
+	boost::thread owner(boost::bind(computeOnce, cacheLocation, input, params, 1.0f, boost::ref(computedFirst), boost::ref(first)));
+	boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+	boost::thread waiter(boost::bind(computeOnce, cacheLocation, input, params, 2.0f, boost::ref(computedSecond), boost::ref(second)));
+	owner.join();
+	waiter.join();
+
+	// Computed once, and the waiting thread loaded what the owner published
+	BOOST_CHECK_EQUAL(computedFirst, 1);
+	BOOST_CHECK_EQUAL(computedSecond, 0);
+	checkEqual(first, second);
+
+	// Nothing but the published entry is left behind (no lock nor temporary files)
+	std::string entry = cacheLocation + Utils::getCalculationConfigHash(input, 0.01, params, CloudSmoothingParams());
+	BOOST_CHECK(boost::filesystem::exists(entry));
+	BOOST_CHECK(!boost::filesystem::exists(CacheLock::getLockFilename(entry)));
+	for (boost::filesystem::directory_iterator it(cacheLocation), end; it != end; it++)
+	{
+		std::string name = it->path().filename().string();
+		BOOST_CHECK_MESSAGE(name.find(".tmp") == std::string::npos && name.find(".lock") == std::string::npos, name);
+	}
+
+	boost::filesystem::remove_all(cacheLocation);
+	remove(input.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/**************************************************/
+
+/**************************************************/
+BOOST_AUTO_TEST_SUITE(CacheManager_class_suite)
+
+BOOST_AUTO_TEST_CASE(eviction)
+{
+	std::string cacheLocation = "./cache_manager_eviction_test/";
+	boost::filesystem::remove_all(cacheLocation);
+	boost::filesystem::create_directories(cacheLocation);
+	setCacheSizeLimit(1);
+
+	const size_t megabyte = 1024 * 1024;
+	const size_t entrySize = 400 * 1024;
+
+	// Files not shaped like an entry are neither counted nor evicted
+	std::vector<std::string> foreign;
+	foreign.push_back(cacheLocation + "0001.pcd");
+	foreign.push_back(cacheLocation + "cafe.txt");
+	foreign.push_back(cacheLocation + "deadbeef.png");
+	for (size_t i = 0; i < foreign.size(); i++)
+		writeFile(foreign[i], entrySize);
+	BOOST_CHECK_EQUAL(CacheManager::getCacheSize(cacheLocation), (uint64_t) 0);
+
+	std::string descriptors = cacheLocation + "v2-1a2b3c4d5e6f7a8b";
+	std::string legacyCloud = cacheLocation + "1a2b3c4d5e6f7a8" + CLOUD_FILE_EXTENSION;
+	std::string cloud = cacheLocation + "v2-9f8e7d6c5b4a3" + CLOUD_FILE_EXTENSION;
+	std::string filler = cacheLocation + "v2-c0ffee";
+	std::string large = cacheLocation + "v2-fedcba9876543210";
+
+	writeFile(descriptors, entrySize);
+	CacheManager::registerWrite(cacheLocation, descriptors);
+	writeFile(legacyCloud, entrySize);
+	CacheManager::registerWrite(cacheLocation, legacyCloud);
+	BOOST_CHECK_EQUAL(CacheManager::getCacheSize(cacheLocation), 2 * entrySize);
+
+	// Reading the oldest entry makes it the most recently used one
+	CacheManager::registerHit(cacheLocation, descriptors);
+
+	// Exactly at the limit (given in MB) nothing is evicted
+	writeFile(filler, megabyte - 2 * entrySize);
+	CacheManager::registerWrite(cacheLocation, filler);
+	BOOST_CHECK_EQUAL(CacheManager::getCacheSize(cacheLocation), megabyte);
+	BOOST_CHECK(boost::filesystem::exists(descriptors));
+	BOOST_CHECK(boost::filesystem::exists(legacyCloud));
+
+	// Over the limit only the least recently used entry goes
+	writeFile(cloud, entrySize);
+	CacheManager::registerWrite(cacheLocation, cloud);
+	BOOST_CHECK(!boost::filesystem::exists(legacyCloud));
+	BOOST_CHECK(boost::filesystem::exists(descriptors));
+	BOOST_CHECK(boost::filesystem::exists(filler));
+	BOOST_CHECK(boost::filesystem::exists(cloud));
+	BOOST_CHECK_EQUAL(CacheManager::getCacheSize(cacheLocation), megabyte);
+
+	// The entry just written is kept, even if it alone exceeds the limit
+	writeFile(large, 3 * entrySize);
+	CacheManager::registerWrite(cacheLocation, large);
+	BOOST_CHECK(boost::filesystem::exists(large));
+	BOOST_CHECK(!boost::filesystem::exists(descriptors));
+	BOOST_CHECK(!boost::filesystem::exists(filler));
+	BOOST_CHECK(!boost::filesystem::exists(cloud));
+	BOOST_CHECK_EQUAL(CacheManager::getCacheSize(cacheLocation), 3 * entrySize);
+
+	for (size_t i = 0; i < foreign.size(); i++)
+		BOOST_CHECK_MESSAGE(boost::filesystem::exists(foreign[i]), foreign[i]);
+
+	setCacheSizeLimit(0);
+	boost::filesystem::remove_all(cacheLocation);
+}
+
+BOOST_AUTO_TEST_CASE(stats)
+{
+	std::string cacheLocation = "./cache_manager_stats_test/";
+	boost::filesystem::remove_all(cacheLocation);
+	boost::filesystem::create_directories(cacheLocation);
+
+	uint64_t hits = CacheManager::getHits();
+	uint64_t misses = CacheManager::getMisses();
+	uint64_t bytesSaved = CacheManager::getBytesSaved();
+
+	std::string entry = cacheLocation + "v2-5eed";
+	CacheManager::registerMiss(cacheLocation, entry);
+	writeFile(entry, 1000);
+	CacheManager::registerWrite(cacheLocation, entry);
+
+	// Writes aren't accesses, only reads count as saved bytes
+	BOOST_CHECK_EQUAL(CacheManager::getHits(), hits);
+	BOOST_CHECK_EQUAL(CacheManager::getMisses(), misses + 1);
+	BOOST_CHECK_EQUAL(CacheManager::getBytesSaved(), bytesSaved);
+
+	CacheManager::registerHit(cacheLocation, entry);
+	CacheManager::registerHit(cacheLocation, entry);
+	BOOST_CHECK_EQUAL(CacheManager::getHits(), hits + 2);
+	BOOST_CHECK_EQUAL(CacheManager::getMisses(), misses + 1);
+	BOOST_CHECK_EQUAL(CacheManager::getBytesSaved(), bytesSaved + 2000);
+	BOOST_CHECK_EQUAL(CacheManager::getCacheSize(cacheLocation), (uint64_t) 1000);
+
+	boost::filesystem::remove_all(cacheLocation);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/**************************************************/
+
+/**************************************************/
+BOOST_AUTO_TEST_SUITE(AsyncWriter_class_suite)
+
+BOOST_AUTO_TEST_CASE(flush)
+{
+	setOutputQueueSize(2);
+
+	std::vector<std::string> filenames;
+	for (int i = 0; i < 6; i++)
+		filenames.push_back("./async_writer_test_" + boost::lexical_cast<std::string>(i) + ".pcd");
+	writeClusteredClouds(filenames);
+
+	// Once flushed, every queued write is on disk
+	std::vector<std::string> errors;
+	BOOST_CHECK(AsyncWriter::flush(&errors));
+	BOOST_CHECK(errors.empty());
+	checkClusteredClouds(filenames);
+
+	// Nothing pending, nothing to wait for
+	BOOST_CHECK(AsyncWriter::flush());
+}
+
+BOOST_AUTO_TEST_CASE(errorReporting)
+{
+	setOutputQueueSize(2);
+
+	std::vector<std::string> filenames;
+	filenames.push_back("./async_writer_error_test_0.pcd");
+	filenames.push_back("./async_writer_missing_dir/async_writer_error_test.pcd");
+	filenames.push_back("./async_writer_error_test_2.pcd");
+	writeClusteredClouds(filenames);
+
+	// Only the failed write is reported, and the others are done anyway
+	std::vector<std::string> errors;
+	BOOST_CHECK(!AsyncWriter::flush(&errors));
+	BOOST_REQUIRE_EQUAL(errors.size(), 1U);
+	BOOST_CHECK(errors[0].find(filenames[1]) != std::string::npos);
+	BOOST_CHECK(!boost::filesystem::exists(filenames[1]));
+	for (size_t i = 0; i < filenames.size(); i += 2)
+	{
+		pcl::PointCloud<pcl::PointXYZRGBNormal> cloud;
+		BOOST_CHECK(pcl::io::loadPCDFile(filenames[i], cloud) == 0);
+		BOOST_CHECK_EQUAL(cloud.size(), 40 + i);
+		remove(filenames[i].c_str());
+	}
+
+	// Errors are reported once
+	errors.clear();
+	BOOST_CHECK(AsyncWriter::flush(&errors));
+	BOOST_CHECK(errors.empty());
+
+	// Skipping the output data of a non DCH descriptor isn't an error
+	pcl::PointCloud<pcl::PointNormal>::Ptr cloud(new pcl::PointCloud<pcl::PointNormal>());
+	pcl::copyPointCloud(*generateCloud(40), *cloud);
+	std::vector<BandPtr> bands;
+	AsyncWriter::writeOuputData(cloud, bands, DescriptorParams::create(Params::DESCRIPTOR_SHOT), 0);
+	BOOST_CHECK(AsyncWriter::flush());
+}
+
+BOOST_AUTO_TEST_CASE(shutdown)
+{
+	setOutputQueueSize(2);
+
+	std::vector<std::string> filenames;
+	for (int i = 0; i < 6; i++)
+		filenames.push_back("./async_writer_shutdown_test_" + boost::lexical_cast<std::string>(i) + ".pcd");
+	writeClusteredClouds(filenames);
+
+	// The queue is drained before the service stops
+	AsyncWriter::shutdown();
+	checkClusteredClouds(filenames);
+
+	// Later writes run synchronously, so they're done as soon as the call returns
+	filenames.resize(1);
+	writeClusteredClouds(filenames);
+	BOOST_CHECK(boost::filesystem::exists(filenames[0]));
+	BOOST_CHECK(AsyncWriter::flush());
+	checkClusteredClouds(filenames);
+
+	setOutputQueueSize(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/**************************************************/
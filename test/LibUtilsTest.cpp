@@ -4,8 +4,21 @@
  */
 #include <boost/test/unit_test.hpp>
 #include <typeinfo>
+#include <limits>
+#include <fstream>
+#include <cstdio>
+#include <ctime>
+#include <boost/filesystem.hpp>
+#include <pcl/search/kdtree.h>
 #include "Utils.hpp"
 #include "ExecutionParams.hpp"
+#include "SpatialHashGrid.hpp"
+#include "NeighborGraph.hpp"
+#include "CloudUtils.hpp"
+#include "Config.hpp"
+#include "ChecksumIndex.hpp"
+#include "AppendLog.hpp"
+#include "TreeHash.hpp"
 
 /**************************************************/
 BOOST_AUTO_TEST_SUITE(Utils_class_suite)
@@ -22,6 +35,246 @@ BOOST_AUTO_TEST_CASE(num2Hex)
 	BOOST_CHECK_EQUAL(hex3, "ffffffff4fbad4c3");
 }
 
+BOOST_AUTO_TEST_CASE(getPreprocessingHash)
+{
+	std::string filename = "./preprocessing_hash_test.pcd";
+	std::ofstream file(filename.c_str());
+	file << "dummy cloud";
+	file.close();
+
+	CloudSmoothingParams params;
+	std::string hash = Utils::getPreprocessingHash(filename, 0.01, params);
+	BOOST_CHECK_EQUAL(hash, Utils::getPreprocessingHash(filename, 0.01, params));
+
+	// Any preprocessing change must change the hash
+	BOOST_CHECK(hash != Utils::getPreprocessingHash(filename, 0.02, params));
+	params.useSmoothing = true;
+	BOOST_CHECK(hash != Utils::getPreprocessingHash(filename, 0.01, params));
+
+	// While it must never match a descriptors cache entry
+	DescriptorParamsPtr descriptorParams = DescriptorParams::create(Params::DESCRIPTOR_DCH);
+	BOOST_CHECK(Utils::getPreprocessingHash(filename, 0.01, params) != Utils::getCalculationConfigHash(filename, 0.01, descriptorParams, params));
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(organizedPathHash)
+{
+	std::string organizedFile = "./organized_hash_test.pcd";
+	std::string unorganizedFile = "./unorganized_hash_test.pcd";
+	std::string configFile = "./organized_hash_test.yaml";
+
+	for (int k = 0; k < 2; k++)
+	{
+		std::ofstream file((k == 0 ? organizedFile : unorganizedFile).c_str());
+		file << "VERSION 0.7\nFIELDS x y z\nSIZE 4 4 4\nTYPE F F F\nCOUNT 1 1 1\n"
+			 << (k == 0 ? "WIDTH 2\nHEIGHT 2\n" : "WIDTH 4\nHEIGHT 1\n")
+			 << "VIEWPOINT 0 0 0 1 0 0 0\nPOINTS 4\nDATA ascii\n0 0 1\n1 0 1\n0 1 1\n1 1 1\n";
+		file.close();
+	}
+
+	CloudSmoothingParams params;
+	DescriptorParamsPtr descriptorParams = DescriptorParams::create(Params::DESCRIPTOR_DCH);
+	std::string organizedKey = Utils::getPreprocessingHash(organizedFile, 0.01, params);
+	std::string unorganizedKey = Utils::getPreprocessingHash(unorganizedFile, 0.01, params);
+	std::string unorganizedDescriptorsKey = Utils::getCalculationConfigHash(unorganizedFile, 0.01, descriptorParams, params);
+
+	std::ofstream config(configFile.c_str());
+	config << "organizedPath: true\n";
+	config.close();
+	BOOST_CHECK(Config::load(configFile));
+
+	// Only the inputs actually taking the organized path get a different key
+	BOOST_CHECK(organizedKey != Utils::getPreprocessingHash(organizedFile, 0.01, params));
+	BOOST_CHECK_EQUAL(unorganizedKey, Utils::getPreprocessingHash(unorganizedFile, 0.01, params));
+	BOOST_CHECK_EQUAL(unorganizedDescriptorsKey, Utils::getCalculationConfigHash(unorganizedFile, 0.01, descriptorParams, params));
+
+	// Back to the defaults
+	config.open(configFile.c_str());
+	config << "organizedPath: false\n";
+	config.close();
+	BOOST_CHECK(Config::load(configFile));
+
+	remove(organizedFile.c_str());
+	remove(unorganizedFile.c_str());
+	remove(configFile.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(getFileChecksum)
+{
+	std::string filename = "./file_checksum_test.pcd";
+	std::ofstream file(filename.c_str());
+	file << "dummy cloud";
+	file.close();
+
+	std::string checksum = Utils::getFileChecksum(filename);
+	BOOST_CHECK_EQUAL(checksum, Utils::computeFileChecksum(filename, Config::getChecksumType()));
+	BOOST_CHECK_EQUAL(checksum, Utils::getFileChecksum(filename));
+
+	// A modified file must never get a stale digest, even with the same size
+	file.open(filename.c_str());
+	file << "dummy cloue";
+	file.close();
+	BOOST_CHECK(checksum != Utils::getFileChecksum(filename));
+	BOOST_CHECK_EQUAL(Utils::getFileChecksum(filename), Utils::computeFileChecksum(filename, Config::getChecksumType()));
+
+	// Both hashes are indexed independently
+	BOOST_CHECK(Utils::computeFileChecksum(filename, Params::CHECKSUM_MD5) != Utils::computeFileChecksum(filename, Params::CHECKSUM_TREE));
+	BOOST_CHECK_EQUAL(ChecksumIndex::getChecksum(filename, Params::CHECKSUM_MD5), Utils::computeFileChecksum(filename, Params::CHECKSUM_MD5));
+	BOOST_CHECK_EQUAL(ChecksumIndex::getChecksum(filename, Params::CHECKSUM_TREE), Utils::computeFileChecksum(filename, Params::CHECKSUM_TREE));
+
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(checksumIndexLoad)
+{
+	std::string filename = "./checksum_index_test.pcd";
+	std::string directory = "./checksum_index_test/";
+	std::string configFile = "./checksum_index_test.yaml";
+	boost::filesystem::remove_all(directory);
+	boost::filesystem::create_directories(directory);
+
+	std::ofstream file(filename.c_str());
+	file << "dummy cloud";
+	file.close();
+
+	// Old enough to be trusted, so both digests get stored in the index
+	boost::filesystem::last_write_time(filename, time(NULL) - 10);
+
+	std::ofstream config(configFile.c_str());
+	config << "cacheLocation: " << directory << "\n";
+	config.close();
+	BOOST_CHECK(Config::load(configFile));
+	ChecksumIndex::clear();
+
+	std::string md5 = Utils::computeFileChecksum(filename, Params::CHECKSUM_MD5);
+	std::string tree = Utils::computeFileChecksum(filename, Params::CHECKSUM_TREE);
+	BOOST_CHECK_EQUAL(ChecksumIndex::getChecksum(filename, Params::CHECKSUM_MD5), md5);
+	BOOST_CHECK_EQUAL(ChecksumIndex::getChecksum(filename, Params::CHECKSUM_TREE), tree);
+
+	// Lines with digests of the wrong length for their hash (as left by torn appends) are skipped
+	std::string index = directory + "checksums.index";
+	std::vector<std::string> lines;
+	std::ifstream input(index.c_str());
+	for (std::string line; std::getline(input, line);)
+		lines.push_back(line);
+	input.close();
+	BOOST_REQUIRE_EQUAL(lines.size(), 2U);
+
+	std::ofstream output(index.c_str(), std::ios::out | std::ios::app);
+	for (size_t i = 0; i < lines.size(); i++)
+	{
+		std::string rest = lines[i].substr(lines[i].find(' '));
+		bool treeKey = rest.find(" tree:") != std::string::npos;
+		output << (treeKey ? md5 : tree) << rest << "\n";
+		output << (treeKey ? tree : md5).substr(0, 10) << rest << "\n";
+	}
+	output.close();
+
+	ChecksumIndex::clear();
+	BOOST_CHECK_EQUAL(ChecksumIndex::getChecksum(filename, Params::CHECKSUM_MD5), md5);
+	BOOST_CHECK_EQUAL(ChecksumIndex::getChecksum(filename, Params::CHECKSUM_TREE), tree);
+
+	// Back to the defaults
+	config.open(configFile.c_str());
+	config << "cacheLocation: \"\"\n";
+	config.close();
+	BOOST_CHECK(Config::load(configFile));
+	ChecksumIndex::clear();
+
+	boost::filesystem::remove_all(directory);
+	remove(filename.c_str());
+	remove(configFile.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(appendLog)
+{
+	std::string filename = "./append_log_test.index";
+	remove(filename.c_str());
+
+	BOOST_CHECK(AppendLog::append(filename, "1 first"));
+	BOOST_CHECK(AppendLog::append(filename, "2 second"));
+	std::ifstream file(filename.c_str());
+	std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+	BOOST_CHECK_EQUAL(contents, "1 first\n2 second\n");
+
+	BOOST_CHECK(!AppendLog::isOutdated(100, 0));
+	BOOST_CHECK(AppendLog::isOutdated(101, 0));
+	BOOST_CHECK(!AppendLog::isOutdated(120, 10));
+
+	// Rewritten through a temporary file that isn't left behind
+	BOOST_CHECK(AppendLog::rewrite(filename, "2 second\n"));
+	file.open(filename.c_str());
+	contents.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+	BOOST_CHECK_EQUAL(contents, "2 second\n");
+	for (boost::filesystem::directory_iterator it("."), end; it != end; it++)
+		BOOST_CHECK_MESSAGE(it->path().filename().string().find(".append_log_test.index.tmp") != 0, it->path().string());
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(treeHash)
+{
+	// Reference XXH64 values
+	BOOST_CHECK_EQUAL(TreeHash::xxh64("", 0), 0xEF46DB3751D8E999ULL);
+	BOOST_CHECK_EQUAL(TreeHash::xxh64("abc", 3), 0x44BC2CF5AD770999ULL);
+	BOOST_CHECK_EQUAL(TreeHash::xxh64("Nobody inspects the spammish repetition", 39), 0xFBCEA83C8A378BF1ULL);
+
+	std::vector<char> data(1000003);
+	for (size_t i = 0; i < data.size(); i++)
+		data[i] = (char) (i * 31);
+
+	std::string digest = TreeHash::digest(&data[0], data.size(), 4096);
+	BOOST_CHECK_EQUAL(digest.size(), 16U);
+	BOOST_CHECK_EQUAL(digest, TreeHash::digest(&data[0], data.size(), 4096));
+	BOOST_CHECK(digest != TreeHash::digest(&data[0], data.size(), 8192));
+	BOOST_CHECK(digest != TreeHash::digest(&data[0], data.size() - 1, 4096));
+
+	data[500000]++;
+	BOOST_CHECK(digest != TreeHash::digest(&data[0], data.size(), 4096));
+}
+
+BOOST_AUTO_TEST_CASE(legacyCacheKey)
+{
+	std::string filename = "./legacy_cache_key_test.pcd";
+	std::ofstream file(filename.c_str());
+	file << "dummy cloud";
+	file.close();
+
+	CloudSmoothingParams params;
+	std::string key = Utils::getPreprocessingHash(filename, 0.01, params);
+	std::string legacyKey = Utils::getPreprocessingHash(filename, 0.01, params, true);
+	BOOST_CHECK(!Utils::isLegacyCacheKey(key));
+	BOOST_CHECK(Utils::isLegacyCacheKey(legacyKey));
+	BOOST_CHECK(!Utils::isLegacyCacheKey(legacyKey + ".pcd"));
+	BOOST_CHECK(Utils::isCacheKey(key));
+	BOOST_CHECK(Utils::isCacheKey(legacyKey));
+	BOOST_CHECK(!Utils::isCacheKey("checksums"));
+	BOOST_CHECK(!Utils::isCacheKey("0001"));
+
+	// Only the key alone (descriptors) or with the cloud extension is an entry
+	BOOST_CHECK(Utils::isCacheEntry(key));
+	BOOST_CHECK(Utils::isCacheEntry(key + CLOUD_FILE_EXTENSION));
+	BOOST_CHECK(Utils::isCacheEntry(legacyKey + CLOUD_FILE_EXTENSION));
+	BOOST_CHECK(Utils::isLegacyCacheEntry(legacyKey + CLOUD_FILE_EXTENSION));
+	BOOST_CHECK(!Utils::isLegacyCacheEntry(key + CLOUD_FILE_EXTENSION));
+	BOOST_CHECK(!Utils::isCacheEntry(key + ".png"));
+	BOOST_CHECK(!Utils::isCacheEntry("0001.pcd"));
+	BOOST_CHECK(!Utils::isCacheEntry("cafe.txt"));
+	BOOST_CHECK(!Utils::isCacheEntry("deadbeef.png"));
+	BOOST_CHECK(!Utils::isCacheEntry(".pcd"));
+	BOOST_CHECK(!Utils::isCacheEntry("cache.index"));
+
+	DescriptorParamsPtr descriptorParams = DescriptorParams::create(Params::DESCRIPTOR_DCH);
+	BOOST_CHECK(!Utils::isLegacyCacheKey(Utils::getCalculationConfigHash(filename, 0.01, descriptorParams, params)));
+	BOOST_CHECK(Utils::isLegacyCacheKey(Utils::getCalculationConfigHash(filename, 0.01, descriptorParams, params, true)));
+
+	remove(filename.c_str());
+}
+
 BOOST_AUTO_TEST_CASE(getColor)
 {
 	uint32_t value = 0x00DFB848;
@@ -204,6 +457,37 @@ BOOST_AUTO_TEST_CASE(strToClusteringImp)
 	BOOST_CHECK_EQUAL(Params::toClusteringImp("stochastic"), Params::CLUSTERING_STOCHASTIC);
 }
 
+BOOST_AUTO_TEST_CASE(strToPCDEncoding)
+{
+	BOOST_CHECK_EQUAL(Params::toPCDEncoding("ascii"), Params::PCD_ASCII);
+	BOOST_CHECK_EQUAL(Params::toPCDEncoding("binary"), Params::PCD_BINARY);
+	BOOST_CHECK_EQUAL(Params::toPCDEncoding("binary_compressed"), Params::PCD_BINARY_COMPRESSED);
+
+	// Unknown encodings are never guessed
+	BOOST_CHECK_THROW(Params::toPCDEncoding("binery"), std::runtime_error);
+	BOOST_CHECK_THROW(Params::toPCDEncoding(""), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(strToMatrixFormat)
+{
+	BOOST_CHECK_EQUAL(Params::toMatrixFormat("text"), Params::MATRIX_TEXT);
+	BOOST_CHECK_EQUAL(Params::toMatrixFormat("binary"), Params::MATRIX_BINARY);
+	BOOST_CHECK_EQUAL(Params::toMatrixFormat("compressed"), Params::MATRIX_COMPRESSED);
+}
+
+BOOST_AUTO_TEST_CASE(strToChecksumType)
+{
+	BOOST_CHECK_EQUAL(Params::toChecksumType("md5"), Params::CHECKSUM_MD5);
+	BOOST_CHECK_EQUAL(Params::toChecksumType("tree"), Params::CHECKSUM_TREE);
+}
+
+BOOST_AUTO_TEST_CASE(strToSearchBackend)
+{
+	BOOST_CHECK_EQUAL(Params::toSearchBackend("kdtree"), Params::SEARCH_KDTREE);
+	BOOST_CHECK_EQUAL(Params::toSearchBackend("grid"), Params::SEARCH_GRID);
+	BOOST_CHECK_EQUAL(Params::toSearchBackend("organized"), Params::SEARCH_ORGANIZED);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 /**************************************************/
 
@@ -292,8 +576,8 @@ BOOST_AUTO_TEST_SUITE(DCH_suite)
 
 BOOST_AUTO_TEST_CASE(DCHParams_constructor)
 {
-	BOOST_CHECK_EQUAL(sizeof(DCHParams), 40);
-	BOOST_CHECK_MESSAGE(sizeof(DCHParams) == 40, "DCHParams size changed, check that new members are properly initialized in the constructor");
+	BOOST_CHECK_EQUAL(sizeof(DCHParams), 48);
+	BOOST_CHECK_MESSAGE(sizeof(DCHParams) == 48, "DCHParams size changed, check that new members are properly initialized in the constructor");
 
 	DCHParams params;
 	BOOST_CHECK_EQUAL(params.type, Params::DESCRIPTOR_DCH);
@@ -304,6 +588,8 @@ BOOST_AUTO_TEST_CASE(DCHParams_constructor)
 	BOOST_CHECK_EQUAL(params.useProjection, true);
 	BOOST_CHECK_EQUAL(params.binNumber, 1);
 	BOOST_CHECK_EQUAL(params.stat, Params::STAT_MEAN);
+	BOOST_CHECK_EQUAL(params.maxNeighbors, -1);
+	BOOST_CHECK_EQUAL(params.canonicalize, false);
 }
 
 BOOST_AUTO_TEST_CASE(DCHParams_bandsAngleRange)
@@ -613,14 +899,40 @@ BOOST_AUTO_TEST_SUITE(CloudSmoothingParams_class_suite)
 
 BOOST_AUTO_TEST_CASE(constructor)
 {
-	BOOST_CHECK_EQUAL(sizeof(CloudSmoothingParams), 24);
-	BOOST_CHECK_MESSAGE(sizeof(CloudSmoothingParams) == 24, "CloudSmoothingParams size changed, check that any new member is being properly initialized in the constructor");
+	BOOST_CHECK_EQUAL(sizeof(CloudSmoothingParams), 32);
+	BOOST_CHECK_MESSAGE(sizeof(CloudSmoothingParams) == 32, "CloudSmoothingParams size changed, check that any new member is being properly initialized in the constructor");
 
 	CloudSmoothingParams params;
 
 	BOOST_CHECK_EQUAL(params.useSmoothing, false);
+	BOOST_CHECK_EQUAL(params.useDownsampling, false);
+	BOOST_CHECK_EQUAL(params.collapseDuplicates, false);
+	BOOST_CHECK_EQUAL(params.threads, 0);
 	BOOST_CHECK_EQUAL(params.sigma, 2);
 	BOOST_CHECK_EQUAL(params.radius, 0.02);
+	BOOST_CHECK_EQUAL(params.voxelSize, 0.002);
+	BOOST_CHECK_EQUAL(params.modifiesCloud(), false);
+}
+
+BOOST_AUTO_TEST_CASE(toString)
+{
+	CloudSmoothingParams params;
+	std::string base = params.toString();
+
+	// Downsampling params only show up when enabled
+	params.voxelSize = 0.005;
+	BOOST_CHECK_EQUAL(params.toString(), base);
+
+	// The thread count doesn't change the result, so it isn't part of the string either
+	params.threads = 4;
+	BOOST_CHECK_EQUAL(params.toString(), base);
+
+	params.useDownsampling = true;
+	params.collapseDuplicates = true;
+	BOOST_CHECK(params.toString() != base);
+	BOOST_CHECK(params.toString().find("voxelSize:0.005") != std::string::npos);
+	BOOST_CHECK(params.toString().find("collapseDuplicates:true") != std::string::npos);
+	BOOST_CHECK_EQUAL(params.modifiesCloud(), true);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -642,3 +954,387 @@ BOOST_AUTO_TEST_CASE(constructor)
 
 BOOST_AUTO_TEST_SUITE_END()
 /**************************************************/
+
+/**************************************************/
+BOOST_AUTO_TEST_SUITE(SpatialHashGrid_class_suite)
+
+BOOST_AUTO_TEST_CASE(search)
+{
+	srand(1234);
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
+	for (int i = 0; i < 2000; i++)
+		cloud->push_back(pcl::PointXYZ((float) rand() / RAND_MAX - 0.5, (float) rand() / RAND_MAX - 0.5, (float) rand() / RAND_MAX - 0.5));
+
+	float radius = 0.1;
+	SpatialHashGrid<pcl::PointXYZ> grid(radius);
+	grid.setInputCloud(cloud);
+	pcl::search::KdTree<pcl::PointXYZ> kdtree;
+	kdtree.setInputCloud(cloud);
+
+	for (size_t i = 0; i < cloud->size(); i += 40)
+	{
+		std::vector<int> gridIndices, treeIndices;
+		std::vector<float> gridDistances, treeDistances;
+
+		// Radius search, both sorted by distance
+		grid.radiusSearch(cloud->points[i], radius, gridIndices, gridDistances);
+		kdtree.radiusSearch(cloud->points[i], radius, treeIndices, treeDistances);
+		BOOST_CHECK_EQUAL(gridIndices.size(), treeIndices.size());
+		for (size_t j = 0; j < std::min(gridDistances.size(), treeDistances.size()); j++)
+			BOOST_CHECK_CLOSE(gridDistances[j], treeDistances[j], 1e-3);
+
+		// Radius larger than the cells
+		grid.radiusSearch(cloud->points[i], 2.5 * radius, gridIndices, gridDistances);
+		kdtree.radiusSearch(cloud->points[i], 2.5 * radius, treeIndices, treeDistances);
+		BOOST_CHECK_EQUAL(gridIndices.size(), treeIndices.size());
+
+		// KNN search
+		grid.nearestKSearch(cloud->points[i], 15, gridIndices, gridDistances);
+		kdtree.nearestKSearch(cloud->points[i], 15, treeIndices, treeDistances);
+		BOOST_CHECK_EQUAL(gridIndices.size(), 15);
+		for (size_t j = 0; j < std::min(gridDistances.size(), treeDistances.size()); j++)
+			BOOST_CHECK_CLOSE(gridDistances[j], treeDistances[j], 1e-3);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/**************************************************/
+
+/**************************************************/
+BOOST_AUTO_TEST_SUITE(NeighborGraph_class_suite)
+
+BOOST_AUTO_TEST_CASE(truncation)
+{
+	srand(1234);
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
+	for (int i = 0; i < 2000; i++)
+		cloud->push_back(pcl::PointXYZ((float) rand() / RAND_MAX - 0.5, (float) rand() / RAND_MAX - 0.5, (float) rand() / RAND_MAX - 0.5));
+
+	pcl::search::KdTree<pcl::PointXYZ>::Ptr kdtree(new pcl::search::KdTree<pcl::PointXYZ>());
+	kdtree->setInputCloud(cloud);
+
+	float radius = 0.15;
+	NeighborGraphPtr graph = NeighborGraph::build<pcl::PointXYZ>(kdtree, radius);
+	BOOST_CHECK_EQUAL(graph->size(), cloud->size());
+	BOOST_CHECK_CLOSE(graph->getRadius(), radius, 1e-5);
+
+	NeighborGraphSearch<pcl::PointXYZ> search(graph, pcl::search::Search<pcl::PointXYZ>::Ptr(new pcl::search::KdTree<pcl::PointXYZ>()));
+	search.setInputCloud(cloud);
+
+	for (size_t i = 0; i < cloud->size(); i += 40)
+	{
+		std::vector<int> graphIndices, treeIndices;
+		std::vector<float> graphDistances, treeDistances;
+
+		// Same radius the graph was built with
+		graph->getNeighbors(i, radius, graphIndices, graphDistances);
+		kdtree->radiusSearch(cloud->points[i], radius, treeIndices, treeDistances);
+		BOOST_CHECK_EQUAL(graphIndices.size(), treeIndices.size());
+
+		// Smaller radius (truncated), answered through the search adapter
+		search.radiusSearch(cloud->points[i], 0.1, graphIndices, graphDistances);
+		kdtree->radiusSearch(cloud->points[i], 0.1, treeIndices, treeDistances);
+		BOOST_CHECK_EQUAL(graphIndices.size(), treeIndices.size());
+		for (size_t j = 0; j < std::min(graphDistances.size(), treeDistances.size()); j++)
+			BOOST_CHECK_CLOSE(graphDistances[j], treeDistances[j], 1e-3);
+
+		// Neighbor cap
+		search.radiusSearch(i, 0.1, graphIndices, graphDistances, 5);
+		BOOST_CHECK_EQUAL(graphIndices.size(), std::min((size_t) 5, treeIndices.size()));
+
+		// Larger radius (answered by the fallback search)
+		search.radiusSearch(cloud->points[i], 0.2, graphIndices, graphDistances);
+		kdtree->radiusSearch(cloud->points[i], 0.2, treeIndices, treeDistances);
+		BOOST_CHECK_EQUAL(graphIndices.size(), treeIndices.size());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(reorder)
+{
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
+	for (int i = 0; i < 10; i++)
+		cloud->push_back(pcl::PointXYZ(i, 0, 0));
+
+	pcl::search::KdTree<pcl::PointXYZ>::Ptr kdtree(new pcl::search::KdTree<pcl::PointXYZ>());
+	kdtree->setInputCloud(cloud);
+	NeighborGraphPtr graph = NeighborGraph::build<pcl::PointXYZ>(kdtree, 1.5);
+	BOOST_CHECK_EQUAL(graph->getEdgeNumber(), 28);
+
+	// Reverse the cloud, so the neighbors of the new point i are the old ones of 9 - i
+	std::vector<int> order;
+	for (int i = 9; i >= 0; i--)
+		order.push_back(i);
+	NeighborGraphPtr reordered = graph->reorder(order);
+	BOOST_CHECK_EQUAL(reordered->getEdgeNumber(), graph->getEdgeNumber());
+
+	std::vector<int> pointIndices, originalIndices;
+	std::vector<float> sqrDistances, originalDistances;
+	for (int i = 0; i < 10; i++)
+	{
+		reordered->getNeighbors(i, 1.5, pointIndices, sqrDistances);
+		graph->getNeighbors(9 - i, 1.5, originalIndices, originalDistances);
+		BOOST_CHECK_EQUAL(pointIndices.size(), originalIndices.size());
+		for (size_t j = 0; j < pointIndices.size(); j++)
+			BOOST_CHECK_EQUAL(pointIndices[j], 9 - originalIndices[j]);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(nonPositiveRadius)
+{
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
+	for (int i = 0; i < 10; i++)
+		cloud->push_back(pcl::PointXYZ(i, 0, 0));
+
+	pcl::search::KdTree<pcl::PointXYZ>::Ptr kdtree(new pcl::search::KdTree<pcl::PointXYZ>());
+	kdtree->setInputCloud(cloud);
+
+	// The kd-tree would take -1 as a radius of 1 (squared), so it must never reach the search
+	BOOST_CHECK_THROW(NeighborGraph::build<pcl::PointXYZ>(kdtree, -1), std::runtime_error);
+	BOOST_CHECK_THROW(NeighborGraph::build<pcl::PointXYZ>(kdtree, 0), std::runtime_error);
+	BOOST_CHECK_THROW(CloudUtils::buildNeighborGraph<pcl::PointXYZ>(cloud, -1, Params::SEARCH_KDTREE), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/**************************************************/
+
+/**************************************************/
+BOOST_AUTO_TEST_SUITE(CloudUtils_class_suite)
+
+BOOST_AUTO_TEST_CASE(mortonOrder)
+{
+	// Corners of a cube added in reverse Morton order
+	pcl::PointCloud<pcl::PointNormal>::Ptr cloud(new pcl::PointCloud<pcl::PointNormal>());
+	for (int i = 7; i >= 0; i--)
+	{
+		pcl::PointNormal p;
+		p.x = i & 1;
+		p.y = (i >> 1) & 1;
+		p.z = (i >> 2) & 1;
+		cloud->push_back(p);
+	}
+
+	std::vector<int> order = CloudUtils::mortonOrder(cloud);
+	BOOST_CHECK_EQUAL(order.size(), 8);
+	for (int i = 0; i < 8; i++)
+		BOOST_CHECK_EQUAL(order[i], 7 - i);
+
+	pcl::PointCloud<pcl::PointNormal>::Ptr reordered = CloudUtils::reorder<pcl::PointNormal>(cloud, order);
+	BOOST_CHECK_EQUAL(reordered->size(), 8);
+	for (int i = 0; i < 8; i++)
+	{
+		BOOST_CHECK_EQUAL(reordered->points[i].x, i & 1);
+		BOOST_CHECK_EQUAL(reordered->points[i].y, (i >> 1) & 1);
+		BOOST_CHECK_EQUAL(reordered->points[i].z, (i >> 2) & 1);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(collapseDuplicates)
+{
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
+	cloud->push_back(pcl::PointXYZ(1, 0, 0));
+	cloud->push_back(pcl::PointXYZ(0, 0, 0));
+	cloud->push_back(pcl::PointXYZ(1, 0, 0));
+	cloud->push_back(pcl::PointXYZ(0, 0, 1E-6));
+	cloud->push_back(pcl::PointXYZ(0, 0, 0));
+	cloud->push_back(pcl::PointXYZ(1, 0, 0));
+
+	// Only exact duplicates are removed, keeping the first appearance of each point in order
+	BOOST_CHECK_EQUAL(CloudUtils::collapseDuplicates(cloud), 3);
+	BOOST_CHECK_EQUAL(cloud->size(), 3);
+	BOOST_CHECK_EQUAL(cloud->points[0].x, 1);
+	BOOST_CHECK_EQUAL(cloud->points[1].x, 0);
+	BOOST_CHECK_EQUAL(cloud->points[1].z, 0);
+	BOOST_CHECK_CLOSE(cloud->points[2].z, 1E-6, 1E-3);
+}
+
+BOOST_AUTO_TEST_CASE(gaussianSmoothing_threads)
+{
+	srand(1234);
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
+	for (int i = 0; i < 3000; i++)
+		cloud->push_back(pcl::PointXYZ((float) rand() / RAND_MAX, (float) rand() / RAND_MAX, 0.01 * rand() / RAND_MAX));
+
+	// The parallel smoothing has to give exactly the same points
+	pcl::PointCloud<pcl::PointXYZ>::Ptr sequential = CloudUtils::gaussianSmoothing(cloud, 2, 0.05, 1);
+	pcl::PointCloud<pcl::PointXYZ>::Ptr parallel = CloudUtils::gaussianSmoothing(cloud, 2, 0.05, 4);
+	BOOST_CHECK_EQUAL(sequential->size(), parallel->size());
+	for (size_t i = 0; i < std::min(sequential->size(), parallel->size()); i++)
+	{
+		BOOST_CHECK_EQUAL(sequential->points[i].x, parallel->points[i].x);
+		BOOST_CHECK_EQUAL(sequential->points[i].y, parallel->points[i].y);
+		BOOST_CHECK_EQUAL(sequential->points[i].z, parallel->points[i].z);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(MLSSmoothing_threads)
+{
+	srand(1234);
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
+	for (int i = 0; i < 3000; i++)
+		cloud->push_back(pcl::PointXYZ((float) rand() / RAND_MAX, (float) rand() / RAND_MAX, 0.01 * rand() / RAND_MAX));
+
+	// The parallel smoothing has to give exactly the same points, in the same order
+	pcl::PointCloud<pcl::PointXYZ>::Ptr sequential = CloudUtils::MLSSmoothing(cloud, 0.05, 1);
+	for (int k = 0; k < 3; k++)
+	{
+		pcl::PointCloud<pcl::PointXYZ>::Ptr parallel = CloudUtils::MLSSmoothing(cloud, 0.05, 4);
+		BOOST_CHECK_EQUAL(sequential->size(), parallel->size());
+		for (size_t i = 0; i < std::min(sequential->size(), parallel->size()); i++)
+		{
+			BOOST_CHECK_EQUAL(sequential->points[i].x, parallel->points[i].x);
+			BOOST_CHECK_EQUAL(sequential->points[i].y, parallel->points[i].y);
+			BOOST_CHECK_EQUAL(sequential->points[i].z, parallel->points[i].z);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(estimateOrganizedNormals)
+{
+	// Organized plane facing the camera, with an invalid pixel in the middle
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>(40, 30));
+	for (int row = 0; row < 30; row++)
+		for (int col = 0; col < 40; col++)
+			cloud->at(col, row) = pcl::PointXYZ((col - 20) * 0.002, (row - 15) * 0.002, 1);
+	cloud->at(20, 15).x = cloud->at(20, 15).y = cloud->at(20, 15).z = std::numeric_limits<float>::quiet_NaN();
+	cloud->is_dense = false;
+
+	pcl::PointCloud<pcl::Normal>::Ptr normals = CloudUtils::estimateOrganizedNormals(cloud);
+	BOOST_CHECK_EQUAL(normals->width, cloud->width);
+	BOOST_CHECK_EQUAL(normals->height, cloud->height);
+
+	pcl::Normal n = normals->at(10, 10);
+	BOOST_CHECK(pcl_isfinite(n.normal_z));
+	BOOST_CHECK_CLOSE(fabs(n.normal_z), 1, 1E-2);
+	BOOST_CHECK(!pcl_isfinite(normals->at(20, 15).normal_z));
+
+	// Unorganized clouds aren't accepted
+	pcl::PointCloud<pcl::PointXYZ>::Ptr unorganized(new pcl::PointCloud<pcl::PointXYZ>());
+	unorganized->push_back(pcl::PointXYZ(0, 0, 1));
+	BOOST_CHECK_THROW(CloudUtils::estimateOrganizedNormals(unorganized), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(organizedSearch)
+{
+	// Tilted plane seen by a pinhole camera (f = 500), so the projection can be estimated
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>(40, 30));
+	for (int row = 0; row < 30; row++)
+		for (int col = 0; col < 40; col++)
+		{
+			float z = 1 + col * 0.005;
+			cloud->at(col, row) = pcl::PointXYZ((col - 20) * z / 500, (row - 15) * z / 500, z);
+		}
+
+	pcl::search::Search<pcl::PointXYZ>::Ptr search = CloudUtils::createSearch<pcl::PointXYZ>(Params::SEARCH_ORGANIZED, 0.02);
+	search->setInputCloud(cloud);
+
+	// The neighbor cap relies on the results being sorted by distance
+	std::vector<int> pointIndices;
+	std::vector<float> sqrDistances;
+	search->radiusSearch(cloud->at(20, 15), 0.02, pointIndices, sqrDistances);
+	BOOST_CHECK(sqrDistances.size() > 10);
+	for (size_t i = 1; i < sqrDistances.size(); i++)
+		BOOST_CHECK(sqrDistances[i - 1] <= sqrDistances[i]);
+}
+
+BOOST_AUTO_TEST_CASE(downsample)
+{
+	// Two clusters of points, each one fitting inside a single voxel
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
+	for (int i = 0; i < 10; i++)
+	{
+		cloud->push_back(pcl::PointXYZ(0.1 + i * 1E-4, 0.1, 0.1));
+		cloud->push_back(pcl::PointXYZ(0.5 + i * 1E-4, 0.5, 0.5));
+	}
+
+	pcl::PointCloud<pcl::PointXYZ>::Ptr downsampled = CloudUtils::downsample(cloud, 0.05);
+	BOOST_CHECK_EQUAL(downsampled->size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(matrixViews)
+{
+	pcl::PointCloud<pcl::PointNormal>::Ptr cloud(new pcl::PointCloud<pcl::PointNormal>());
+	for (int i = 0; i < 5; i++)
+	{
+		pcl::PointNormal point;
+		point.x = i;
+		point.y = i + 0.1;
+		point.z = i + 0.2;
+		point.normal_x = -i;
+		point.normal_y = -i - 0.1;
+		point.normal_z = -i - 0.2;
+		point.curvature = i * 0.5;
+		cloud->push_back(point);
+	}
+
+	// The views have to expose the same data as the copied matrix
+	cv::Mat copy = CloudUtils::toMatrix(cloud, true);
+	cv::Mat points = CloudUtils::pointsView(cloud);
+	cv::Mat normals = CloudUtils::normalsView(cloud);
+	cv::Mat curvature = CloudUtils::curvatureView(cloud);
+	BOOST_CHECK_EQUAL(points.rows, 5);
+	BOOST_CHECK_EQUAL(points.cols, 3);
+	BOOST_CHECK_EQUAL(normals.cols, 3);
+	BOOST_CHECK_EQUAL(curvature.cols, 1);
+	for (int i = 0; i < 5; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			BOOST_CHECK_EQUAL(points.at<float>(i, j), copy.at<float>(i, j));
+			BOOST_CHECK_EQUAL(normals.at<float>(i, j), copy.at<float>(i, j + 3));
+		}
+		BOOST_CHECK_EQUAL(curvature.at<float>(i, 0), copy.at<float>(i, 6));
+	}
+
+	// The views share the cloud's memory
+	points.at<float>(2, 1) = 42;
+	BOOST_CHECK_EQUAL(cloud->points[2].y, 42);
+	BOOST_CHECK_EQUAL(CloudUtils::pointsView(pcl::PointCloud<pcl::PointNormal>::Ptr(new pcl::PointCloud<pcl::PointNormal>())).rows, 0);
+}
+
+BOOST_AUTO_TEST_CASE(saveCloud)
+{
+	pcl::PointCloud<pcl::PointNormal> cloud;
+	for (int i = 0; i < 10; i++)
+	{
+		pcl::PointNormal point;
+		point.x = i * 0.5;
+		point.y = -i;
+		point.z = i + 0.25;
+		point.normal_x = 1;
+		point.normal_y = point.normal_z = 0;
+		point.curvature = i * 0.125;
+		cloud.push_back(point);
+	}
+
+	std::string filename = "./save_cloud_test.pcd";
+	std::string data[] = {"DATA ascii", "DATA binary", "DATA binary_compressed"};
+	Params::PCDEncoding encodings[] = {Params::PCD_ASCII, Params::PCD_BINARY, Params::PCD_BINARY_COMPRESSED};
+	for (int k = 0; k < 3; k++)
+	{
+		BOOST_CHECK(CloudUtils::saveCloud(filename, cloud, encodings[k]));
+
+		// The encoding is the last line of the header
+		std::ifstream file(filename.c_str());
+		std::string line;
+		while (std::getline(file, line) && line.compare(0, 4, "DATA") != 0);
+		BOOST_CHECK_EQUAL(line, data[k]);
+		file.close();
+
+		pcl::PointCloud<pcl::PointNormal> loaded;
+		BOOST_CHECK_EQUAL(pcl::io::loadPCDFile(filename, loaded), 0);
+		BOOST_CHECK_EQUAL(loaded.size(), cloud.size());
+		for (size_t i = 0; i < loaded.size() && i < cloud.size(); i++)
+		{
+			BOOST_CHECK_EQUAL(loaded[i].x, cloud[i].x);
+			BOOST_CHECK_EQUAL(loaded[i].y, cloud[i].y);
+			BOOST_CHECK_EQUAL(loaded[i].z, cloud[i].z);
+			BOOST_CHECK_EQUAL(loaded[i].normal_x, cloud[i].normal_x);
+			BOOST_CHECK_EQUAL(loaded[i].curvature, cloud[i].curvature);
+		}
+	}
+
+	remove(filename.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+/**************************************************/
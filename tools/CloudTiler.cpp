@@ -0,0 +1,66 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include <cstdlib>
+#include <iostream>
+#include <boost/lexical_cast.hpp>
+#include "Loader.hpp"
+
+
+/**
+ * Splits a PCD file into spatial tiles small enough to be processed independently. The file is
+ * streamed, so clouds bigger than the available memory can be tiled. Each tile keeps the points
+ * within the given margin around its box, so the neighborhoods of its core points are complete.
+ *
+ * Usage: CloudTiler <input.pcd> <tileSize> <margin> <outputDir> [chunkSize]
+ */
+static void printUsage(const char *program_)
+{
+	std::cout << "Usage: " << program_ << " <input.pcd> <tileSize> <margin> <outputDir> [chunkSize]" << std::endl;
+}
+
+int main(int argn_, char **argv_)
+{
+	if (argn_ < 5)
+	{
+		printUsage(argv_[0]);
+		return EXIT_FAILURE;
+	}
+
+	double tileSize, margin;
+	int chunkSize = -1;
+	try
+	{
+		tileSize = boost::lexical_cast<double>(argv_[2]);
+		margin = boost::lexical_cast<double>(argv_[3]);
+		if (argn_ > 5)
+			chunkSize = boost::lexical_cast<int>(argv_[5]);
+	}
+	catch (boost::bad_lexical_cast &_ex)
+	{
+		std::cout << "Wrong numeric argument" << std::endl;
+		printUsage(argv_[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (tileSize <= 0 || margin < 0)
+	{
+		std::cout << "The tile size must be positive and the margin non negative" << std::endl;
+		printUsage(argv_[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<CloudTile> tiles;
+	if (!Loader::tileCloud(argv_[1], tileSize, margin, argv_[4], tiles, chunkSize))
+	{
+		std::cout << "Unable to tile " << argv_[1] << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	for (size_t i = 0; i < tiles.size(); i++)
+		std::cout << "\t" << tiles[i].filename << ": " << tiles[i].points << " points ["
+				  << tiles[i].minCorner.transpose() << "] - [" << tiles[i].maxCorner.transpose() << "]" << std::endl;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/foreach.hpp>
+#include <pcl/PCLPointCloud2.h>
+#include <pcl/io/pcd_io.h>
+#include "PCDReader.hpp"
+
+
+/**
+ * Rewrites PCD files with the given encoding, keeping every field of the clouds. Directories
+ * are traversed recursively. Each file is written to a temporary file first and then renamed
+ * over the original, so an interrupted conversion never leaves a half written cloud.
+ *
+ * Usage: PCDConverter <ascii|binary|binary_compressed> <file or directory>...
+ */
+static bool convert(const boost::filesystem::path &filename_,
+					const Params::PCDEncoding encoding_)
+{
+	PCDHeader header;
+	if (!PCDReader::readHeader(filename_.string(), header))
+	{
+		std::cout << "\tskipping " << filename_.string() << " (unreadable header)" << std::endl;
+		return false;
+	}
+
+	if (header.encoding == encoding_)
+	{
+		std::cout << "\tskipping " << filename_.string() << " (already " << Params::pcdEncoding[encoding_] << ")" << std::endl;
+		return true;
+	}
+
+	pcl::PCLPointCloud2 cloud;
+	Eigen::Vector4f origin;
+	Eigen::Quaternionf orientation;
+	if (pcl::io::loadPCDFile(filename_.string(), cloud, origin, orientation) != 0)
+	{
+		std::cout << "\tfailed to load " << filename_.string() << std::endl;
+		return false;
+	}
+
+	std::string tmp = filename_.string() + ".tmp";
+	pcl::PCDWriter writer;
+	int result = -1;
+	switch (encoding_)
+	{
+	case Params::PCD_ASCII:
+		result = writer.writeASCII(tmp, cloud, origin, orientation);
+		break;
+	case Params::PCD_BINARY:
+		result = writer.writeBinary(tmp, cloud, origin, orientation);
+		break;
+	case Params::PCD_BINARY_COMPRESSED:
+		result = writer.writeBinaryCompressed(tmp, cloud, origin, orientation);
+		break;
+	}
+
+	if (result != 0)
+	{
+		boost::filesystem::remove(tmp);
+		std::cout << "\tfailed to write " << filename_.string() << std::endl;
+		return false;
+	}
+
+	uintmax_t before = boost::filesystem::file_size(filename_);
+	boost::filesystem::rename(tmp, filename_);
+	uintmax_t after = boost::filesystem::file_size(filename_);
+
+	std::cout << "\t" << filename_.string() << ": " << Params::pcdEncoding[header.encoding] << " -> " << Params::pcdEncoding[encoding_]
+			  << " (" << before / 1024 << " KB -> " << after / 1024 << " KB)" << std::endl;
+	return true;
+}
+
+static int traverse(const boost::filesystem::path &target_,
+					const Params::PCDEncoding encoding_)
+{
+	int failed = 0;
+	if (boost::filesystem::is_directory(target_))
+	{
+		boost::filesystem::directory_iterator it(target_), eod;
+		BOOST_FOREACH(boost::filesystem::path const & filePath, std::make_pair(it, eod))
+		{
+			failed += traverse(filePath, encoding_);
+		}
+	}
+	else if (boost::filesystem::is_regular_file(target_) && boost::iequals(target_.extension().string(), ".pcd"))
+		failed += convert(target_, encoding_) ? 0 : 1;
+
+	return failed;
+}
+
+static void printUsage(const char *program_)
+{
+	std::cout << "Usage: " << program_ << " <ascii|binary|binary_compressed> <file or directory>..." << std::endl;
+}
+
+int main(int argn_, char **argv_)
+{
+	if (argn_ < 3)
+	{
+		printUsage(argv_[0]);
+		return EXIT_FAILURE;
+	}
+
+	// Nothing is touched unless the encoding is exactly one of the known ones
+	Params::PCDEncoding encoding = Params::PCD_ASCII;
+	try
+	{
+		encoding = Params::toPCDEncoding(argv_[1]);
+	}
+	catch (std::exception &_ex)
+	{
+		std::cout << _ex.what() << std::endl;
+		printUsage(argv_[0]);
+		return EXIT_FAILURE;
+	}
+
+	int failed = 0;
+	for (int i = 2; i < argn_; i++)
+		failed += traverse(boost::filesystem::path(argv_[i]), encoding);
+
+	if (failed > 0)
+		std::cout << failed << " files couldn't be converted" << std::endl;
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,35 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <string>
+#include <stddef.h>
+
+
+/**
+ * Helpers for the append only text files backing the persistent indexes of the cache directory
+ * (one line per update, the last line of a key wins). Each line is appended with a single write,
+ * so several processes can share a file, and the file is rewritten with only the current lines
+ * once most of them are outdated.
+ */
+class AppendLog
+{
+public:
+	/**************************************************/
+	static bool append(const std::string &filename_,
+					   const std::string &line_);
+
+	/**************************************************/
+	static bool isOutdated(const size_t lines_,
+						   const size_t entries_);
+
+	/**************************************************/
+	static bool rewrite(const std::string &filename_,
+						const std::string &contents_);
+
+private:
+	AppendLog();
+	~AppendLog();
+};
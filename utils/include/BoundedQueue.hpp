@@ -0,0 +1,93 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <deque>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+
+/**
+ * Thread safe FIFO queue with a fixed capacity. Producers block while the queue is full and
+ * consumers while it's empty, so a fast stage can't get arbitrarily ahead of a slow one (nor
+ * use unbounded memory). Once closed, pushes fail and pops drain the remaining elements.
+ */
+template<typename T>
+class BoundedQueue
+{
+public:
+	/**************************************************/
+	BoundedQueue(const size_t capacity_)
+	{
+		capacity = capacity_ > 0 ? capacity_ : 1;
+		closed = false;
+	}
+
+	/**************************************************/
+	~BoundedQueue()
+	{
+	}
+
+	/**************************************************/
+	bool push(const T &item_)
+	{
+		boost::unique_lock<boost::mutex> lock(mutex);
+		while (items.size() >= capacity && !closed)
+			notFull.wait(lock);
+
+		if (closed)
+			return false;
+
+		items.push_back(item_);
+		notEmpty.notify_one();
+		return true;
+	}
+
+	/**************************************************/
+	bool pop(T &item_)
+	{
+		boost::unique_lock<boost::mutex> lock(mutex);
+		while (items.empty() && !closed)
+			notEmpty.wait(lock);
+
+		if (items.empty())
+			return false;
+
+		item_ = items.front();
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	/**************************************************/
+	void close()
+	{
+		boost::unique_lock<boost::mutex> lock(mutex);
+		closed = true;
+		notFull.notify_all();
+		notEmpty.notify_all();
+	}
+
+	/**************************************************/
+	size_t size() const
+	{
+		boost::unique_lock<boost::mutex> lock(mutex);
+		return items.size();
+	}
+
+	/**************************************************/
+	size_t getCapacity() const
+	{
+		return capacity;
+	}
+
+private:
+	size_t capacity; // Maximum number of elements held at once
+	bool closed; // Flag indicating if the queue has been closed
+	std::deque<T> items; // Queued elements
+	mutable boost::mutex mutex; // Mutex protecting the queue
+	boost::condition_variable notFull; // Signaled when an element is removed
+	boost::condition_variable notEmpty; // Signaled when an element is added (or the queue is closed)
+};
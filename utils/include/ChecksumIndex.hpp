@@ -0,0 +1,83 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <string>
+#include <map>
+#include <stdint.h>
+#include <boost/thread/mutex.hpp>
+#include "ExecutionParams.hpp"
+
+
+/**
+ * Persistent index of file checksums. Each digest is stored together with the identity and
+ * state of the file it was computed from (device, inode, size and modification time), so it's
+ * reused as long as the file doesn't change and only modified files are hashed again. The index
+ * lives in the cache directory as an append only text file (the last line of a file wins), and
+ * is kept in memory only if no cache directory is configured. Digests of different hashes of the
+ * same file are indexed independently.
+ */
+class ChecksumIndex
+{
+public:
+	~ChecksumIndex() {};
+
+	/**************************************************/
+	static ChecksumIndex *getInstance()
+	{
+		static ChecksumIndex instance;
+		return &instance;
+	}
+
+	/**************************************************/
+	static std::string getChecksum(const std::string &filename_,
+								   const Params::ChecksumType type_);
+
+	/**************************************************/
+	static void clear();
+
+private:
+	/**
+	 * Structure holding the state of a file when its digest was computed
+	 */
+	struct Entry
+	{
+		uint64_t device; // Device holding the file
+		uint64_t inode; // Inode of the file
+		int64_t size; // Size of the file in bytes
+		int64_t mtimeSec; // Modification time (seconds)
+		int64_t mtimeNsec; // Modification time (nanoseconds)
+		std::string digest; // Checksum of the file
+
+		/**************************************************/
+		bool sameFile(const Entry &other_) const
+		{
+			return device == other_.device && inode == other_.inode && size == other_.size
+				   && mtimeSec == other_.mtimeSec && mtimeNsec == other_.mtimeNsec;
+		}
+	};
+
+	ChecksumIndex()
+	{
+		loaded = false;
+	}
+
+	/**************************************************/
+	void load(const std::string &location_);
+
+	/**************************************************/
+	void append(const std::string &path_,
+				const Entry &entry_);
+
+	/**************************************************/
+	static std::string toLine(const std::string &path_,
+							  const Entry &entry_);
+
+
+	std::map<std::string, Entry> entries; // Known digests, by absolute path (prefixed with the hash name, if not MD5)
+	std::string location; // File backing the index (empty if kept in memory only)
+	bool loaded; // Flag indicating if the index has been loaded from its file
+	boost::mutex mutex; // Mutex protecting the index
+};
@@ -0,0 +1,94 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <vector>
+#include <Eigen/Core>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+
+/**
+ * Structure-of-arrays copy of a point cloud with normals, used internally by the descriptor's
+ * hot loops. Each field is stored in its own aligned array, so only the used fields are
+ * brought into cache (28 bytes per point instead of the 48 of pcl::PointNormal).
+ */
+struct CloudSoA
+{
+	typedef std::vector<float, Eigen::aligned_allocator<float> > FloatArray;
+
+	FloatArray x, y, z; // Coordinates
+	FloatArray nx, ny, nz; // Normal components
+	FloatArray curvature; // Curvature
+
+
+	/**************************************************/
+	CloudSoA()
+	{
+	}
+
+	/**************************************************/
+	CloudSoA(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_)
+	{
+		set(cloud_);
+	}
+
+	/**************************************************/
+	void set(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_)
+	{
+		size_t n = cloud_->size();
+		x.resize(n);
+		y.resize(n);
+		z.resize(n);
+		nx.resize(n);
+		ny.resize(n);
+		nz.resize(n);
+		curvature.resize(n);
+
+		for (size_t i = 0; i < n; i++)
+		{
+			const pcl::PointNormal &p = cloud_->points[i];
+			x[i] = p.x;
+			y[i] = p.y;
+			z[i] = p.z;
+			nx[i] = p.normal_x;
+			ny[i] = p.normal_y;
+			nz[i] = p.normal_z;
+			curvature[i] = p.curvature;
+		}
+	}
+
+	/**************************************************/
+	size_t size() const
+	{
+		return x.size();
+	}
+
+	/**************************************************/
+	Eigen::Vector3f point(const size_t index_) const
+	{
+		return Eigen::Vector3f(x[index_], y[index_], z[index_]);
+	}
+
+	/**************************************************/
+	Eigen::Vector3f normal(const size_t index_) const
+	{
+		return Eigen::Vector3f(nx[index_], ny[index_], nz[index_]);
+	}
+
+	/**************************************************/
+	pcl::PointNormal at(const size_t index_) const
+	{
+		pcl::PointNormal p;
+		p.x = x[index_];
+		p.y = y[index_];
+		p.z = z[index_];
+		p.normal_x = nx[index_];
+		p.normal_y = ny[index_];
+		p.normal_z = nz[index_];
+		p.curvature = curvature[index_];
+		return p;
+	}
+};
@@ -7,7 +7,13 @@
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
 #include <pcl/filters/filter.h>
+#include <pcl/search/kdtree.h>
+#include <pcl/search/organized.h>
+#include <pcl/io/pcd_io.h>
 #include <opencv2/core/core.hpp>
+#include "ExecutionParams.hpp"
+#include "SpatialHashGrid.hpp"
+#include "NeighborGraph.hpp"
 
 
 class CloudUtils
@@ -20,23 +26,139 @@ public:
 		pcl::removeNaNFromPointCloud(*cloud_, *cloud_, mapping);
 	}
 
+	/**************************************************/
+	static pcl::PointCloud<pcl::PointXYZ>::Ptr downsample(const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_,
+			const double voxelSize_);
+
+	/**************************************************/
+	static size_t collapseDuplicates(const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_);
+
+	/**************************************************/
+	static Params::SearchBackend getSearchBackend(const bool organized_);
+
+	/**************************************************/
+	template<typename PointT>
+	static typename pcl::search::Search<PointT>::Ptr createSearch(const Params::SearchBackend backend_,
+			const double radius_,
+			const NeighborGraphPtr &graph_ = NeighborGraphPtr())
+	{
+		typename pcl::search::Search<PointT>::Ptr search;
+
+		/**
+		 * The grid's cells are sized after the search radius, so it can't be used without one (KNN
+		 * searches). Every backend returns its neighbors sorted by distance, since the neighbor cap
+		 * strides over the results assuming so.
+		 */
+		if (backend_ == Params::SEARCH_GRID && radius_ > 0)
+			search = typename pcl::search::Search<PointT>::Ptr(new SpatialHashGrid<PointT>(radius_));
+		else if (backend_ == Params::SEARCH_ORGANIZED)
+			search = typename pcl::search::Search<PointT>::Ptr(new pcl::search::OrganizedNeighbor<PointT>(true));
+		else
+			search = typename pcl::search::Search<PointT>::Ptr(new pcl::search::KdTree<PointT>());
+
+		// Answer from the precomputed neighbors when they cover the requested radius
+		if (graph_ && radius_ > 0 && radius_ <= graph_->getRadius())
+			return typename pcl::search::Search<PointT>::Ptr(new NeighborGraphSearch<PointT>(graph_, search));
+
+		return search;
+	}
+
+	/**************************************************/
+	template<typename PointT>
+	static NeighborGraphPtr buildNeighborGraph(const typename pcl::PointCloud<PointT>::Ptr &cloud_,
+			const double radius_,
+			const Params::SearchBackend backend_)
+	{
+		// Rejected before building the search, which can be as expensive as the graph itself
+		if (radius_ <= 0)
+			throw std::runtime_error("Non positive radius given to build the neighbor graph");
+
+		typename pcl::search::Search<PointT>::Ptr search = createSearch<PointT>(backend_, radius_);
+		search->setInputCloud(cloud_);
+		return NeighborGraph::build<PointT>(search, radius_);
+	}
+
 	/**************************************************/
 	static pcl::PointCloud<pcl::PointXYZ>::Ptr gaussianSmoothing(const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_,
 			const double sigma_,
-			const double radius_);
+			const double radius_,
+			const int threads_ = 0,
+			const NeighborGraphPtr &graph_ = NeighborGraphPtr());
 
 	/**************************************************/
 	static pcl::PointCloud<pcl::PointXYZ>::Ptr MLSSmoothing(const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_,
-			const double radius_);
+			const double radius_,
+			const int threads_ = 0,
+			const NeighborGraphPtr &graph_ = NeighborGraphPtr());
+
+	/**************************************************/
+	static pcl::PointCloud<pcl::Normal>::Ptr estimateOrganizedNormals(const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_);
 
 	/**************************************************/
 	static pcl::PointCloud<pcl::Normal>::Ptr estimateNormals(const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_,
-			const double searchRadius_ = -1);
+			const double searchRadius_ = -1,
+			const int threads_ = -1,
+			const NeighborGraphPtr &graph_ = NeighborGraphPtr());
+
+	/**************************************************/
+	static std::vector<int> mortonOrder(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_);
+
+	/**************************************************/
+	template<typename PointT>
+	static typename pcl::PointCloud<PointT>::Ptr reorder(const typename pcl::PointCloud<PointT>::Ptr &cloud_,
+			const std::vector<int> &order_)
+	{
+		typename pcl::PointCloud<PointT>::Ptr reordered(new pcl::PointCloud<PointT>());
+		reordered->resize(order_.size());
+		for (size_t i = 0; i < order_.size(); i++)
+			reordered->points[i] = cloud_->points[order_[i]];
+
+		reordered->sensor_origin_ = cloud_->sensor_origin_;
+		reordered->sensor_orientation_ = cloud_->sensor_orientation_;
+		return reordered;
+	}
 
 	/**************************************************/
 	static cv::Mat toMatrix(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 							const bool includeNormals_ = false);
 
+	/**
+	 * The following methods return strided views over the cloud's point buffer (one row per
+	 * point, no data copied). A view doesn't own the data: it's valid only while the cloud is
+	 * alive and its points aren't added, removed or reallocated, and writing to it modifies the
+	 * cloud. Use toMatrix (or clone the view) when an independent matrix is needed.
+	 */
+	/**************************************************/
+	static cv::Mat pointsView(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_);
+
+	/**************************************************/
+	static cv::Mat normalsView(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_);
+
+	/**************************************************/
+	static cv::Mat curvatureView(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_);
+
+	/**************************************************/
+	static Params::PCDEncoding getOutputEncoding();
+
+	/**************************************************/
+	template<typename PointT>
+	static bool saveCloud(const std::string &filename_,
+						  const pcl::PointCloud<PointT> &cloud_,
+						  const Params::PCDEncoding encoding_ = getOutputEncoding())
+	{
+		pcl::PCDWriter writer;
+		switch (encoding_)
+		{
+			case Params::PCD_BINARY:
+				return writer.writeBinary<PointT>(filename_, cloud_) == 0;
+			case Params::PCD_BINARY_COMPRESSED:
+				return writer.writeBinaryCompressed<PointT>(filename_, cloud_) == 0;
+			default:
+			case Params::PCD_ASCII:
+				return writer.writeASCII<PointT>(filename_, cloud_) == 0;
+		}
+	}
+
 private:
 	CloudUtils();
 	~CloudUtils();
@@ -56,12 +56,90 @@ public:
 		return getInstance()->normalEstimationRadius;
 	}
 
+	/**************************************************/
+	static int getNormalEstimationThreads()
+	{
+		return getInstance()->normalEstimationThreads;
+	}
+
 	/**************************************************/
 	static std::string getCacheDirectory()
 	{
 		return getInstance()->cacheLocation;
 	}
 
+	/**************************************************/
+	static int getCacheSizeLimit()
+	{
+		return getInstance()->cacheSizeLimit;
+	}
+
+	/**************************************************/
+	static Params::SearchBackend getSearchBackend()
+	{
+		return getInstance()->searchBackend;
+	}
+
+	/**************************************************/
+	static bool useMortonOrder()
+	{
+		return getInstance()->mortonOrder;
+	}
+
+	/**************************************************/
+	static bool useOrganizedPath()
+	{
+		return getInstance()->organizedPath;
+	}
+
+	/**************************************************/
+	static int getBatchQueueSize()
+	{
+		return getInstance()->batchQueueSize;
+	}
+
+	/**************************************************/
+	static int getStreamChunkSize()
+	{
+		return getInstance()->streamChunkSize;
+	}
+
+	/**************************************************/
+	static int getOutputQueueSize()
+	{
+		return getInstance()->outputQueueSize;
+	}
+
+	/**************************************************/
+	static Params::MatrixFormat getMatrixFormat()
+	{
+		return getInstance()->matrixFormat;
+	}
+
+	/**************************************************/
+	static Params::PCDEncoding getOutputEncoding()
+	{
+		return getInstance()->outputEncoding;
+	}
+
+	/**************************************************/
+	static bool useChecksumIndex()
+	{
+		return getInstance()->checksumIndex;
+	}
+
+	/**************************************************/
+	static Params::ChecksumType getChecksumType()
+	{
+		return getInstance()->checksumType;
+	}
+
+	/**************************************************/
+	static bool useCloudCache()
+	{
+		return getInstance()->cloudCache;
+	}
+
 	/**************************************************/
 	static DescriptorParamsPtr getDescriptorParams()
 	{
@@ -132,5 +210,18 @@ private:
 	bool debug; // Flag indicating if the debug generation is enabled or not
 	int targetPoint; // Target point
 	double normalEstimationRadius; // Radius used to perform the normal vectors estimation
+	int normalEstimationThreads; // Threads used for the normal estimation (non positive means automatic)
 	std::string cacheLocation; // Directory where cached calculations are stored
+	int cacheSizeLimit; // Max size of the cache directory in MB (0 means unbounded)
+	Params::SearchBackend searchBackend; // Structure used for the neighborhood searches
+	bool mortonOrder; // Flag indicating if the dense computations have to process the points in Morton order
+	int batchQueueSize; // Clouds held by each stage of the batch loader
+	int streamChunkSize; // Points read at once when a cloud is streamed from disk
+	int outputQueueSize; // Writes held by the background writer (0 means writing synchronously)
+	Params::MatrixFormat matrixFormat; // Format used to write the descriptor caches, centers and codebooks
+	Params::PCDEncoding outputEncoding; // Encoding used to write the output and debug clouds
+	bool checksumIndex; // Flag indicating if the checksums of the input files have to be indexed to avoid hashing them again
+	Params::ChecksumType checksumType; // Hash used to identify the input files in the cache keys
+	bool cloudCache; // Flag indicating if the preprocessed clouds (smoothing and normals) have to be cached
+	bool organizedPath; // Flag indicating if organized clouds have to keep their grid (integral image normals and image space searches)
 };
@@ -78,8 +78,10 @@ struct DCHParams: public DescriptorParams
 	float bandWidth; // Width of each band
 	bool bidirectional; // True if each band is bidirectional
 	bool useProjection; // True if the angle calculation is using a projection
+	bool canonicalize; // True if the bands have to be circularly shifted to start at the dominant one
 	int binNumber; // Number of bins per band
 	Params::Statistic stat; // Statistic used in the descriptor
+	int maxNeighbors; // Max number of neighbors used per patch (non positive means no limit)
 
 	float angle; // Orientation of the zero band (run time parameter)
 
@@ -93,8 +95,10 @@ struct DCHParams: public DescriptorParams
 		bandWidth = 0.01;
 		bidirectional = true;
 		useProjection = true;
+		canonicalize = false;
 		binNumber = 1;
 		stat = Params::STAT_MEAN;
+		maxNeighbors = -1;
 
 		angle  = 0;
 	}
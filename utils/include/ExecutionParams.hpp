@@ -8,6 +8,7 @@
 #include <vector>
 #include <math.h>
 #include <sstream>
+#include <stdexcept>
 #include <boost/shared_ptr.hpp>
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string.hpp>
@@ -155,6 +156,114 @@ static inline SynCloudType toSynCloudType(const std::string &type_)
 	LOGW << "Wrong synthetic cloud type, assuming SPHERE";
 	return CLOUD_SPHERE;
 }
+
+
+/**************************************************/
+/**************************************************/
+enum SearchBackend
+{
+	SEARCH_KDTREE,
+	SEARCH_GRID,
+	SEARCH_ORGANIZED
+};
+static std::string searchBackend[] = {
+	BOOST_STRINGIZE(SEARCH_KDTREE),
+	BOOST_STRINGIZE(SEARCH_GRID),
+	BOOST_STRINGIZE(SEARCH_ORGANIZED)
+};
+
+static inline SearchBackend toSearchBackend(const std::string &type_)
+{
+	if (boost::iequals(type_, "kdtree"))
+		return SEARCH_KDTREE;
+	else if (boost::iequals(type_, "grid"))
+		return SEARCH_GRID;
+	else if (boost::iequals(type_, "organized"))
+		return SEARCH_ORGANIZED;
+
+	LOGW << "Wrong search backend, assuming KDTREE";
+	return SEARCH_KDTREE;
+}
+
+
+/**************************************************/
+/**************************************************/
+enum PCDEncoding
+{
+	PCD_ASCII,
+	PCD_BINARY,
+	PCD_BINARY_COMPRESSED
+};
+static std::string pcdEncoding[] = {
+	BOOST_STRINGIZE(PCD_ASCII),
+	BOOST_STRINGIZE(PCD_BINARY),
+	BOOST_STRINGIZE(PCD_BINARY_COMPRESSED)
+};
+
+static inline PCDEncoding toPCDEncoding(const std::string &type_)
+{
+	if (boost::iequals(type_, "ascii"))
+		return PCD_ASCII;
+	else if (boost::iequals(type_, "binary"))
+		return PCD_BINARY;
+	else if (boost::iequals(type_, "binary_compressed"))
+		return PCD_BINARY_COMPRESSED;
+
+	// Never assumed, since a wrong guess would make files be misread (or rewritten) in another encoding
+	throw std::runtime_error("Wrong PCD encoding: " + type_);
+}
+
+
+/**************************************************/
+/**************************************************/
+enum MatrixFormat
+{
+	MATRIX_TEXT,
+	MATRIX_BINARY,
+	MATRIX_COMPRESSED
+};
+static std::string matrixFormat[] = {
+	BOOST_STRINGIZE(MATRIX_TEXT),
+	BOOST_STRINGIZE(MATRIX_BINARY),
+	BOOST_STRINGIZE(MATRIX_COMPRESSED)
+};
+
+static inline MatrixFormat toMatrixFormat(const std::string &type_)
+{
+	if (boost::iequals(type_, "text"))
+		return MATRIX_TEXT;
+	else if (boost::iequals(type_, "binary"))
+		return MATRIX_BINARY;
+	else if (boost::iequals(type_, "compressed"))
+		return MATRIX_COMPRESSED;
+
+	LOGW << "Wrong matrix format, assuming TEXT";
+	return MATRIX_TEXT;
+}
+
+
+/**************************************************/
+/**************************************************/
+enum ChecksumType
+{
+	CHECKSUM_MD5,
+	CHECKSUM_TREE
+};
+static std::string checksumType[] = {
+	BOOST_STRINGIZE(CHECKSUM_MD5),
+	BOOST_STRINGIZE(CHECKSUM_TREE)
+};
+
+static inline ChecksumType toChecksumType(const std::string &type_)
+{
+	if (boost::iequals(type_, "md5"))
+		return CHECKSUM_MD5;
+	else if (boost::iequals(type_, "tree"))
+		return CHECKSUM_TREE;
+
+	LOGW << "Wrong checksum type, assuming TREE";
+	return CHECKSUM_TREE;
+}
 }
 
 
@@ -206,20 +315,35 @@ struct ClusteringParams
 };
 
 /**
- * Structure grouping the params for the cloud smoothing routine
+ * Structure grouping the params for the cloud smoothing routine (and the optional downsampling
+ * applied before any neighborhood processing)
  */
 struct CloudSmoothingParams
 {
 	bool useSmoothing; // Flag indicating if the smoothing has to be performed or not
+	bool useDownsampling; // Flag indicating if the cloud has to be downsampled with a voxel grid
+	bool collapseDuplicates; // Flag indicating if exactly duplicated points have to be collapsed into one
+	int threads; // Threads used for the smoothing (non positive means automatic)
 	double sigma; // Sigma used for the gaussian smoothing
 	double radius; // Search radius used for the gaussian smoothing
+	double voxelSize; // Edge length of the voxels used for the downsampling
 
 	/**************************************************/
 	CloudSmoothingParams()
 	{
 		useSmoothing = false;
+		useDownsampling = false;
+		collapseDuplicates = false;
+		threads = 0;
 		sigma = 2;
 		radius = 0.02;
+		voxelSize = 0.002;
+	}
+
+	/**************************************************/
+	bool modifiesCloud() const
+	{
+		return useSmoothing || useDownsampling || collapseDuplicates;
 	}
 
 	/**************************************************/
@@ -230,6 +354,13 @@ struct CloudSmoothingParams
 			   << "useSmoothing:" << useSmoothing
 			   << " sigma:" << sigma
 			   << " radius:" << radius;
+
+		// Only added when enabled, so the strings (and hashes) of previous configurations don't change
+		if (useDownsampling)
+			stream << " voxelSize:" << voxelSize;
+		if (collapseDuplicates)
+			stream << " collapseDuplicates:" << collapseDuplicates;
+
 		return stream.str();
 	}
 };
@@ -0,0 +1,222 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+#include <boost/shared_ptr.hpp>
+#include <pcl/point_cloud.h>
+#include <pcl/search/search.h>
+
+
+// Shared pointer definition
+class NeighborGraph;
+typedef boost::shared_ptr<NeighborGraph> NeighborGraphPtr;
+
+
+/**
+ * Radius neighbor graph of a cloud stored in CSR form: the neighbors of each point (sorted by
+ * distance) are stored contiguously, delimited by an offsets array. It's computed once at the
+ * largest radius needed, so every stage using an equal or smaller radius can read its neighbors
+ * by truncation instead of searching again.
+ */
+class NeighborGraph
+{
+public:
+	/**************************************************/
+	template<typename PointT>
+	static NeighborGraphPtr build(const typename pcl::search::Search<PointT>::Ptr &search_,
+								  const double radius_);
+
+	/**************************************************/
+	size_t getNeighbors(const int index_,
+						const double radius_,
+						std::vector<int> &pointIndices_,
+						std::vector<float> &sqrDistances_,
+						const unsigned int maxNeighbors_ = 0) const;
+
+	/**************************************************/
+	NeighborGraphPtr reorder(const std::vector<int> &order_) const;
+
+	/**************************************************/
+	double getRadius() const
+	{
+		return radius;
+	}
+
+	/**************************************************/
+	size_t size() const
+	{
+		return offsets.empty() ? 0 : offsets.size() - 1;
+	}
+
+	/**************************************************/
+	size_t getEdgeNumber() const
+	{
+		return indices.size();
+	}
+
+private:
+	NeighborGraph()
+	{
+		radius = 0;
+	}
+
+	double radius; // Radius used to build the graph
+	std::vector<size_t> offsets; // Start of the neighbors of each point (plus the end of the last one)
+	std::vector<int> indices; // Neighbor indices of every point, sorted by distance
+	std::vector<float> sqrDistances; // Squared distance to each neighbor
+};
+
+
+/**
+ * Search adapter answering the radius searches of the cloud's own points from a neighbor graph,
+ * as long as the radius isn't larger than the graph's. Any other query (KNN, larger radius,
+ * points not in the cloud) is answered by a fallback search, built only when first needed.
+ *
+ * The input cloud must have the same points, in the same order, than the one used to build the
+ * graph (it can be of a different point type).
+ */
+template<typename PointT>
+class NeighborGraphSearch: public pcl::search::Search<PointT>
+{
+public:
+	typedef typename pcl::search::Search<PointT>::Ptr SearchPtr;
+	typedef typename pcl::search::Search<PointT>::PointCloud PointCloud;
+	typedef typename pcl::search::Search<PointT>::PointCloudConstPtr PointCloudConstPtr;
+	typedef typename pcl::search::Search<PointT>::IndicesConstPtr IndicesConstPtr;
+
+	using pcl::search::Search<PointT>::input_;
+	using pcl::search::Search<PointT>::indices_;
+	using pcl::search::Search<PointT>::radiusSearch;
+	using pcl::search::Search<PointT>::nearestKSearch;
+
+	/**************************************************/
+	NeighborGraphSearch(const NeighborGraphPtr &graph_,
+						const SearchPtr &fallback_)
+		: pcl::search::Search<PointT>("NeighborGraphSearch", true)
+	{
+		graph = graph_;
+		fallback = fallback_;
+		fallback->setSortedResults(true);
+		fallbackReady = false;
+		usable = false;
+	}
+
+	/**************************************************/
+	~NeighborGraphSearch()
+	{
+	}
+
+	/**************************************************/
+	void setInputCloud(const PointCloudConstPtr &cloud_,
+					   const IndicesConstPtr &cloudIndices_ = IndicesConstPtr())
+	{
+		input_ = cloud_;
+		indices_ = cloudIndices_;
+		usable = !cloudIndices_ && cloud_->size() == graph->size();
+		fallbackReady = false;
+
+		if (!usable)
+			prepareFallback();
+	}
+
+	/**************************************************/
+	int nearestKSearch(const PointT &point_,
+					   int k_,
+					   std::vector<int> &pointIndices_,
+					   std::vector<float> &sqrDistances_) const
+	{
+		prepareFallback();
+		return fallback->nearestKSearch(point_, k_, pointIndices_, sqrDistances_);
+	}
+
+	/**************************************************/
+	int radiusSearch(const PointT &point_,
+					 double radius_,
+					 std::vector<int> &pointIndices_,
+					 std::vector<float> &sqrDistances_,
+					 unsigned int maxNeighbors_ = 0) const
+	{
+		// Queries made with the cloud's own points (as most PCL algorithms do) are mapped to their index
+		int index = cloudIndex(point_);
+		if (index >= 0)
+			return radiusSearch(index, radius_, pointIndices_, sqrDistances_, maxNeighbors_);
+
+		prepareFallback();
+		return fallback->radiusSearch(point_, radius_, pointIndices_, sqrDistances_, maxNeighbors_);
+	}
+
+	/**************************************************/
+	int radiusSearch(const PointCloud &cloud_,
+					 int index_,
+					 double radius_,
+					 std::vector<int> &pointIndices_,
+					 std::vector<float> &sqrDistances_,
+					 unsigned int maxNeighbors_ = 0) const
+	{
+		if (&cloud_ == input_.get())
+			return radiusSearch(index_, radius_, pointIndices_, sqrDistances_, maxNeighbors_);
+
+		return radiusSearch(cloud_.points[index_], radius_, pointIndices_, sqrDistances_, maxNeighbors_);
+	}
+
+	/**************************************************/
+	int radiusSearch(int index_,
+					 double radius_,
+					 std::vector<int> &pointIndices_,
+					 std::vector<float> &sqrDistances_,
+					 unsigned int maxNeighbors_ = 0) const
+	{
+		if (usable && radius_ <= graph->getRadius())
+			return graph->getNeighbors(index_, radius_, pointIndices_, sqrDistances_, maxNeighbors_);
+
+		prepareFallback();
+		return fallback->radiusSearch(index_, radius_, pointIndices_, sqrDistances_, maxNeighbors_);
+	}
+
+private:
+	/**************************************************/
+	inline int cloudIndex(const PointT &point_) const
+	{
+		if (!usable || input_->empty())
+			return -1;
+
+		ptrdiff_t index = &point_ - &input_->points[0];
+		return index >= 0 && index < (ptrdiff_t) input_->size() ? (int) index : -1;
+	}
+
+	/**************************************************/
+	void prepareFallback() const
+	{
+		// Checked before locking, so the queries made once the fallback is built don't serialize
+		if (fallbackReady)
+			return;
+
+#ifdef _OPENMP
+#pragma omp critical (NeighborGraphSearch_fallback)
+#endif
+		{
+			if (!fallbackReady)
+			{
+				fallback->setInputCloud(input_, indices_);
+
+				// The search has to be complete before any thread sees the flag set
+#ifdef _OPENMP
+#pragma omp flush
+#endif
+				fallbackReady = true;
+			}
+		}
+	}
+
+
+	NeighborGraphPtr graph; // Precomputed neighbors
+	SearchPtr fallback; // Search used for the queries the graph can't answer
+	mutable bool fallbackReady; // Flag indicating if the fallback search has been already built
+	bool usable; // Flag indicating if the graph matches the input cloud
+};
@@ -0,0 +1,276 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <cmath>
+#include <stdint.h>
+#include <boost/unordered_map.hpp>
+#include <pcl/point_cloud.h>
+#include <pcl/search/search.h>
+
+
+/**
+ * Uniform voxel hash grid implementing PCL's search interface. Points are bucketed into
+ * cubic cells of a fixed size (normally the search radius used afterwards), so a radius
+ * search only has to visit the 27 cells around the query, with no tree to traverse.
+ *
+ * It's intended for fixed-radius queries over roughly uniform surfaces. K nearest neighbors
+ * queries are supported (expanding rings of cells around the query), but the kd-tree is a
+ * better choice for them.
+ */
+template<typename PointT>
+class SpatialHashGrid: public pcl::search::Search<PointT>
+{
+public:
+	typedef boost::shared_ptr<SpatialHashGrid<PointT> > Ptr;
+	typedef boost::shared_ptr<const SpatialHashGrid<PointT> > ConstPtr;
+	typedef typename pcl::search::Search<PointT>::PointCloudConstPtr PointCloudConstPtr;
+	typedef typename pcl::search::Search<PointT>::IndicesConstPtr IndicesConstPtr;
+
+	using pcl::search::Search<PointT>::input_;
+	using pcl::search::Search<PointT>::indices_;
+	using pcl::search::Search<PointT>::sorted_results_;
+	using pcl::search::Search<PointT>::radiusSearch;
+	using pcl::search::Search<PointT>::nearestKSearch;
+
+	/**************************************************/
+	SpatialHashGrid(const float cellSize_,
+					const bool sortedResults_ = true)
+		: pcl::search::Search<PointT>("SpatialHashGrid", sortedResults_)
+	{
+		if (cellSize_ <= 0)
+			throw std::runtime_error("Cell size for the hash grid must be positive");
+
+		cellSize = cellSize_;
+		invCellSize = 1.0 / cellSize_;
+		minCell[0] = minCell[1] = minCell[2] = 0;
+		maxCell[0] = maxCell[1] = maxCell[2] = -1;
+	}
+
+	/**************************************************/
+	~SpatialHashGrid()
+	{
+	}
+
+	/**************************************************/
+	float getCellSize() const
+	{
+		return cellSize;
+	}
+
+	/**************************************************/
+	size_t getCellNumber() const
+	{
+		return cells.size();
+	}
+
+	/**************************************************/
+	void setInputCloud(const PointCloudConstPtr &cloud_,
+					   const IndicesConstPtr &cloudIndices_ = IndicesConstPtr())
+	{
+		input_ = cloud_;
+		indices_ = cloudIndices_;
+		build();
+	}
+
+	/**************************************************/
+	int radiusSearch(const PointT &point_,
+					 double radius_,
+					 std::vector<int> &pointIndices_,
+					 std::vector<float> &sqrDistances_,
+					 unsigned int maxNeighbors_ = 0) const
+	{
+		pointIndices_.clear();
+		sqrDistances_.clear();
+
+		int center[3];
+		getCell(point_, center);
+
+		float sqrRadius = radius_ * radius_;
+		int ring = std::max(1, (int) ceil(radius_ * invCellSize));
+
+		std::vector<std::pair<float, int> > found;
+		for (int i = center[0] - ring; i <= center[0] + ring; i++)
+			for (int j = center[1] - ring; j <= center[1] + ring; j++)
+				for (int k = center[2] - ring; k <= center[2] + ring; k++)
+					scanCell(i, j, k, point_, sqrRadius, found);
+
+		if (sorted_results_ || (maxNeighbors_ > 0 && found.size() > maxNeighbors_))
+			std::sort(found.begin(), found.end());
+
+		if (maxNeighbors_ > 0 && found.size() > maxNeighbors_)
+			found.resize(maxNeighbors_);
+
+		unpack(found, pointIndices_, sqrDistances_);
+		return pointIndices_.size();
+	}
+
+	/**************************************************/
+	int nearestKSearch(const PointT &point_,
+					   int k_,
+					   std::vector<int> &pointIndices_,
+					   std::vector<float> &sqrDistances_) const
+	{
+		pointIndices_.clear();
+		sqrDistances_.clear();
+		if (k_ <= 0 || cells.empty())
+			return 0;
+
+		int center[3];
+		getCell(point_, center);
+
+		// Largest ring needed to cover the whole grid from the query's cell
+		int maxRing = 0;
+		for (int d = 0; d < 3; d++)
+			maxRing = std::max(maxRing, std::max(center[d] - minCell[d], maxCell[d] - center[d]));
+
+		std::vector<std::pair<float, int> > found;
+		float unbounded = std::numeric_limits<float>::max();
+		for (int ring = 0; ring <= maxRing; ring++)
+		{
+			// Visit only the shell of the current ring
+			for (int i = center[0] - ring; i <= center[0] + ring; i++)
+				for (int j = center[1] - ring; j <= center[1] + ring; j++)
+					for (int k = center[2] - ring; k <= center[2] + ring; k++)
+						if (abs(i - center[0]) == ring || abs(j - center[1]) == ring || abs(k - center[2]) == ring)
+							scanCell(i, j, k, point_, unbounded, found);
+
+			/**
+			 * Any cell not visited yet is at least ring * cellSize away from the query, so the search
+			 * can stop once the k-th closest candidate is closer than that
+			 */
+			if (found.size() >= (size_t) k_)
+			{
+				std::nth_element(found.begin(), found.begin() + (k_ - 1), found.end());
+				float limit = ring * cellSize;
+				if (found[k_ - 1].first <= limit * limit)
+					break;
+			}
+		}
+
+		size_t n = std::min(found.size(), (size_t) k_);
+		std::partial_sort(found.begin(), found.begin() + n, found.end());
+		found.resize(n);
+
+		unpack(found, pointIndices_, sqrDistances_);
+		return pointIndices_.size();
+	}
+
+private:
+	/**************************************************/
+	inline void getCell(const PointT &point_,
+						int *cell_) const
+	{
+		cell_[0] = (int) floor(point_.x * invCellSize);
+		cell_[1] = (int) floor(point_.y * invCellSize);
+		cell_[2] = (int) floor(point_.z * invCellSize);
+	}
+
+	/**************************************************/
+	static inline uint64_t key(const int i_,
+							   const int j_,
+							   const int k_)
+	{
+		// 21 bits per coordinate, enough for any cloud at any sensible cell size
+		return ((uint64_t) (i_ & 0x1FFFFF) << 42) | ((uint64_t) (j_ & 0x1FFFFF) << 21) | (uint64_t) (k_ & 0x1FFFFF);
+	}
+
+	/**************************************************/
+	void build()
+	{
+		cells.clear();
+		points.clear();
+		minCell[0] = minCell[1] = minCell[2] = std::numeric_limits<int>::max();
+		maxCell[0] = maxCell[1] = maxCell[2] = std::numeric_limits<int>::min();
+
+		size_t total = indices_ ? indices_->size() : input_->size();
+
+		// Compute the key of each (finite) point and sort them so each cell ends up contiguous
+		std::vector<std::pair<uint64_t, int> > keyed;
+		keyed.reserve(total);
+		for (size_t n = 0; n < total; n++)
+		{
+			int index = indices_ ? (*indices_)[n] : (int) n;
+			const PointT &p = input_->points[index];
+			if (!pcl_isfinite(p.x) || !pcl_isfinite(p.y) || !pcl_isfinite(p.z))
+				continue;
+
+			int cell[3];
+			getCell(p, cell);
+			for (int d = 0; d < 3; d++)
+			{
+				minCell[d] = std::min(minCell[d], cell[d]);
+				maxCell[d] = std::max(maxCell[d], cell[d]);
+			}
+
+			keyed.push_back(std::make_pair(key(cell[0], cell[1], cell[2]), index));
+		}
+		std::sort(keyed.begin(), keyed.end());
+
+		points.resize(keyed.size());
+		for (size_t n = 0; n < keyed.size(); n++)
+		{
+			points[n] = keyed[n].second;
+			if (n == 0 || keyed[n].first != keyed[n - 1].first)
+				cells[keyed[n].first] = std::make_pair(n, n);
+			cells[keyed[n].first].second = n + 1;
+		}
+	}
+
+	/**************************************************/
+	inline void scanCell(const int i_,
+						 const int j_,
+						 const int k_,
+						 const PointT &point_,
+						 const float sqrRadius_,
+						 std::vector<std::pair<float, int> > &found_) const
+	{
+		if (i_ < minCell[0] || i_ > maxCell[0]
+				|| j_ < minCell[1] || j_ > maxCell[1]
+				|| k_ < minCell[2] || k_ > maxCell[2])
+			return;
+
+		typename boost::unordered_map<uint64_t, std::pair<size_t, size_t> >::const_iterator it = cells.find(key(i_, j_, k_));
+		if (it == cells.end())
+			return;
+
+		for (size_t n = it->second.first; n < it->second.second; n++)
+		{
+			const PointT &p = input_->points[points[n]];
+			float dx = p.x - point_.x;
+			float dy = p.y - point_.y;
+			float dz = p.z - point_.z;
+			float sqrDistance = dx * dx + dy * dy + dz * dz;
+			if (sqrDistance <= sqrRadius_)
+				found_.push_back(std::make_pair(sqrDistance, points[n]));
+		}
+	}
+
+	/**************************************************/
+	static inline void unpack(const std::vector<std::pair<float, int> > &found_,
+							  std::vector<int> &pointIndices_,
+							  std::vector<float> &sqrDistances_)
+	{
+		pointIndices_.resize(found_.size());
+		sqrDistances_.resize(found_.size());
+		for (size_t n = 0; n < found_.size(); n++)
+		{
+			sqrDistances_[n] = found_[n].first;
+			pointIndices_[n] = found_[n].second;
+		}
+	}
+
+
+	float cellSize; // Edge length of each cell
+	float invCellSize; // Inverse of the cell size (to avoid divisions)
+	int minCell[3]; // Minimum cell coordinates holding points
+	int maxCell[3]; // Maximum cell coordinates holding points
+	std::vector<int> points; // Point indices sorted by cell
+	boost::unordered_map<uint64_t, std::pair<size_t, size_t> > cells; // Range of each cell in the points vector
+};
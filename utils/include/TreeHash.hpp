@@ -0,0 +1,34 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * Content hash for large inputs. The data is split in fixed size chunks hashed in parallel with
+ * XXH64 and the chunk hashes are hashed again (together with the total size) into the final
+ * digest. It's not cryptographic, but it's only used to tell input files apart in the cache keys,
+ * where it's much faster than a single threaded MD5 pass over the whole file.
+ */
+class TreeHash
+{
+public:
+	/**************************************************/
+	static uint64_t xxh64(const void *data_,
+						  const size_t size_,
+						  const uint64_t seed_ = 0);
+
+	/**************************************************/
+	static std::string digest(const void *data_,
+							  const size_t size_,
+							  const size_t chunkSize_ = 0);
+
+private:
+	TreeHash();
+	~TreeHash();
+};
@@ -142,11 +142,37 @@ public:
 	static std::string getCalculationConfigHash(const std::string inputCloudFile_,
 			const double normalEstimationRadius_,
 			const DescriptorParamsPtr &descriptorParams_,
-			const CloudSmoothingParams &smoothingParams_);
+			const CloudSmoothingParams &smoothingParams_,
+			const bool legacyKey_ = false);
+
+	/**************************************************/
+	static std::string getPreprocessingHash(const std::string inputCloudFile_,
+											const double normalEstimationRadius_,
+											const CloudSmoothingParams &smoothingParams_,
+											const bool legacyKey_ = false);
+
+	/**************************************************/
+	static bool isCacheKey(const std::string &key_);
+
+	/**************************************************/
+	static bool isLegacyCacheKey(const std::string &key_);
+
+	/**************************************************/
+	static bool isCacheEntry(const std::string &filename_);
+
+	/**************************************************/
+	static bool isLegacyCacheEntry(const std::string &filename_);
+
+	/**************************************************/
+	static std::string getTemporaryFilename(const std::string &destination_);
 
 	/**************************************************/
 	static std::string getFileChecksum(const std::string filename_);
 
+	/**************************************************/
+	static std::string computeFileChecksum(const std::string filename_,
+										   const Params::ChecksumType type_);
+
 	/**************************************************/
 	static int getRandomNumber(const int min_,
 							   const int max_);
@@ -259,4 +285,11 @@ public:
 private:
 	Utils();
 	~Utils();
+
+	/**************************************************/
+	static std::string getKeyChecksum(const std::string &filename_,
+									  const bool legacyKey_);
+
+	/**************************************************/
+	static std::string getEntryKey(const std::string &filename_);
 };
@@ -0,0 +1,78 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#pragma once
+
+#include <map>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+
+/**
+ * Running centroids of the points falling in each cell of a regular voxel grid. Points can be
+ * added in several batches (e.g. the chunks of a streamed file) and the coordinates are summed
+ * in float in the order they're added, so a cloud gets exactly the same centroids whether it's
+ * reduced at once or chunk by chunk. Non finite points are skipped.
+ */
+class VoxelCentroids
+{
+public:
+	/**************************************************/
+	VoxelCentroids(const double voxelSize_);
+
+	/**************************************************/
+	~VoxelCentroids();
+
+	/**************************************************/
+	void add(const pcl::PointCloud<pcl::PointXYZ> &cloud_);
+
+	/**************************************************/
+	pcl::PointCloud<pcl::PointXYZ>::Ptr getCentroids() const;
+
+	/**************************************************/
+	size_t size() const
+	{
+		return voxels.size();
+	}
+
+private:
+	/**
+	 * Integer coordinates of a voxel, ordered the same way PCL's VoxelGrid orders its output
+	 * (z, then y, then x)
+	 */
+	struct Cell
+	{
+		int i, j, k;
+
+		/**************************************************/
+		bool operator<(const Cell &other_) const
+		{
+			if (k != other_.k)
+				return k < other_.k;
+			if (j != other_.j)
+				return j < other_.j;
+			return i < other_.i;
+		}
+	};
+
+	/**
+	 * Running sum of the points falling in a voxel
+	 */
+	struct Accumulator
+	{
+		float x, y, z;
+		size_t count;
+
+		/**************************************************/
+		Accumulator()
+		{
+			x = y = z = 0;
+			count = 0;
+		}
+	};
+
+
+	float inverseSize; // Inverse of the voxel size (computed as VoxelGrid does, so points fall in the same voxels)
+	std::map<Cell, Accumulator> voxels; // Occupied voxels
+};
@@ -0,0 +1,55 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include "AppendLog.hpp"
+#include <fstream>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <plog/Log.h>
+#include "Utils.hpp"
+
+
+bool AppendLog::append(const std::string &filename_,
+					   const std::string &line_)
+{
+	// Small appends are atomic, so several processes can share the file
+	std::string text = line_ + "\n";
+	int fileDescriptor = open(filename_.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+	if (fileDescriptor < 0)
+		return false;
+
+	bool writeOk = write(fileDescriptor, text.c_str(), text.size()) == (ssize_t) text.size();
+	if (!writeOk)
+		LOGW << "Unable to update " << filename_;
+	close(fileDescriptor);
+
+	return writeOk;
+}
+
+bool AppendLog::isOutdated(const size_t lines_,
+						   const size_t entries_)
+{
+	// Worth rewriting once most of the lines are outdated
+	return lines_ > 2 * entries_ + 100;
+}
+
+bool AppendLog::rewrite(const std::string &filename_,
+						const std::string &contents_)
+{
+	std::string temporary = Utils::getTemporaryFilename(filename_);
+	std::ofstream output(temporary.c_str(), std::ios::out | std::ios::trunc);
+	output << contents_;
+	output.close();
+
+	// Renamed over the old file, so readers see either the old lines or the new ones
+	if (output.fail() || rename(temporary.c_str(), filename_.c_str()) != 0)
+	{
+		LOGW << "Unable to compact " << filename_;
+		remove(temporary.c_str());
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,143 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include "ChecksumIndex.hpp"
+#include <fstream>
+#include <sstream>
+#include <ctime>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
+#include "Utils.hpp"
+#include "AppendLog.hpp"
+#include "Config.hpp"
+
+
+#define CHECKSUM_INDEX_FILE		"checksums.index"
+#define RACY_INTERVAL			2
+#define TREE_KEY_PREFIX			"tree:"
+#define MD5_DIGEST_CHARS		32
+#define TREE_DIGEST_CHARS		16
+
+
+std::string ChecksumIndex::getChecksum(const std::string &filename_,
+									   const Params::ChecksumType type_)
+{
+	if (!Config::useChecksumIndex())
+		return Utils::computeFileChecksum(filename_, type_);
+
+	struct stat statbuf;
+	if (stat(filename_.c_str(), &statbuf) < 0)
+		throw std::runtime_error("ERROR: Unable to get file properties for checksum");
+
+	Entry current;
+	current.device = statbuf.st_dev;
+	current.inode = statbuf.st_ino;
+	current.size = statbuf.st_size;
+	current.mtimeSec = statbuf.st_mtim.tv_sec;
+	current.mtimeNsec = statbuf.st_mtim.tv_nsec;
+
+	// MD5 entries are keyed by the bare path, any other hash gets its name prefixed
+	std::string path = boost::filesystem::absolute(filename_).string();
+	if (type_ == Params::CHECKSUM_TREE)
+		path = TREE_KEY_PREFIX + path;
+	std::string location = Config::getCacheDirectory().empty() ? "" : Config::getCacheDirectory() + CHECKSUM_INDEX_FILE;
+
+	ChecksumIndex *index = getInstance();
+	{
+		boost::mutex::scoped_lock lock(index->mutex);
+		if (!index->loaded || index->location != location)
+			index->load(location);
+
+		std::map<std::string, Entry>::const_iterator it = index->entries.find(path);
+		if (it != index->entries.end() && it->second.sameFile(current))
+			return it->second.digest;
+	}
+
+	// Hash out of the lock, so different files can be hashed at the same time
+	current.digest = Utils::computeFileChecksum(filename_, type_);
+
+	/**
+	 * A file modified right before being hashed could be modified again without changing its
+	 * timestamp, so its digest isn't trusted (nor stored) until the timestamp is old enough
+	 */
+	if (time(NULL) - current.mtimeSec >= RACY_INTERVAL)
+	{
+		boost::mutex::scoped_lock lock(index->mutex);
+		index->entries[path] = current;
+		index->append(path, current);
+	}
+
+	return current.digest;
+}
+
+void ChecksumIndex::clear()
+{
+	ChecksumIndex *index = getInstance();
+	boost::mutex::scoped_lock lock(index->mutex);
+	index->entries.clear();
+	index->loaded = false;
+}
+
+void ChecksumIndex::load(const std::string &location_)
+{
+	entries.clear();
+	location = location_;
+	loaded = true;
+
+	if (location.empty())
+		return;
+
+	std::ifstream file(location.c_str());
+	if (!file.is_open())
+		return;
+
+	// Each line holds: digest device inode size mtimeSec mtimeNsec key
+	size_t lines = 0;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream iss(line);
+		Entry entry;
+		std::string path;
+		if (iss >> entry.digest >> entry.device >> entry.inode >> entry.size >> entry.mtimeSec >> entry.mtimeNsec && std::getline(iss >> std::ws, path))
+		{
+			// A line torn by an interrupted append gets merged with the next one
+			size_t digestChars = boost::starts_with(path, TREE_KEY_PREFIX) ? TREE_DIGEST_CHARS : MD5_DIGEST_CHARS;
+			if (entry.digest.size() != digestChars || entry.digest.find_first_not_of("0123456789abcdef") != std::string::npos)
+				continue;
+
+			entries[path] = entry;
+			lines++;
+		}
+	}
+	file.close();
+
+	if (AppendLog::isOutdated(lines, entries.size()))
+	{
+		std::ostringstream contents;
+		for (std::map<std::string, Entry>::const_iterator it = entries.begin(); it != entries.end(); it++)
+			contents << toLine(it->first, it->second) << "\n";
+		AppendLog::rewrite(location, contents.str());
+	}
+}
+
+void ChecksumIndex::append(const std::string &path_,
+						   const Entry &entry_)
+{
+	if (location.empty() || !boost::filesystem::exists(boost::filesystem::path(location).parent_path()))
+		return;
+
+	AppendLog::append(location, toLine(path_, entry_));
+}
+
+std::string ChecksumIndex::toLine(const std::string &path_,
+								  const Entry &entry_)
+{
+	std::ostringstream line;
+	line << entry_.digest << " " << entry_.device << " " << entry_.inode << " " << entry_.size
+		 << " " << entry_.mtimeSec << " " << entry_.mtimeNsec << " " << path_;
+	return line.str();
+}
@@ -4,13 +4,134 @@
  */
 #include "CloudUtils.hpp"
 #include <pcl/filters/convolution_3d.h>
-#include <pcl/surface/mls.h>
+#include <pcl/surface/mls_omp.h>
 #include <pcl/features/normal_3d_omp.h>
+#include <pcl/features/integral_image_normal.h>
+#include <pcl/common/common.h>
+#include <stdint.h>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <unistd.h>
+#include "Config.hpp"
+#include "VoxelCentroids.hpp"
 
 
+// Params of the integral image normal estimation (organized clouds)
+#define INTEGRAL_MAX_DEPTH_CHANGE		0.02
+#define INTEGRAL_SMOOTHING_SIZE			10.0
+
+
+static inline uint64_t spreadBits(uint64_t value_)
+{
+	// Spread the lower 21 bits of the value leaving two zero bits between each one
+	value_ &= 0x1FFFFF;
+	value_ = (value_ | value_ << 32) & 0x1F00000000FFFFULL;
+	value_ = (value_ | value_ << 16) & 0x1F0000FF0000FFULL;
+	value_ = (value_ | value_ << 8) & 0x100F00F00F00F00FULL;
+	value_ = (value_ | value_ << 4) & 0x10C30C30C30C30C3ULL;
+	value_ = (value_ | value_ << 2) & 0x1249249249249249ULL;
+	return value_;
+}
+
+static inline cv::Mat fieldView(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
+								const size_t offset_,
+								const int cols_)
+{
+	if (cloud_->empty())
+		return cv::Mat(0, cols_, CV_32FC1);
+
+	// Each row starts at the field's offset of a point and the next row is one point further
+	return cv::Mat(cloud_->size(), cols_, CV_32FC1, (char *) &cloud_->points[0] + offset_, sizeof(pcl::PointNormal));
+}
+
+static inline int resolveThreads(const int threads_)
+{
+	// Non positive values mean one thread per available core
+	return threads_ > 0 ? threads_ : sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+static bool lexicographicLess(const std::pair<pcl::PointXYZ, int> &lhs_,
+							  const std::pair<pcl::PointXYZ, int> &rhs_)
+{
+	if (lhs_.first.x != rhs_.first.x)
+		return lhs_.first.x < rhs_.first.x;
+	if (lhs_.first.y != rhs_.first.y)
+		return lhs_.first.y < rhs_.first.y;
+	if (lhs_.first.z != rhs_.first.z)
+		return lhs_.first.z < rhs_.first.z;
+	return lhs_.second < rhs_.second;
+}
+
+Params::SearchBackend CloudUtils::getSearchBackend(const bool organized_)
+{
+	// Image space searches are only possible over organized clouds, falling back to the kd-tree otherwise
+	Params::SearchBackend backend = Config::getSearchBackend();
+	if (organized_ && Config::useOrganizedPath())
+		return Params::SEARCH_ORGANIZED;
+	else if (!organized_ && backend == Params::SEARCH_ORGANIZED)
+		return Params::SEARCH_KDTREE;
+
+	return backend;
+}
+
+Params::PCDEncoding CloudUtils::getOutputEncoding()
+{
+	return Config::getOutputEncoding();
+}
+
+pcl::PointCloud<pcl::PointXYZ>::Ptr CloudUtils::downsample(const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_,
+		const double voxelSize_)
+{
+	// Each occupied voxel is replaced by the centroid of its points (the same ones streamed clouds get)
+	VoxelCentroids voxels(voxelSize_);
+	voxels.add(*cloud_);
+	pcl::PointCloud<pcl::PointXYZ>::Ptr downsampledCloud = voxels.getCentroids();
+
+	// Copy the viewpoint
+	downsampledCloud->sensor_origin_ = cloud_->sensor_origin_;
+
+	return downsampledCloud;
+}
+
+size_t CloudUtils::collapseDuplicates(const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_)
+{
+	// Sort the points so duplicates end up contiguous (ties resolved by index, so the first one is kept)
+	std::vector<std::pair<pcl::PointXYZ, int> > sorted;
+	sorted.reserve(cloud_->size());
+	for (size_t i = 0; i < cloud_->size(); i++)
+		sorted.push_back(std::make_pair(cloud_->points[i], i));
+	std::sort(sorted.begin(), sorted.end(), lexicographicLess);
+
+	std::vector<bool> keep(cloud_->size(), true);
+	for (size_t i = 1; i < sorted.size(); i++)
+	{
+		const pcl::PointXYZ &p = sorted[i].first;
+		const pcl::PointXYZ &q = sorted[i - 1].first;
+		if (p.x == q.x && p.y == q.y && p.z == q.z)
+			keep[sorted[i].second] = false;
+	}
+
+	// Compact the cloud preserving the original order of the kept points
+	size_t dest = 0;
+	for (size_t i = 0; i < cloud_->size(); i++)
+		if (keep[i])
+			cloud_->points[dest++] = cloud_->points[i];
+
+	size_t removed = cloud_->size() - dest;
+	cloud_->resize(dest);
+	cloud_->width = dest;
+	cloud_->height = 1;
+	cloud_->is_dense = true;
+
+	return removed;
+}
+
 pcl::PointCloud<pcl::PointXYZ>::Ptr CloudUtils::gaussianSmoothing(const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_,
 		const double sigma_,
-		const double radius_)
+		const double radius_,
+		const int threads_,
+		const NeighborGraphPtr &graph_)
 {
 	pcl::PointCloud<pcl::PointXYZ>::Ptr smoothedCloud(new pcl::PointCloud<pcl::PointXYZ>());
 
@@ -19,15 +140,16 @@ pcl::PointCloud<pcl::PointXYZ>::Ptr CloudUtils::gaussianSmoothing(const pcl::Poi
 	kernel->setSigma(sigma_);
 	kernel->setThresholdRelativeToSigma(3);
 
-	//Set up the KDTree
-	pcl::search::KdTree<pcl::PointXYZ>::Ptr kdTree(new pcl::search::KdTree<pcl::PointXYZ>);
-	kdTree->setInputCloud(cloud_);
+	//Set up the search method
+	pcl::search::Search<pcl::PointXYZ>::Ptr search = createSearch<pcl::PointXYZ>(getSearchBackend(cloud_->isOrganized()), radius_, graph_);
+	search->setInputCloud(cloud_);
 
-	//Set up the Convolution Filter
+	//Set up the Convolution Filter (each output point only depends on the input, so threads don't change the result)
 	pcl::filters::Convolution3D<pcl::PointXYZ, pcl::PointXYZ, pcl::filters::GaussianKernel<pcl::PointXYZ, pcl::PointXYZ> > convolution;
+	convolution.setNumberOfThreads(resolveThreads(threads_));
 	convolution.setKernel(*kernel);
 	convolution.setInputCloud(cloud_);
-	convolution.setSearchMethod(kdTree);
+	convolution.setSearchMethod(search);
 	convolution.setRadiusSearch(radius_);
 	convolution.convolve(*smoothedCloud);
 
@@ -38,21 +160,43 @@ pcl::PointCloud<pcl::PointXYZ>::Ptr CloudUtils::gaussianSmoothing(const pcl::Poi
 }
 
 pcl::PointCloud<pcl::PointXYZ>::Ptr CloudUtils::MLSSmoothing(const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_,
-		const double radius_)
+		const double radius_,
+		const int threads_,
+		const NeighborGraphPtr &graph_)
 {
 	pcl::PointCloud<pcl::PointXYZ>::Ptr smoothedCloud(new pcl::PointCloud<pcl::PointXYZ>());
 	pcl::PointCloud<pcl::PointNormal>::Ptr MLSPoints(new pcl::PointCloud<pcl::PointNormal>());
 
-	pcl::search::KdTree<pcl::PointXYZ>::Ptr kdTree(new pcl::search::KdTree<pcl::PointXYZ>);
-	pcl::MovingLeastSquares<pcl::PointXYZ, pcl::PointNormal> mls;
+	pcl::search::Search<pcl::PointXYZ>::Ptr search = createSearch<pcl::PointXYZ>(getSearchBackend(cloud_->isOrganized()), radius_, graph_);
+	// Without upsampling each point is projected independently, so the parallel version gives the same points
+	pcl::MovingLeastSquaresOMP<pcl::PointXYZ, pcl::PointNormal> mls(resolveThreads(threads_));
 	mls.setComputeNormals(false);
 	mls.setInputCloud(cloud_);
 	mls.setPolynomialFit(true);
-	mls.setSearchMethod(kdTree);
+	mls.setSearchMethod(search);
 	mls.setSearchRadius(radius_);
 	mls.process(*MLSPoints);
 
-	pcl::copyPointCloud<pcl::PointNormal, pcl::PointXYZ>(*MLSPoints, *smoothedCloud);
+	/**
+	 * The threads' outputs are joined in scheduling order, so the points are put back in the order
+	 * of the input points they come from (the same one the single threaded version gives)
+	 */
+	pcl::PointIndicesPtr corresponding = mls.getCorrespondingIndices();
+	if (corresponding && corresponding->indices.size() == MLSPoints->size())
+	{
+		std::vector<std::pair<int, int> > sources;
+		sources.reserve(MLSPoints->size());
+		for (size_t i = 0; i < MLSPoints->size(); i++)
+			sources.push_back(std::make_pair(corresponding->indices[i], i));
+		std::sort(sources.begin(), sources.end());
+
+		std::vector<int> order(sources.size());
+		for (size_t i = 0; i < sources.size(); i++)
+			order[i] = sources[i].second;
+		pcl::copyPointCloud<pcl::PointNormal, pcl::PointXYZ>(*MLSPoints, order, *smoothedCloud);
+	}
+	else
+		pcl::copyPointCloud<pcl::PointNormal, pcl::PointXYZ>(*MLSPoints, *smoothedCloud);
 
 	// Copy the viewpoint
 	smoothedCloud->sensor_origin_ = cloud_->sensor_origin_;
@@ -60,13 +204,40 @@ pcl::PointCloud<pcl::PointXYZ>::Ptr CloudUtils::MLSSmoothing(const pcl::PointClo
 	return smoothedCloud;
 }
 
+pcl::PointCloud<pcl::Normal>::Ptr CloudUtils::estimateOrganizedNormals(const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_)
+{
+	if (!cloud_->isOrganized())
+		throw std::runtime_error("Integral image normals require an organized cloud");
+
+	pcl::PointCloud<pcl::Normal>::Ptr normals(new pcl::PointCloud<pcl::Normal>());
+
+	// Invalid pixels (NaN) are kept, so the output has the same grid than the input
+	pcl::IntegralImageNormalEstimation<pcl::PointXYZ, pcl::Normal> normalEstimation;
+	normalEstimation.setNormalEstimationMethod(normalEstimation.AVERAGE_3D_GRADIENT);
+	normalEstimation.setMaxDepthChangeFactor(INTEGRAL_MAX_DEPTH_CHANGE);
+	normalEstimation.setNormalSmoothingSize(INTEGRAL_SMOOTHING_SIZE);
+	normalEstimation.setInputCloud(cloud_);
+	normalEstimation.compute(*normals);
+
+	return normals;
+}
+
 pcl::PointCloud<pcl::Normal>::Ptr CloudUtils::estimateNormals(const pcl::PointCloud<pcl::PointXYZ>::Ptr &cloud_,
-		const double searchRadius_)
+		const double searchRadius_,
+		const int threads_,
+		const NeighborGraphPtr &graph_)
 {
+	// Organized clouds keep their grid, so the normals can be computed over integral images instead
+	if (cloud_->isOrganized() && Config::useOrganizedPath())
+		return estimateOrganizedNormals(cloud_);
+
 	pcl::PointCloud<pcl::Normal>::Ptr normals(new pcl::PointCloud<pcl::Normal>());
 
-	pcl::search::KdTree<pcl::PointXYZ>::Ptr kdtree(new pcl::search::KdTree<pcl::PointXYZ>);
-	pcl::NormalEstimation<pcl::PointXYZ, pcl::Normal> normalEstimation;
+	// Each normal is computed independently, so the parallel estimation gives the same results
+	int threads = resolveThreads(threads_ < 0 ? Config::getNormalEstimationThreads() : threads_);
+
+	pcl::search::Search<pcl::PointXYZ>::Ptr search = createSearch<pcl::PointXYZ>(getSearchBackend(cloud_->isOrganized()), searchRadius_, graph_);
+	pcl::NormalEstimationOMP<pcl::PointXYZ, pcl::Normal> normalEstimation(threads);
 	normalEstimation.setInputCloud(cloud_);
 
 	if (searchRadius_ > 0)
@@ -74,31 +245,76 @@ pcl::PointCloud<pcl::Normal>::Ptr CloudUtils::estimateNormals(const pcl::PointCl
 	else
 		normalEstimation.setKSearch(10);
 
-	normalEstimation.setSearchMethod(kdtree);
+	normalEstimation.setSearchMethod(search);
 	normalEstimation.compute(*normals);
 
 	return normals;
 }
 
+std::vector<int> CloudUtils::mortonOrder(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_)
+{
+	std::vector<int> order;
+	if (cloud_->empty())
+		return order;
+
+	pcl::PointNormal minPt, maxPt;
+	pcl::getMinMax3D(*cloud_, minPt, maxPt);
+
+	// Same scale in every axis, so the curve's cells remain cubic
+	float extent = std::max(maxPt.x - minPt.x, std::max(maxPt.y - minPt.y, maxPt.z - minPt.z));
+	double scale = extent > 0 ? 0x1FFFFF / extent : 0;
+
+	std::vector<std::pair<uint64_t, int> > codes;
+	codes.reserve(cloud_->size());
+	for (size_t i = 0; i < cloud_->size(); i++)
+	{
+		const pcl::PointNormal &p = cloud_->points[i];
+
+		// Non finite points are moved to the end
+		uint64_t code = std::numeric_limits<uint64_t>::max();
+		if (pcl_isfinite(p.x) && pcl_isfinite(p.y) && pcl_isfinite(p.z))
+			code = spreadBits((uint64_t) ((p.x - minPt.x) * scale))
+				   | spreadBits((uint64_t) ((p.y - minPt.y) * scale)) << 1
+				   | spreadBits((uint64_t) ((p.z - minPt.z) * scale)) << 2;
+
+		codes.push_back(std::make_pair(code, i));
+	}
+	std::sort(codes.begin(), codes.end());
+
+	order.resize(codes.size());
+	for (size_t i = 0; i < codes.size(); i++)
+		order[i] = codes[i].second;
+
+	return order;
+}
+
 cv::Mat CloudUtils::toMatrix(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_,
 							 const bool includeNormals_)
 {
 	cv::Mat data = cv::Mat::zeros(cloud_->size(), includeNormals_ ? 7 : 3, CV_32FC1);
 
-	for (size_t i = 0; i < cloud_->size(); i++)
+	// Copy the fields through the views (row by row block copies instead of per element accesses)
+	pointsView(cloud_).copyTo(data.colRange(0, 3));
+	if (includeNormals_)
 	{
-		data.at<float>(i, 0) = cloud_->at(i).x;
-		data.at<float>(i, 1) = cloud_->at(i).y;
-		data.at<float>(i, 2) = cloud_->at(i).z;
-
-		if (includeNormals_)
-		{
-			data.at<float>(i, 3) = cloud_->at(i).normal_x;
-			data.at<float>(i, 4) = cloud_->at(i).normal_y;
-			data.at<float>(i, 5) = cloud_->at(i).normal_z;
-			data.at<float>(i, 6) = cloud_->at(i).curvature;
-		}
+		normalsView(cloud_).copyTo(data.colRange(3, 6));
+		curvatureView(cloud_).copyTo(data.colRange(6, 7));
 	}
 
 	return data;
 }
+
+cv::Mat CloudUtils::pointsView(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_)
+{
+	return fieldView(cloud_, offsetof(pcl::PointNormal, x), 3);
+}
+
+cv::Mat CloudUtils::normalsView(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_)
+{
+	return fieldView(cloud_, offsetof(pcl::PointNormal, normal_x), 3);
+}
+
+cv::Mat CloudUtils::curvatureView(const pcl::PointCloud<pcl::PointNormal>::Ptr &cloud_)
+{
+	return fieldView(cloud_, offsetof(pcl::PointNormal, curvature), 1);
+}
@@ -21,6 +21,19 @@ Config::Config()
 	debug = false;
 	targetPoint = -1;
 	normalEstimationRadius = -1;
+	normalEstimationThreads = 0;
+	cacheSizeLimit = 0;
+	searchBackend = Params::SEARCH_KDTREE;
+	mortonOrder = false;
+	organizedPath = false;
+	cloudCache = false;
+	batchQueueSize = 4;
+	streamChunkSize = 1000000;
+	outputQueueSize = 0;
+	matrixFormat = Params::MATRIX_TEXT;
+	outputEncoding = Params::PCD_ASCII;
+	checksumIndex = true;
+	checksumType = Params::CHECKSUM_TREE;
 
 	clusteringParams = NULL;
 	cloudSmoothingParams = NULL;
@@ -40,7 +53,20 @@ bool Config::load(const std::string &filename_)
 		instance->debug = config["debug"].as<bool>(false);
 		instance->targetPoint = config["targetPoint"].as<int>(-1);
 		instance->normalEstimationRadius = config["normalEstimationRadius"].as<double>(-1);
+		instance->normalEstimationThreads = config["normalEstimationThreads"].as<int>(0);
 		instance->cacheLocation = config["cacheLocation"].as<std::string>("");
+		instance->cacheSizeLimit = config["cacheSizeLimit"].as<int>(0);
+		instance->searchBackend = Params::toSearchBackend(config["searchBackend"].as<std::string>("kdtree"));
+		instance->mortonOrder = config["mortonOrder"].as<bool>(false);
+		instance->organizedPath = config["organizedPath"].as<bool>(false);
+		instance->cloudCache = config["cloudCache"].as<bool>(false);
+		instance->batchQueueSize = config["batchQueueSize"].as<int>(4);
+		instance->streamChunkSize = config["streamChunkSize"].as<int>(1000000);
+		instance->outputQueueSize = config["outputQueueSize"].as<int>(0);
+		instance->matrixFormat = Params::toMatrixFormat(config["matrixFormat"].as<std::string>("text"));
+		instance->outputEncoding = Params::toPCDEncoding(config["outputEncoding"].as<std::string>("ascii"));
+		instance->checksumIndex = config["checksumIndex"].as<bool>(true);
+		instance->checksumType = Params::toChecksumType(config["checksumType"].as<std::string>("tree"));
 
 
 		if (config["descriptor"])
@@ -94,6 +120,10 @@ bool Config::load(const std::string &filename_)
 			params->useSmoothing = smoothingConfig["useSmoothing"].as<bool>();
 			params->radius = smoothingConfig["radius"].as<double>();
 			params->sigma = smoothingConfig["sigma"].as<double>();
+			params->useDownsampling = smoothingConfig["useDownsampling"].as<bool>(false);
+			params->voxelSize = smoothingConfig["voxelSize"].as<double>(params->voxelSize);
+			params->collapseDuplicates = smoothingConfig["collapseDuplicates"].as<bool>(false);
+			params->threads = smoothingConfig["threads"].as<int>(0);
 
 			instance->cloudSmoothingParams = params;
 		}
@@ -71,6 +71,8 @@ void DCHParams::load(const YAML::Node &config_)
 	useProjection = config_["useProjection"].as<bool>();
 	binNumber = config_["binNumber"].as<float>();
 	stat = Params::toStatType(config_["stat"].as<std::string>());
+	maxNeighbors = config_["maxNeighbors"].as<int>(-1);
+	canonicalize = config_["canonicalize"].as<bool>(false);
 }
 
 std::string DCHParams::toString() const
@@ -85,6 +87,13 @@ std::string DCHParams::toString() const
 		   << " useProjection:" << useProjection
 		   << " binNumber:" << binNumber
 		   << " stat:" << Params::stat[stat];
+
+	// Only added when used, so the cache keys of uncapped calculations remain the same
+	if (maxNeighbors > 0)
+		stream << " maxNeighbors:" << maxNeighbors;
+	if (canonicalize)
+		stream << " canonicalize:" << canonicalize;
+
 	return stream.str();
 }
 
@@ -102,6 +111,8 @@ YAML::Node DCHParams::toNode() const
 	node[sType]["useProjection"] = useProjection;
 	node[sType]["binNumber"] = binNumber;
 	node[sType]["stat"] = statString;
+	node[sType]["maxNeighbors"] = maxNeighbors;
+	node[sType]["canonicalize"] = canonicalize;
 
 	return node;
 }
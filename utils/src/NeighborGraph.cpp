@@ -0,0 +1,107 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include "NeighborGraph.hpp"
+#include <algorithm>
+#include <pcl/point_types.h>
+
+
+template<typename PointT>
+NeighborGraphPtr NeighborGraph::build(const typename pcl::search::Search<PointT>::Ptr &search_,
+									  const double radius_)
+{
+	// A non positive radius would be taken as a huge one by some searches (the kd-tree squares it)
+	if (radius_ <= 0)
+		throw std::runtime_error("Non positive radius given to build the neighbor graph");
+
+	typename pcl::search::Search<PointT>::PointCloudConstPtr cloud = search_->getInputCloud();
+	if (!cloud)
+		throw std::runtime_error("Search without input cloud given to build the neighbor graph");
+
+	// Truncation requires the neighbors sorted by distance
+	search_->setSortedResults(true);
+
+	int n = cloud->size();
+	std::vector<std::vector<int> > rowIndices(n);
+	std::vector<std::vector<float> > rowDistances(n);
+
+	#pragma omp parallel for schedule(dynamic, 256)
+	for (int i = 0; i < n; i++)
+	{
+		const PointT &p = cloud->points[i];
+		if (pcl_isfinite(p.x) && pcl_isfinite(p.y) && pcl_isfinite(p.z))
+			search_->radiusSearch(p, radius_, rowIndices[i], rowDistances[i]);
+	}
+
+	NeighborGraphPtr graph(new NeighborGraph());
+	graph->radius = radius_;
+	graph->offsets.resize(n + 1, 0);
+	for (int i = 0; i < n; i++)
+		graph->offsets[i + 1] = graph->offsets[i] + rowIndices[i].size();
+
+	graph->indices.resize(graph->offsets[n]);
+	graph->sqrDistances.resize(graph->offsets[n]);
+	for (int i = 0; i < n; i++)
+	{
+		std::copy(rowIndices[i].begin(), rowIndices[i].end(), graph->indices.begin() + graph->offsets[i]);
+		std::copy(rowDistances[i].begin(), rowDistances[i].end(), graph->sqrDistances.begin() + graph->offsets[i]);
+	}
+
+	return graph;
+}
+
+// Point types the graph is built for (compiled here, so the build runs with the OpenMP flags of this library)
+template NeighborGraphPtr NeighborGraph::build<pcl::PointXYZ>(const pcl::search::Search<pcl::PointXYZ>::Ptr &search_, const double radius_);
+template NeighborGraphPtr NeighborGraph::build<pcl::PointNormal>(const pcl::search::Search<pcl::PointNormal>::Ptr &search_, const double radius_);
+
+
+size_t NeighborGraph::getNeighbors(const int index_,
+								   const double radius_,
+								   std::vector<int> &pointIndices_,
+								   std::vector<float> &sqrDistances_,
+								   const unsigned int maxNeighbors_) const
+{
+	std::vector<float>::const_iterator begin = sqrDistances.begin() + offsets[index_];
+	std::vector<float>::const_iterator end = sqrDistances.begin() + offsets[index_ + 1];
+
+	// Neighbors are sorted by distance, so a smaller radius is just a shorter prefix of the row
+	if (radius_ < radius)
+		end = std::upper_bound(begin, end, (float) (radius_ * radius_));
+
+	size_t count = end - begin;
+	if (maxNeighbors_ > 0)
+		count = std::min(count, (size_t) maxNeighbors_);
+
+	pointIndices_.assign(indices.begin() + offsets[index_], indices.begin() + offsets[index_] + count);
+	sqrDistances_.assign(begin, begin + count);
+
+	return count;
+}
+
+NeighborGraphPtr NeighborGraph::reorder(const std::vector<int> &order_) const
+{
+	// Position of each old index in the new order
+	std::vector<int> inverse(order_.size());
+	for (size_t i = 0; i < order_.size(); i++)
+		inverse[order_[i]] = i;
+
+	NeighborGraphPtr graph(new NeighborGraph());
+	graph->radius = radius;
+	graph->offsets.resize(offsets.size(), 0);
+	graph->indices.reserve(indices.size());
+	graph->sqrDistances.reserve(sqrDistances.size());
+
+	for (size_t i = 0; i < order_.size(); i++)
+	{
+		int row = order_[i];
+		for (size_t j = offsets[row]; j < offsets[row + 1]; j++)
+		{
+			graph->indices.push_back(inverse[indices[j]]);
+			graph->sqrDistances.push_back(sqrDistances[j]);
+		}
+		graph->offsets[i + 1] = graph->indices.size();
+	}
+
+	return graph;
+}
@@ -0,0 +1,136 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include "TreeHash.hpp"
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+
+#define DEFAULT_CHUNK_SIZE		(4 << 20)
+
+#define PRIME64_1		0x9E3779B185EBCA87ULL
+#define PRIME64_2		0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3		0x165667B19E3779F9ULL
+#define PRIME64_4		0x85EBCA77C2B2AE63ULL
+#define PRIME64_5		0x27D4EB2F165667C5ULL
+
+
+static inline uint64_t rotl(const uint64_t value_,
+							const int bits_)
+{
+	return (value_ << bits_) | (value_ >> (64 - bits_));
+}
+
+// Unaligned little endian reads (the digest must not depend on the host)
+static inline uint64_t read64(const uint8_t *p_)
+{
+	uint64_t value = 0;
+	for (int i = 7; i >= 0; i--)
+		value = (value << 8) | p_[i];
+	return value;
+}
+
+static inline uint32_t read32(const uint8_t *p_)
+{
+	return (uint32_t) p_[0] | ((uint32_t) p_[1] << 8) | ((uint32_t) p_[2] << 16) | ((uint32_t) p_[3] << 24);
+}
+
+static inline uint64_t accumulate(uint64_t acc_,
+								  const uint64_t input_)
+{
+	acc_ += input_ * PRIME64_2;
+	acc_ = rotl(acc_, 31);
+	return acc_ * PRIME64_1;
+}
+
+static inline uint64_t mergeRound(uint64_t acc_,
+								  const uint64_t value_)
+{
+	acc_ ^= accumulate(0, value_);
+	return acc_ * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t TreeHash::xxh64(const void *data_,
+						 const size_t size_,
+						 const uint64_t seed_)
+{
+	const uint8_t *p = (const uint8_t *) data_;
+	const uint8_t *end = p + size_;
+	uint64_t hash;
+
+	if (size_ >= 32)
+	{
+		uint64_t v1 = seed_ + PRIME64_1 + PRIME64_2;
+		uint64_t v2 = seed_ + PRIME64_2;
+		uint64_t v3 = seed_;
+		uint64_t v4 = seed_ - PRIME64_1;
+
+		const uint8_t *limit = end - 32;
+		do
+		{
+			v1 = accumulate(v1, read64(p));
+			v2 = accumulate(v2, read64(p + 8));
+			v3 = accumulate(v3, read64(p + 16));
+			v4 = accumulate(v4, read64(p + 24));
+			p += 32;
+		}
+		while (p <= limit);
+
+		hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+		hash = mergeRound(hash, v1);
+		hash = mergeRound(hash, v2);
+		hash = mergeRound(hash, v3);
+		hash = mergeRound(hash, v4);
+	}
+	else
+		hash = seed_ + PRIME64_5;
+
+	hash += (uint64_t) size_;
+
+	for (; p + 8 <= end; p += 8)
+		hash = rotl(hash ^ accumulate(0, read64(p)), 27) * PRIME64_1 + PRIME64_4;
+	if (p + 4 <= end)
+	{
+		hash = rotl(hash ^ ((uint64_t) read32(p) * PRIME64_1), 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+	for (; p < end; p++)
+		hash = rotl(hash ^ (*p * PRIME64_5), 11) * PRIME64_1;
+
+	// Final avalanche
+	hash ^= hash >> 33;
+	hash *= PRIME64_2;
+	hash ^= hash >> 29;
+	hash *= PRIME64_3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+std::string TreeHash::digest(const void *data_,
+							 const size_t size_,
+							 const size_t chunkSize_)
+{
+	size_t chunkSize = chunkSize_ > 0 ? chunkSize_ : DEFAULT_CHUNK_SIZE;
+	size_t chunks = (size_ + chunkSize - 1) / chunkSize;
+
+	// Leaves, stored little endian so the root doesn't depend on the host
+	std::vector<uint8_t> leaves(chunks * sizeof(uint64_t));
+	#pragma omp parallel for schedule(dynamic)
+	for (long c = 0; c < (long) chunks; c++)
+	{
+		size_t offset = c * chunkSize;
+		size_t length = offset + chunkSize > size_ ? size_ - offset : chunkSize;
+		uint64_t leaf = xxh64((const uint8_t *) data_ + offset, length, c);
+		for (size_t k = 0; k < sizeof(uint64_t); k++)
+			leaves[c * sizeof(uint64_t) + k] = (uint8_t) (leaf >> (8 * k));
+	}
+
+	// The chunk size is part of the root, so digests computed with different sizes never match
+	uint64_t root = xxh64(leaves.empty() ? NULL : &leaves[0], leaves.size(), size_ ^ rotl(chunkSize, 32));
+
+	char text[17];
+	snprintf(text, sizeof(text), "%016llx", (unsigned long long) root);
+	return text;
+}
@@ -12,14 +12,20 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/functional/hash.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
 #include <openssl/md5.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <fcntl.h>
+#include <unistd.h>
 #include <stdio.h>
 #include <plog/Log.h>
 #include <yaml-cpp/yaml.h>
+#include <pcl/io/pcd_io.h>
 #include "Config.hpp"
+#include "ChecksumIndex.hpp"
+#include "TreeHash.hpp"
 
 
 // Extract the current boost's minor version
@@ -36,6 +42,9 @@ boost::mt19937 generator;
 boost::random::mt19937 generator;
 #endif
 
+// Version of the cache keys, prefixed to every key (keys without it come from the MD5 era)
+#define CACHE_KEY_PREFIX	"v2-"
+
 
 template<typename T1, typename Generator, typename NumberType>
 std::vector<T1> generateRandomSet(const unsigned int size_,
@@ -74,6 +83,21 @@ std::vector<T1> generateRandomSet(const unsigned int size_,
 	return numbers;
 }
 
+static bool usesOrganizedPath(const std::string &inputCloudFile_)
+{
+	// Unorganized inputs are processed the same either way, so only the organized ones get a different key
+	if (!Config::useOrganizedPath())
+		return false;
+
+	pcl::PCLPointCloud2 header;
+	Eigen::Vector4f origin;
+	Eigen::Quaternionf orientation;
+	int version, dataType;
+	unsigned int dataStart;
+	pcl::PCDReader reader;
+	return reader.readHeader(inputCloudFile_, header, origin, orientation, version, dataType, dataStart) == 0 && header.height > 1;
+}
+
 plog::Severity Utils::getLogLevel(const std::string &filename_)
 {
 	YAML::Node logging = YAML::LoadFile(filename_);
@@ -111,45 +135,137 @@ std::string Utils::getWorkingDirectory()
 std::string Utils::getCalculationConfigHash(const std::string inputCloudFile_,
 		const double normalEstimationRadius_,
 		const DescriptorParamsPtr &descriptorParams_,
-		const CloudSmoothingParams &smoothingParams_)
+		const CloudSmoothingParams &smoothingParams_,
+		const bool legacyKey_)
 {
 	std::string str = "";
-	str += "input=" + getFileChecksum(inputCloudFile_);
+	str += "input=" + getKeyChecksum(inputCloudFile_, legacyKey_);
 	str += "-normalEstimationRadius=" + boost::lexical_cast<std::string>(normalEstimationRadius_);
 	str += "-" + descriptorParams_->toString();
-	if (smoothingParams_.useSmoothing)
+	if (smoothingParams_.modifiesCloud())
+		str += "-" + smoothingParams_.toString();
+	if (usesOrganizedPath(inputCloudFile_))
+		str += "-organizedPath";
+
+	boost::hash<std::string> strHash;
+	return (legacyKey_ ? "" : CACHE_KEY_PREFIX) + Utils::num2Hex(strHash(str));
+}
+
+std::string Utils::getPreprocessingHash(const std::string inputCloudFile_,
+		const double normalEstimationRadius_,
+		const CloudSmoothingParams &smoothingParams_,
+		const bool legacyKey_)
+{
+	// Same as the calculation hash, minus the descriptor (so every descriptor shares the preprocessed cloud)
+	std::string str = "preprocessing";
+	str += "-input=" + getKeyChecksum(inputCloudFile_, legacyKey_);
+	str += "-normalEstimationRadius=" + boost::lexical_cast<std::string>(normalEstimationRadius_);
+	if (smoothingParams_.modifiesCloud())
 		str += "-" + smoothingParams_.toString();
+	if (usesOrganizedPath(inputCloudFile_))
+		str += "-organizedPath";
 
 	boost::hash<std::string> strHash;
-	return Utils::num2Hex(strHash(str));
+	return (legacyKey_ ? "" : CACHE_KEY_PREFIX) + Utils::num2Hex(strHash(str));
+}
+
+bool Utils::isCacheKey(const std::string &key_)
+{
+	std::string prefix = CACHE_KEY_PREFIX;
+	if (key_.compare(0, prefix.size(), prefix) == 0)
+		return isLegacyCacheKey(key_.substr(prefix.size()));
+	return isLegacyCacheKey(key_);
+}
+
+bool Utils::isLegacyCacheKey(const std::string &key_)
+{
+	// Legacy keys are plain hexadecimal hashes (as num2Hex writes them), without any version prefix
+	return !key_.empty() && key_.size() <= 2 * sizeof(size_t)
+		   && key_.find_first_not_of("0123456789abcdef") == std::string::npos
+		   && (key_[0] != '0' || key_.size() == 1);
+}
+
+bool Utils::isCacheEntry(const std::string &filename_)
+{
+	return isCacheKey(getEntryKey(filename_));
+}
+
+bool Utils::isLegacyCacheEntry(const std::string &filename_)
+{
+	return isLegacyCacheKey(getEntryKey(filename_));
+}
+
+std::string Utils::getTemporaryFilename(const std::string &destination_)
+{
+	// Hidden and unique per process and thread, so concurrent writers never share it
+	boost::filesystem::path destination(destination_);
+	std::ostringstream name;
+	name << "." << destination.filename().string() << ".tmp." << getpid() << "." << boost::this_thread::get_id();
+	return (destination.parent_path() / name.str()).string();
+}
+
+std::string Utils::getEntryKey(const std::string &filename_)
+{
+	// Descriptor entries are named after their key, cloud entries add the cloud extension
+	std::string extension = CLOUD_FILE_EXTENSION;
+	if (filename_.size() > extension.size() && filename_.compare(filename_.size() - extension.size(), extension.size(), extension) == 0)
+		return filename_.substr(0, filename_.size() - extension.size());
+	return filename_;
 }
 
 std::string Utils::getFileChecksum(const std::string filename_)
+{
+	// Unchanged files reuse the digest computed in a previous run
+	return ChecksumIndex::getChecksum(filename_, Config::getChecksumType());
+}
+
+std::string Utils::computeFileChecksum(const std::string filename_,
+									   const Params::ChecksumType type_)
 {
 	int fileDescriptor = open(filename_.c_str(), O_RDONLY);
 	if (fileDescriptor < 0)
-		throw std::runtime_error("ERROR: Unable to open file for MD5 checksum");
+		throw std::runtime_error("ERROR: Unable to open file for checksum");
 
 	struct stat statbuf;
 	if (fstat(fileDescriptor, &statbuf) < 0)
-		throw std::runtime_error("ERROR: Unable to get file properties for MD5 checksum");
+	{
+		close(fileDescriptor);
+		throw std::runtime_error("ERROR: Unable to get file properties for checksum");
+	}
 
 	unsigned long fileSize = statbuf.st_size;
 	char *fileBuffer = (char *) mmap(0, fileSize, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+	close(fileDescriptor);
+	if (fileSize > 0 && fileBuffer == MAP_FAILED)
+		throw std::runtime_error("ERROR: Unable to map file for checksum");
+
+	if (type_ == Params::CHECKSUM_TREE)
+	{
+		std::string digest = TreeHash::digest(fileSize > 0 ? fileBuffer : NULL, fileSize);
+		if (fileSize > 0)
+			munmap(fileBuffer, fileSize);
+		return digest;
+	}
 
 	unsigned char digest[MD5_DIGEST_LENGTH];
 	MD5((unsigned char*) fileBuffer, fileSize, digest);
-	munmap(fileBuffer, fileSize);
+	if (fileSize > 0)
+		munmap(fileBuffer, fileSize);
 
 	char stringMD5[MD5_DIGEST_LENGTH * 2 + 1];
 	for (int i = 0; i < MD5_DIGEST_LENGTH; i++)
 		sprintf(&stringMD5[i * 2], "%02x", digest[i]);
 
-	close(fileDescriptor);
-
 	return stringMD5;
 }
 
+std::string Utils::getKeyChecksum(const std::string &filename_,
+								  const bool legacyKey_)
+{
+	// Legacy keys were always built from the MD5 of the input
+	return legacyKey_ ? ChecksumIndex::getChecksum(filename_, Params::CHECKSUM_MD5) : getFileChecksum(filename_);
+}
+
 int Utils::getRandomNumber(const int min_,
 						   const int max_)
 {
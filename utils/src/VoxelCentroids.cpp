@@ -0,0 +1,54 @@
+/**
+ * Author: rodrigo
+ * 2017
+ */
+#include "VoxelCentroids.hpp"
+#include <cmath>
+#include <stdexcept>
+
+
+VoxelCentroids::VoxelCentroids(const double voxelSize_)
+{
+	if (voxelSize_ <= 0)
+		throw std::runtime_error("Voxel size must be positive");
+
+	inverseSize = 1.0f / (float) voxelSize_;
+}
+
+VoxelCentroids::~VoxelCentroids()
+{
+}
+
+void VoxelCentroids::add(const pcl::PointCloud<pcl::PointXYZ> &cloud_)
+{
+	for (size_t i = 0; i < cloud_.size(); i++)
+	{
+		const pcl::PointXYZ &p = cloud_.points[i];
+		if (!pcl_isfinite(p.x) || !pcl_isfinite(p.y) || !pcl_isfinite(p.z))
+			continue;
+
+		Cell cell;
+		cell.i = (int) floor(p.x * inverseSize);
+		cell.j = (int) floor(p.y * inverseSize);
+		cell.k = (int) floor(p.z * inverseSize);
+
+		Accumulator &voxel = voxels[cell];
+		voxel.x += p.x;
+		voxel.y += p.y;
+		voxel.z += p.z;
+		voxel.count++;
+	}
+}
+
+pcl::PointCloud<pcl::PointXYZ>::Ptr VoxelCentroids::getCentroids() const
+{
+	pcl::PointCloud<pcl::PointXYZ>::Ptr centroids(new pcl::PointCloud<pcl::PointXYZ>());
+	centroids->reserve(voxels.size());
+	for (std::map<Cell, Accumulator>::const_iterator it = voxels.begin(); it != voxels.end(); it++)
+	{
+		float count = it->second.count;
+		centroids->push_back(pcl::PointXYZ(it->second.x / count, it->second.y / count, it->second.z / count));
+	}
+
+	return centroids;
+}